@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <variant>
 #include <cassert>
@@ -15,6 +16,18 @@
 #include "dbg_log.h"
 #endif
 
+// Task notification counting the messages pending in both lanes of a thread with a priority lane.
+// Index 0 is used by stream and message buffers.
+#ifndef GENERIC_THREAD_NOTIFICATION_INDEX
+#define GENERIC_THREAD_NOTIFICATION_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#endif
+
+// Clock timing the callbacks for the statistics: a function returning microseconds, e.g. from a hardware timer.
+// Without one, the tick count is used, with the resolution of a tick.
+#if defined(GENERIC_THREAD_ENABLE_STATS) && defined(GENERIC_THREAD_STATS_CLOCK_US)
+extern "C" uint32_t GENERIC_THREAD_STATS_CLOCK_US(void);
+#endif
+
 namespace Teufel::GenericThread
 {
 
@@ -25,6 +38,141 @@ struct QueueMessage
     T       payload;
 };
 
+/**
+ * @brief How PostMsg() queues a message, declared per alternative of the message variant of a thread.
+ *  - Append:     appended to the queue, the sender waits up to 100 ms for space (the default)
+ *  - Coalesce:   not queued again while a message of the same alternative is still queued.
+ *                Meant for events without payload, e.g. interrupts, as the payload of the new message is lost.
+ *  - CoalesceNoWait: as Coalesce, but the sender never waits for space, the message is dropped if the queue is full.
+ *                For notifications the receiver also polls for, e.g. from its idle callback.
+ *  - Urgent:     sent to the front of the queue if no other urgent message is queued. While one is, further urgent
+ *                messages are appended like Append ones, so that urgent messages are handled in the order they
+ *                were posted. Only the first of a burst jumps the queue.
+ * @note The policy applies to the lane the message goes to, if the thread has a priority lane.
+ */
+enum class PostPolicy : uint8_t
+{
+    Append,
+    Coalesce,
+    CoalesceNoWait,
+    Urgent,
+};
+
+// Specialize for the alternatives of a message variant that do not use the default policy, e.g.
+// template <> constexpr PostPolicy post_policy<AudioMessage, IoExpanderInterrupt> = PostPolicy::Coalesce;
+template <typename T, typename M>
+constexpr PostPolicy post_policy = PostPolicy::Append;
+
+template <typename T>
+struct PostPolicies
+{
+    static constexpr size_t count = 1;
+
+    static PostPolicy get(const T &)
+    {
+        return PostPolicy::Append;
+    }
+
+    static size_t index(const T &)
+    {
+        return 0;
+    }
+};
+
+template <typename... M>
+struct PostPolicies<std::variant<M...>>
+{
+    static constexpr size_t     count           = sizeof...(M);
+    static constexpr PostPolicy policies[count] = {post_policy<std::variant<M...>, M>...};
+
+    static PostPolicy get(const std::variant<M...> &msg)
+    {
+        return policies[msg.index()];
+    }
+
+    static size_t index(const std::variant<M...> &msg)
+    {
+        return msg.index();
+    }
+};
+
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+struct CallbackStats
+{
+    uint32_t count;
+    uint32_t total_us;
+    uint32_t max_us;
+};
+
+// Statistics of a thread, all threads with statistics are linked into stats_list
+struct ThreadStats
+{
+    const char   *name;
+    TaskHandle_t  task;
+    uint32_t      stack_size; // words
+    uint8_t       queue_size;
+    uint8_t       priority_queue_size;
+    uint8_t       max_queued; // high-water marks of the queues
+    uint8_t       max_priority_queued;
+    uint32_t      posted;
+    uint32_t      coalesced;
+    uint32_t      failed;
+    CallbackStats idle;
+    CallbackStats *messages; // per alternative of the message variant
+    size_t         message_types;
+    ThreadStats   *next;
+};
+
+// Static storage of the statistics of a thread, see Config::Stats
+template <typename T>
+struct ThreadStatsBuffer : ThreadStats
+{
+    CallbackStats message_buffer[PostPolicies<T>::count];
+};
+
+inline ThreadStats *stats_list = nullptr;
+
+static inline uint32_t stats_clock_us()
+{
+#if defined(GENERIC_THREAD_STATS_CLOCK_US)
+    return GENERIC_THREAD_STATS_CLOCK_US();
+#else
+    return xTaskGetTickCount() * (1000000UL / configTICK_RATE_HZ);
+#endif
+}
+
+static inline void stats_record(CallbackStats &stats, uint32_t start_us)
+{
+    uint32_t duration_us = stats_clock_us() - start_us;
+    stats.count++;
+    stats.total_us += duration_us;
+    if (duration_us > stats.max_us)
+    {
+        stats.max_us = duration_us;
+    }
+}
+
+/**
+ * @brief Clears the counters and high-water marks of all threads (the stack high-water mark is kept by FreeRTOS).
+ */
+static inline void resetStats()
+{
+    for (ThreadStats *p = stats_list; p != nullptr; p = p->next)
+    {
+        p->max_queued          = 0;
+        p->max_priority_queued = 0;
+        p->posted              = 0;
+        p->coalesced           = 0;
+        p->failed              = 0;
+        p->idle                = {};
+        for (size_t i = 0; i < p->message_types; i++)
+        {
+            p->messages[i] = {};
+        }
+    }
+}
+#endif
+
 
 template <typename T>
 struct Config
@@ -32,12 +180,19 @@ struct Config
     const char   *Name;
     uint32_t      StackSize;
     unsigned long Priority;
-    uint32_t      IdleMs;
+    uint32_t      IdleMs; // Period of the idle callback, unless it schedules its next run (see scheduleIdle())
     void (*Callback_Idle)();
     void (*Callback_Init)();
 
     uint8_t QueueSize;
 
+    // Optional priority lane (disabled if PriorityQueueSize is 0): messages for which IsPriority returns true
+    // are dequeued ahead of the main queue. Once PriorityBurstLimit priority messages have been handled in a row
+    // while the main queue was not empty, one message of the main queue is handled so that it cannot starve.
+    uint8_t PriorityQueueSize;
+    uint8_t PriorityBurstLimit;
+    bool (*IsPriority)(const T &msg);
+
     void (*Callback)(uint8_t mid, T msg);
 
 #if defined(configSUPPORT_STATIC_ALLOCATION) && (configSUPPORT_STATIC_ALLOCATION == 1)
@@ -46,6 +201,13 @@ struct Config
 
     StaticQueue_t *StaticQueue;
     uint8_t *QueueBuffer;
+
+    StaticQueue_t *StaticPriorityQueue;
+    uint8_t *PriorityQueueBuffer;
+#endif
+
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+    ThreadStatsBuffer<T> *Stats; // Optional
 #endif
 };
 
@@ -66,17 +228,177 @@ struct GenericThread
     const Config<T> *config;
     TaskHandle_t     task;
     QueueHandle_t    queue;
+    QueueHandle_t    priority_queue;
+    uint8_t          priority_burst;
     uint32_t         idle_ms;
 
+    // One bit per alternative of the message variant with a Coalesce policy, set while such a message is queued
+    uint32_t coalesce_pending;
+
+    // Number of queued messages with the Urgent policy, in either lane
+    uint8_t urgent_queued;
+
+    // Deadline of the next idle callback run, see scheduleIdle()
+    TickType_t next_idle_tick;
+    bool       within_idle;
+    bool       idle_scheduled;
+
 #if defined(GENERIC_THREAD_ENABLE_STATS)
-    struct
-    {
-        uint8_t  MaxQueueSize;
-        uint16_t MinStackSize_bytes;
-    } stats;
+    ThreadStats *stats;
 #endif
 };
 
+// Updates the pending bits of the coalesced messages, returns false if the bit to set was already set
+template <typename T>
+static bool update_coalesce_pending(GenericThread<T> *gthread, const T &msg, bool set, bool from_isr)
+{
+    const PostPolicy policy = PostPolicies<T>::get(msg);
+    if (policy != PostPolicy::Coalesce && policy != PostPolicy::CoalesceNoWait)
+    {
+        return true;
+    }
+
+    uint32_t    bit                    = 1UL << PostPolicies<T>::index(msg);
+    UBaseType_t saved_interrupt_status = 0;
+    if (from_isr)
+    {
+        saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+    }
+
+    bool updated = !set || (gthread->coalesce_pending & bit) == 0;
+    if (set)
+    {
+        gthread->coalesce_pending |= bit;
+    }
+    else
+    {
+        gthread->coalesce_pending &= ~bit;
+    }
+
+    if (from_isr)
+    {
+        taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+    return updated;
+}
+
+// Counts the queued urgent messages, returns where to queue the posted one: only the first one goes to the front
+template <typename T>
+static BaseType_t update_urgent_queued(GenericThread<T> *gthread, const T &msg, bool queued, bool from_isr)
+{
+    if (PostPolicies<T>::get(msg) != PostPolicy::Urgent)
+    {
+        return queueSEND_TO_BACK;
+    }
+
+    UBaseType_t saved_interrupt_status = 0;
+    if (from_isr)
+    {
+        saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+    }
+    else
+    {
+        taskENTER_CRITICAL();
+    }
+
+    const BaseType_t position = (gthread->urgent_queued == 0) ? queueSEND_TO_FRONT : queueSEND_TO_BACK;
+    if (queued)
+    {
+        gthread->urgent_queued++;
+    }
+    else if (gthread->urgent_queued > 0)
+    {
+        gthread->urgent_queued--;
+    }
+
+    if (from_isr)
+    {
+        taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+    }
+    else
+    {
+        taskEXIT_CRITICAL();
+    }
+    return position;
+}
+
+static inline bool is_tick_before(TickType_t a, TickType_t b)
+{
+    // Wraparound safe as long as both ticks are less than half the tick range apart
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+// Runs the idle callback if its deadline is reached (or overdue) and returns the ticks left until the next one
+template <typename T>
+static TickType_t run_idle_if_due(GenericThread<T> *gthread)
+{
+    if (is_tick_before(xTaskGetTickCount(), gthread->next_idle_tick))
+    {
+        return gthread->next_idle_tick - xTaskGetTickCount();
+    }
+
+    gthread->within_idle    = true;
+    gthread->idle_scheduled = false;
+    if (gthread->config->Callback_Idle)
+    {
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+        uint32_t start_us = stats_clock_us();
+        gthread->config->Callback_Idle();
+        if (gthread->stats)
+        {
+            stats_record(gthread->stats->idle, start_us);
+        }
+#else
+        gthread->config->Callback_Idle();
+#endif
+    }
+    gthread->within_idle = false;
+
+    if (!gthread->idle_scheduled)
+    {
+        gthread->next_idle_tick = xTaskGetTickCount() + pdMS_TO_TICKS(gthread->idle_ms);
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    return is_tick_before(now, gthread->next_idle_tick) ? gthread->next_idle_tick - now : 0;
+}
+
+template <typename T>
+static bool receive(GenericThread<T> *gthread, QueueMessage<T> *msg, TickType_t timeout)
+{
+    if (!gthread->priority_queue)
+    {
+        return xQueueReceive(gthread->queue, (void *) msg, timeout) == pdTRUE;
+    }
+
+    // The notification is given once per message posted to either lane
+    if (ulTaskNotifyTakeIndexed(GENERIC_THREAD_NOTIFICATION_INDEX, pdFALSE, timeout) == 0)
+    {
+        return false;
+    }
+
+    bool main_queue_waiting = uxQueueMessagesWaiting(gthread->queue) > 0;
+    if (!main_queue_waiting || gthread->priority_burst < gthread->config->PriorityBurstLimit)
+    {
+        if (xQueueReceive(gthread->priority_queue, (void *) msg, 0) == pdTRUE)
+        {
+            gthread->priority_burst = main_queue_waiting ? gthread->priority_burst + 1 : 0;
+            return true;
+        }
+    }
+
+    gthread->priority_burst = 0;
+    return xQueueReceive(gthread->queue, (void *) msg, 0) == pdTRUE;
+}
+
 template <typename T>
 [[noreturn]] static void task_loop(void *pvParameters)
 {
@@ -91,15 +413,13 @@ template <typename T>
         config->Callback_Init();
     }
 
+    gthread->next_idle_tick = xTaskGetTickCount() + pdMS_TO_TICKS(gthread->idle_ms);
+
     if constexpr (std::is_same_v<T, void>)
     {
         while (true)
         {
-            vTaskDelay(pdMS_TO_TICKS(gthread->idle_ms));
-            if (config->Callback_Idle)
-            {
-                config->Callback_Idle();
-            }
+            vTaskDelay(run_idle_if_due(gthread));
         }
     }
     else
@@ -108,18 +428,22 @@ template <typename T>
 
         while (true)
         {
-            if (xQueueReceive(gthread->queue, (void *) &(msg), pdMS_TO_TICKS(gthread->idle_ms)))
+            // Sleeps until the idle deadline or a message, whichever comes first. The deadline is checked
+            // after every message as well, so a busy queue cannot starve the idle callback.
+            if (receive(gthread, &msg, run_idle_if_due(gthread)))
             {
+                // Cleared before handling, so that an event posted meanwhile is queued again
+                update_coalesce_pending(gthread, msg.payload, false, false);
+                update_urgent_queued(gthread, msg.payload, false, false);
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+                uint32_t start_us = stats_clock_us();
                 config->Callback(msg.mid, msg.payload);
-            }
-            else
-            {
-                if (config->Callback_Idle)
+                if (gthread->stats)
                 {
-                    config->Callback_Idle();
+                    stats_record(gthread->stats->messages[PostPolicies<T>::index(msg.payload)], start_us);
                 }
-#if defined(GENERIC_THREAD_ENABLE_STATS)
-                gthread->stats.MinStackSize_bytes = uxTaskGetStackHighWaterMark2(gthread->task) * 4;
+#else
+                config->Callback(msg.mid, msg.payload);
 #endif
             }
         }
@@ -138,15 +462,24 @@ GenericThread<T> *create(const Config<T> *config)
     gthread->idle_ms = config->IdleMs;
     gthread->task    = nullptr;
     gthread->queue   = nullptr;
+
+    gthread->priority_queue = nullptr;
+    gthread->priority_burst = 0;
+
+    gthread->coalesce_pending = 0;
+    gthread->urgent_queued    = 0;
+
+    gthread->next_idle_tick = 0;
+    gthread->within_idle    = false;
+    gthread->idle_scheduled = false;
 #if defined(GENERIC_THREAD_ENABLE_STATS)
-    GenThread->stats.MaxQueueSize       = 0;
-    GenThread->stats.MinStackSize_bytes = config->StackSize * 4;
+    gthread->stats = nullptr;
 #endif
 
     log_trace("[%s] Create Message Queue\n", config->Name);
     if constexpr (!std::is_same_v<T, void>)
     {
-        QueueMessage<T> msg;
+        static_assert(PostPolicies<T>::count <= 32, "Too many message types for the coalescing bits");
 
 #if defined(configSUPPORT_DYNAMIC_ALLOCATION) && (configSUPPORT_DYNAMIC_ALLOCATION == 1)
         gthread->queue = xQueueCreate(config->QueueSize, sizeof(QueueMessage<T>));
@@ -154,6 +487,19 @@ GenericThread<T> *create(const Config<T> *config)
         gthread->queue = xQueueCreateStatic(config->QueueSize, sizeof(QueueMessage<T>), config->QueueBuffer, config->StaticQueue);
 #endif
         assert(gthread->queue != nullptr);
+
+        if (config->PriorityQueueSize > 0)
+        {
+            assert(config->IsPriority != nullptr);
+#if defined(configSUPPORT_DYNAMIC_ALLOCATION) && (configSUPPORT_DYNAMIC_ALLOCATION == 1)
+            gthread->priority_queue = xQueueCreate(config->PriorityQueueSize, sizeof(QueueMessage<T>));
+#else
+            gthread->priority_queue =
+                xQueueCreateStatic(config->PriorityQueueSize, sizeof(QueueMessage<T>),
+                                   config->PriorityQueueBuffer, config->StaticPriorityQueue);
+#endif
+            assert(gthread->priority_queue != nullptr);
+        }
     }
 
     /* Note: If your code broke when I moved this, you were relying on uninitialized values. */
@@ -178,6 +524,31 @@ GenericThread<T> *create(const Config<T> *config)
     xHandle = xTaskCreateStatic(task_loop<T>, config->Name, config->StackSize, (void *) gthread, config->Priority,
                              config->StackBuffer, config->StaticTask);
     assert(xHandle);
+    gthread->task = xHandle;
+#endif
+
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+    if constexpr (!std::is_same_v<T, void>)
+    {
+        if (config->Stats)
+        {
+            ThreadStatsBuffer<T> *stats = config->Stats;
+            *stats                      = {};
+            stats->name                 = config->Name;
+            stats->task                 = gthread->task;
+            stats->stack_size           = config->StackSize;
+            stats->queue_size           = config->QueueSize;
+            stats->priority_queue_size  = config->PriorityQueueSize;
+            stats->messages             = stats->message_buffer;
+            stats->message_types        = PostPolicies<T>::count;
+
+            taskENTER_CRITICAL();
+            stats->next    = stats_list;
+            stats_list     = stats;
+            gthread->stats = stats;
+            taskEXIT_CRITICAL();
+        }
+    }
 #endif
 
     return gthread;
@@ -204,38 +575,129 @@ int PostMsg(GenericThread<T> *gthread, uint8_t mid, T msg)
 
     uint32_t IPSR_register;
     __asm volatile("MRS %0, ipsr" : "=r"(IPSR_register));
+    const bool from_isr = (0U != IPSR_register);
 
-    if (0U == IPSR_register)
+    const PostPolicy policy = PostPolicies<T>::get(msg);
+    if (!update_coalesce_pending(gthread, msg, true, from_isr))
     {
-        if (xQueueSend(gthread->queue, (void *) &txmsg, (TickType_t) 100) != pdPASS)
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+        if (gthread->stats)
         {
-            log_err("{%s} Post Msg from failed (mem left: %d)", pcTaskGetName(gthread->task),
-                    uxQueueSpacesAvailable(gthread->queue));
-            error = -1;
+            gthread->stats->coalesced++;
         }
+#endif
+        // Already queued, handling that one is enough
+        return 0;
+    }
+
+    QueueHandle_t queue = gthread->queue;
+    if (gthread->priority_queue && gthread->config->IsPriority(msg))
+    {
+        queue = gthread->priority_queue;
+    }
+
+    const BaseType_t position = update_urgent_queued(gthread, msg, true, from_isr);
+    const TickType_t timeout  = (policy == PostPolicy::CoalesceNoWait) ? 0 : (TickType_t) 100;
+
+    BaseType_t sent;
+    if (!from_isr)
+    {
+        sent = xQueueGenericSend(queue, &txmsg, timeout, position);
     }
     else
     {
-        if (xQueueSendFromISR(gthread->queue, (void *) &txmsg, &xHigherPriorityTaskWoken) != pdTRUE)
+        sent = xQueueGenericSendFromISR(queue, &txmsg, &xHigherPriorityTaskWoken, position);
+    }
+
+    if (sent != pdPASS)
+    {
+        update_coalesce_pending(gthread, msg, false, from_isr);
+        update_urgent_queued(gthread, msg, false, from_isr);
+        if (!from_isr)
+        {
+            // The receiver of a CoalesceNoWait message polls for it, a full queue is not an error worth logging
+            if (policy != PostPolicy::CoalesceNoWait)
+            {
+                log_err("{%s} Post Msg from failed (mem left: %d)", pcTaskGetName(gthread->task),
+                        uxQueueSpacesAvailable(queue));
+            }
+            error = -1;
+        }
+        else
         {
             // log_err("[ISR] Post Msg failed for \"%s\" with event:%d", pcTaskGetName(gen_thread->Task), event);
             error = -2;
         }
+    }
+    else if (gthread->priority_queue)
+    {
+        if (!from_isr)
+        {
+            xTaskNotifyGiveIndexed(gthread->task, GENERIC_THREAD_NOTIFICATION_INDEX);
+        }
+        else
+        {
+            vTaskNotifyGiveIndexedFromISR(gthread->task, GENERIC_THREAD_NOTIFICATION_INDEX, &xHigherPriorityTaskWoken);
+        }
+    }
+
+    if (from_isr)
+    {
         // Switch context if necessary.
         portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
     }
 
 #if defined(GENERIC_THREAD_ENABLE_STATS)
-    uint32_t queueSize          = gthread->config->QueueSize - uxQueueSpacesAvailable(gthread->queue);
-    gthread->stats.MaxQueueSize = MAX(queueSize, gthread->stats.MaxQueueSize);
+    if (gthread->stats)
+    {
+        ThreadStats *stats = gthread->stats;
+        uint8_t      queued = from_isr ? uxQueueMessagesWaitingFromISR(queue) : uxQueueMessagesWaiting(queue);
+        uint8_t     &max_queued = (queue == gthread->queue) ? stats->max_queued : stats->max_priority_queued;
+        if (queued > max_queued)
+        {
+            max_queued = queued;
+        }
+        if (sent == pdPASS)
+        {
+            stats->posted++;
+        }
+        else
+        {
+            stats->failed++;
+        }
+    }
 #endif
 
     return error;
 }
 
-#if defined(GENERIC_THREAD_ENABLE_STATS)
-uint16_t getMinStackSize(GenericThread_t *gthread);
-uint8_t  getMaxQueueSize(GenericThread_t *gthread);
-#endif
+/**
+ * @brief Gets the handle of the task of the thread, set once when the thread is created.
+ */
+template <typename T>
+TaskHandle_t getTaskHandle(const GenericThread<T> *gthread)
+{
+    return gthread->task;
+}
+
+/**
+ * @brief Schedules the idle callback of the thread to run in delay_ms at the latest.
+ * @note  Must be called from the thread itself. The earliest deadline wins.
+ *        If called from the idle callback, the deadline replaces IdleMs for the next run, so the callback
+ *        can let the thread sleep longer than IdleMs when it has nothing to do.
+ */
+template <typename T>
+void scheduleIdle(GenericThread<T> *gthread, uint32_t delay_ms)
+{
+    TickType_t tick = xTaskGetTickCount() + pdMS_TO_TICKS(delay_ms);
+    if ((gthread->within_idle && !gthread->idle_scheduled) || is_tick_before(tick, gthread->next_idle_tick))
+    {
+        gthread->next_idle_tick = tick;
+    }
+    if (gthread->within_idle)
+    {
+        gthread->idle_scheduled = true;
+    }
+}
 
 }
@@ -1,5 +1,6 @@
 #include "actionslink.h"
 #include "actionslink_bt_ul.h"
+#include "actionslink_bt_ll.h"
 #include "actionslink_decoders.h"
 #include "actionslink_encoders.h"
 #include "actionslink_events.h"
@@ -8,6 +9,11 @@
 #include "actionslink_utils.h"
 #include "actionslink_version.h"
 #include "common.pb.h"
+#include <string.h>
+
+// Longest wait for the transactions in flight before a baudrate negotiation. Longer than a transaction can stay in
+// flight: two attempts, each waiting up to 300 ms for the ACK and then for the response.
+#define BAUDRATE_NEGOTIATION_IDLE_TIMEOUT_MS (1500u)
 
 typedef struct
 {
@@ -24,6 +30,8 @@ static actionslink_driver_t m_actionslink;
 static bool        is_driver_ready(void);
 static const char *get_error_desc(ActionsLink_Error_Code error_code);
 static ActionsLink_Eco_Device_Color to_pb_color(actionslink_device_color_t color);
+static void        on_notification_complete(int result, const ActionsLink_ToMcu *p_response, void *p_context);
+static int         request_uart_baudrate(uint32_t baudrate, uint32_t *p_accepted_baudrate);
 
 int actionslink_init(const actionslink_config_t *p_config, const actionslink_event_handlers_t *p_event_handlers,
                      const actionslink_request_handlers_t *p_request_handlers)
@@ -110,9 +118,9 @@ void actionslink_tick(void)
         return;
     }
 
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    actionslink_bt_ul_rx(&response);
+    // Nothing to do with the received messages besides dispatching them,
+    // so there is no need for a message on the stack
+    actionslink_bt_ul_rx(NULL);
 }
 
 bool actionslink_is_ready(void)
@@ -137,9 +145,13 @@ int actionslink_get_firmware_version(actionslink_firmware_version_t *p_version)
     message.Payload.request.seq           = m_actionslink.next_sequence_id++;
     message.Payload.request.which_Request = ActionsLink_FromMcuRequest_get_firmware_version_tag;
 
-    ActionsLink_ToMcu response       = ActionsLink_ToMcu_init_zero;
-    response.cb_Payload.arg          = p_version->p_build_string;
-    response.cb_Payload.funcs.decode = actionslink_decode_to_mcu_message;
+    // Without a buffer for the build string, it is skipped by the decoder
+    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
+    if (p_version->p_build_string != NULL)
+    {
+        response.cb_Payload.arg          = p_version->p_build_string;
+        response.cb_Payload.funcs.decode = actionslink_decode_to_mcu_message;
+    }
     if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
     {
         log_error("failed to get firmware version");
@@ -152,6 +164,93 @@ int actionslink_get_firmware_version(actionslink_firmware_version_t *p_version)
     return 0;
 }
 
+int actionslink_negotiate_uart_baudrate(uint32_t max_baudrate, uint32_t *p_baudrate)
+{
+    if (!is_driver_ready())
+        return -1;
+
+    if (m_actionslink.p_config->set_baudrate_fn == NULL)
+    {
+        log_error("baudrate negotiation not supported by the configuration");
+        return -1;
+    }
+
+    // Nothing else may be in flight while the baudrate changes
+    uint32_t wait_start_ms = actionslink_utils_get_ms();
+    while (actionslink_bt_ul_is_busy())
+    {
+        if (actionslink_utils_get_ms_since(wait_start_ms) > BAUDRATE_NEGOTIATION_IDLE_TIMEOUT_MS)
+        {
+            log_error("transactions still in flight, baudrate negotiation skipped");
+            return -1;
+        }
+
+        actionslink_tick();
+        if (m_actionslink.p_config->task_yield_fn)
+        {
+            m_actionslink.p_config->task_yield_fn();
+        }
+    }
+
+    log_debug("negotiating uart baudrate (max %d)", max_baudrate);
+
+    uint32_t accepted_baudrate = 0;
+    if (request_uart_baudrate(max_baudrate, &accepted_baudrate) != 0)
+    {
+        log_error("failed to negotiate uart baudrate");
+        return -1;
+    }
+
+    if (accepted_baudrate == 0 || accepted_baudrate > max_baudrate)
+    {
+        log_error("invalid baudrate proposed by the module: %d", accepted_baudrate);
+        return -1;
+    }
+
+    if (accepted_baudrate != actionslink_bt_ll_get_baudrate())
+    {
+        // The ACK of the response has already been sent, so the module is switching right now
+        if (m_actionslink.p_config->task_yield_fn)
+        {
+            m_actionslink.p_config->task_yield_fn();
+        }
+
+        uint32_t confirmed_baudrate = 0;
+        if ((actionslink_bt_ll_set_baudrate(accepted_baudrate) != 0) ||
+            (request_uart_baudrate(accepted_baudrate, &confirmed_baudrate) != 0) ||
+            (confirmed_baudrate != accepted_baudrate))
+        {
+            // Without the confirmation the module returns to the default baudrate on its own
+            log_error("baudrate %d could not be confirmed, falling back", accepted_baudrate);
+            actionslink_bt_ll_set_baudrate(ACTIONSLINK_DEFAULT_BAUDRATE);
+            if (p_baudrate)
+            {
+                *p_baudrate = ACTIONSLINK_DEFAULT_BAUDRATE;
+            }
+            return -1;
+        }
+    }
+
+    log_info("uart baudrate: %d", accepted_baudrate);
+    if (p_baudrate)
+    {
+        *p_baudrate = accepted_baudrate;
+    }
+    return 0;
+}
+
+void actionslink_get_link_stats(actionslink_link_stats_t *p_stats)
+{
+    actionslink_bt_ll_get_stats(p_stats);
+    actionslink_bt_ul_get_stats(p_stats);
+}
+
+void actionslink_reset_link_stats(void)
+{
+    actionslink_bt_ll_reset_stats();
+    actionslink_bt_ul_reset_stats();
+}
+
 int actionslink_set_power_state(actionslink_power_state_t power_state)
 {
     if (!is_driver_ready())
@@ -242,8 +341,29 @@ int actionslink_get_this_device_name(actionslink_buffer_dsc_t *p_buffer_dsc)
 
 int actionslink_get_bt_device_name(uint64_t address, actionslink_buffer_dsc_t *p_buffer_dsc)
 {
-    log_debug("get bt device name not implemented");
-    return -1;
+    if (!is_driver_ready())
+        return -1;
+
+    log_debug("sending get bt device name request");
+
+    ActionsLink_FromMcu message                             = ActionsLink_FromMcu_init_zero;
+    message.which_Payload                                   = ActionsLink_FromMcu_request_tag;
+    message.Payload.request.seq                             = m_actionslink.next_sequence_id++;
+    message.Payload.request.which_Request                   = ActionsLink_FromMcuRequest_get_device_name_tag;
+    message.Payload.request.Request.get_device_name.address = address;
+
+    ActionsLink_ToMcu response       = ActionsLink_ToMcu_init_zero;
+    response.cb_Payload.arg          = p_buffer_dsc;
+    response.cb_Payload.funcs.decode = actionslink_decode_to_mcu_message;
+    if ((actionslink_bt_ul_tx_rx(&message, &response) != 0) ||
+        (response.Payload.response.Response.get_device_name.which_Result ==
+         ActionsLink_Bluetooth_ResponseDeviceName_error_tag))
+    {
+        log_error("failed to get bt device name");
+        return -1;
+    }
+
+    return 0;
 }
 
 int actionslink_get_bt_mac_address(uint64_t *p_bt_mac_address)
@@ -317,8 +437,32 @@ int actionslink_get_bt_rssi_value(int8_t *p_bt_rssi_val)
 
 int actionslink_get_bt_paired_device_list(actionslink_bt_paired_device_list_t *p_list)
 {
-    log_debug("get bt paired device list not implemented");
-    return -1;
+    if (!is_driver_ready())
+        return -1;
+
+    log_debug("sending get paired device list request");
+
+    ActionsLink_FromMcu message           = ActionsLink_FromMcu_init_zero;
+    message.which_Payload                 = ActionsLink_FromMcu_request_tag;
+    message.Payload.request.seq           = m_actionslink.next_sequence_id++;
+    message.Payload.request.which_Request = ActionsLink_FromMcuRequest_get_paired_device_list_tag;
+
+    // The addresses are decoded one by one straight into the list, see actionslink_decoders.c
+    p_list->number_of_items = 0;
+
+    ActionsLink_ToMcu response       = ActionsLink_ToMcu_init_zero;
+    response.cb_Payload.arg          = p_list;
+    response.cb_Payload.funcs.decode = actionslink_decode_to_mcu_message;
+    if ((actionslink_bt_ul_tx_rx(&message, &response) != 0) ||
+        (response.Payload.response.Response.get_paired_device_list.which_Result ==
+         ActionsLink_Bluetooth_ResponsePairedDeviceList_error_tag))
+    {
+        log_error("failed to get paired device list");
+        p_list->number_of_items = 0;
+        return -1;
+    }
+
+    return 0;
 }
 
 int actionslink_clear_bt_paired_device_list(void)
@@ -643,9 +787,8 @@ int actionslink_send_aux_connection_notification(bool is_connected)
     message.Payload.event.which_Event                = ActionsLink_FromMcuEvent_notify_aux_connected_tag;
     message.Payload.event.Event.notify_aux_connected = is_connected;
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "aux connection notification") != 0)
     {
         log_error("failed to send aux connection notification");
         return -1;
@@ -665,9 +808,8 @@ int actionslink_send_usb_connection_notification(bool is_connected)
     message.Payload.event.which_Event                = ActionsLink_FromMcuEvent_notify_usb_connected_tag;
     message.Payload.event.Event.notify_usb_connected = is_connected;
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "usb connection notification") != 0)
     {
         log_error("failed to send usb connection notification");
         return -1;
@@ -687,9 +829,8 @@ int actionslink_send_battery_level(uint8_t battery_level)
     message.Payload.event.which_Event                = ActionsLink_FromMcuEvent_notify_battery_level_tag;
     message.Payload.event.Event.notify_battery_level = battery_level;
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "battery level") != 0)
     {
         log_error("failed to send battery level");
         return -1;
@@ -729,11 +870,10 @@ int actionslink_send_charger_status(actionslink_charger_status_t status)
     message.Payload.event.which_Event                 = ActionsLink_FromMcuEvent_notify_charger_status_tag;
     message.Payload.event.Event.notify_charger_status = charger_status;
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "charger status") != 0)
     {
-        log_error("failed to send battery level");
+        log_error("failed to send charger status");
         return -1;
     }
     return 0;
@@ -751,9 +891,8 @@ int actionslink_send_battery_friendly_charging_notification(bool status)
     message.Payload.event.which_Event                            = ActionsLink_FromMcuEvent_notify_battery_friendly_charging_tag;
     message.Payload.event.Event.notify_battery_friendly_charging = status;
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "battery friendly charging notification") != 0)
     {
         log_error("failed to send battery friendly charging notification");
         return -1;
@@ -774,9 +913,8 @@ int actionslink_send_eco_mode_state(bool state)
     message.Payload.event.which_Event           = ActionsLink_FromMcuEvent_notify_eco_mode_tag;
     message.Payload.event.Event.notify_eco_mode = state;
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "eco mode state") != 0)
     {
         log_error("failed to send eco mode state");
         return -1;
@@ -796,9 +934,8 @@ int actionslink_send_color_id(actionslink_device_color_t color)
     message.Payload.event.which_Event        = ActionsLink_FromMcuEvent_notify_color_tag;
     message.Payload.event.Event.notify_color = to_pb_color(color);
 
-    // Nothing to do with the response, we just need to pass the buffer to the function
-    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
-    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    // Notifications are pipelined: the ACK is processed in the background
+    if (actionslink_bt_ul_tx_async(&message, on_notification_complete, "device color") != 0)
     {
         log_error("failed to send device color");
         return -1;
@@ -1421,3 +1558,31 @@ static bool is_driver_ready(void)
 
     return true;
 }
+
+static int request_uart_baudrate(uint32_t baudrate, uint32_t *p_accepted_baudrate)
+{
+    ActionsLink_FromMcu message                              = ActionsLink_FromMcu_init_zero;
+    message.which_Payload                                    = ActionsLink_FromMcu_request_tag;
+    message.Payload.request.seq                              = m_actionslink.next_sequence_id++;
+    message.Payload.request.which_Request                    = ActionsLink_FromMcuRequest_set_uart_config_tag;
+    message.Payload.request.Request.set_uart_config.baudrate = baudrate;
+
+    ActionsLink_ToMcu response = ActionsLink_ToMcu_init_zero;
+    if (actionslink_bt_ul_tx_rx(&message, &response) != 0)
+    {
+        return -1;
+    }
+
+    *p_accepted_baudrate = response.Payload.response.Response.set_uart_config.baudrate;
+    return 0;
+}
+
+static void on_notification_complete(int result, const ActionsLink_ToMcu *p_response, void *p_context)
+{
+    (void) p_response;
+    // -3: replaced by a newer notification of the same kind, which is delivered instead
+    if (result != 0 && result != -3)
+    {
+        log_error("failed to deliver %s (%d)", (const char *) p_context, result);
+    }
+}
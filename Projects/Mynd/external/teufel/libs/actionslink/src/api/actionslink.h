@@ -58,6 +58,8 @@ extern "C"
 
     /**
      * @brief Gets the firmware version of the Actions module.
+     * @note  The build string is written to the buffer `p_version->p_build_string` points to, truncated if needed.
+     *        It is skipped if `p_build_string` is NULL.
      *
      * @param[out] p_version    pointer to the version struct where the version data will be written to
      *
@@ -65,6 +67,36 @@ extern "C"
      */
     int actionslink_get_firmware_version(actionslink_firmware_version_t *p_version);
 
+    /**
+     * @brief Negotiates a faster UART baudrate with the Actions module.
+     * @note  The module answers with the highest baudrate it supports up to `max_baudrate` and switches to it
+     *        once it receives the ACK of that response. The MCU then switches as well and confirms the new
+     *        baudrate with a second request. If the confirmation fails, both sides fall back to
+     *        ACTIONSLINK_DEFAULT_BAUDRATE. Requires `set_baudrate_fn` in the driver configuration.
+     *        The transactions in flight are completed first. If they are not done within 1.5 s, the negotiation
+     *        fails without changing the baudrate.
+     *
+     * @param[in]  max_baudrate     highest baudrate to propose
+     * @param[out] p_baudrate       pointer to where the baudrate in use afterwards will be written to (can be NULL)
+     *
+     * @return 0 if successful, -1 otherwise
+     */
+    int actionslink_negotiate_uart_baudrate(uint32_t max_baudrate, uint32_t *p_baudrate);
+
+    /**
+     * @brief Gets the health counters of the link to the Actions module.
+     * @note  The counters survive `actionslink_init()`, so they cover every power cycle of the module
+     *        since startup or since the last `actionslink_reset_link_stats()`.
+     *
+     * @param[out] p_stats      pointer to where the counters will be written to
+     */
+    void actionslink_get_link_stats(actionslink_link_stats_t *p_stats);
+
+    /**
+     * @brief Resets the health counters of the link to the Actions module.
+     */
+    void actionslink_reset_link_stats(void);
+
     /**
      * @brief Sets the power state of the Actions module.
      *
@@ -352,6 +384,8 @@ extern "C"
 
     /**
      * @brief Sends a notification to the Actions module regarding the state of the aux connection.
+     * @note  Notifications do not wait for the ACK of the Actions module. Several of them can be in flight
+     *        at once, delivery failures are only logged.
      *
      * @param[in] is_connected      true if aux is connected, false otherwise
      *
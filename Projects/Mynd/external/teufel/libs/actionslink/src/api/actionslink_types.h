@@ -4,6 +4,11 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+/**
+ * @brief Baudrate the Actions module uses after boot and falls back to if the link becomes unreliable.
+ */
+#define ACTIONSLINK_DEFAULT_BAUDRATE (115200u)
+
 typedef enum
 {
     ACTIONSLINK_LOG_LEVEL_OFF,
@@ -67,6 +72,17 @@ typedef int (*actionslink_read_buffer_fn_t)(uint8_t *p_data, uint8_t length, uin
  */
 typedef void (*actionslink_task_yield_fn_t)(void);
 
+/**
+ * @brief Function to reconfigure the baudrate of the UART connected to the Actions module.
+ * @note  This is not a mandatory function and can be NULL if the baudrate can't be changed at runtime.
+ *        Bytes received at the old baudrate that are still buffered should be discarded.
+ *
+ * @param[in] baudrate      new baudrate
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+typedef int (*actionslink_set_baudrate_fn_t)(uint32_t baudrate);
+
 /**
  * @brief Function to get the current system timestamp in milliseconds.
  *
@@ -91,12 +107,71 @@ typedef struct actionslink_config
     actionslink_msp_deinit_fn_t   msp_deinit_fn;   // Optional function
     actionslink_task_yield_fn_t   task_yield_fn;   // Optional function
     actionslink_log_fn_t          log_fn;          // Optional function
+    actionslink_set_baudrate_fn_t set_baudrate_fn; // Optional function
     uint8_t                      *p_rx_buffer;
     uint8_t                      *p_tx_buffer;
     uint16_t                      rx_buffer_size;
     uint16_t                      tx_buffer_size;
 } actionslink_config_t;
 
+/**
+ * @brief Reasons carried by NACK frames, used as index of the NACK counters.
+ * @note  Index 0 counts NACKs with a reason unknown to this library.
+ */
+typedef enum
+{
+    ACTIONSLINK_NACK_REASON_UNKNOWN,
+    ACTIONSLINK_NACK_REASON_BAD_PACKET,
+    ACTIONSLINK_NACK_REASON_BAD_CRC,
+    ACTIONSLINK_NACK_REASON_INVALID_LENGTH,
+    ACTIONSLINK_NACK_REASON_BUSY,
+    ACTIONSLINK_NACK_REASON_COUNT,
+} actionslink_nack_reason_t;
+
+/**
+ * @brief Upper limits (exclusive, in ms) of the round trip time histogram buckets.
+ *        The last bucket counts everything from the last limit upwards.
+ */
+#define ACTIONSLINK_LINK_STATS_RTT_BUCKET_LIMITS_MS {5u, 10u, 20u, 50u, 100u, 200u, 300u}
+#define ACTIONSLINK_LINK_STATS_RTT_BUCKETS          (8u)
+
+/**
+ * @brief Number of distinct messages for which the maximum round trip time is tracked.
+ */
+#ifndef ACTIONSLINK_LINK_STATS_MAX_TRACKED_TAGS
+#define ACTIONSLINK_LINK_STATS_MAX_TRACKED_TAGS (8u)
+#endif
+
+typedef struct
+{
+    uint8_t  payload_type; // ActionsLink_FromMcu payload tag (request/response/event), 0 if the entry is unused
+    uint16_t tag;          // Tag of the request/response/event
+    uint16_t max_rtt_ms;   // Highest round trip time seen for this message
+} actionslink_tag_rtt_t;
+
+/**
+ * @brief Health counters of the link to the Actions module.
+ * @note  The round trip time is measured from the submission of a message until its ACK
+ *        (events, responses) or its response (requests), so it includes retransmissions.
+ *        Counters wrap around, readers should compare differences.
+ */
+typedef struct
+{
+    uint32_t              tx_frames;                                // Frames sent, including ACKs/NACKs
+    uint32_t              rx_frames;                                // Valid frames received, including ACKs/NACKs
+    uint32_t              acks_sent;
+    uint32_t              acks_received;
+    uint32_t              nacks_sent[ACTIONSLINK_NACK_REASON_COUNT];
+    uint32_t              nacks_received[ACTIONSLINK_NACK_REASON_COUNT];
+    uint32_t              retransmissions;
+    uint32_t              transaction_timeouts;                     // Messages given up after all retries
+    uint32_t              rx_timeouts;                              // Partially received frames discarded
+    uint32_t              rx_dropped_bytes;                         // Bytes of discarded or truncated frames
+    uint32_t              baudrate_fallbacks;
+    uint32_t              rtt_histogram[ACTIONSLINK_LINK_STATS_RTT_BUCKETS];
+    actionslink_tag_rtt_t max_rtt[ACTIONSLINK_LINK_STATS_MAX_TRACKED_TAGS]; // Sorted by descending round trip time
+} actionslink_link_stats_t;
+
 typedef enum
 {
     ACTIONSLINK_POWER_STATE_OFF,
@@ -10,6 +10,9 @@ static void log_decoder_error(const char *fn, const char *error)
     log_error("decoder: %s failed [%s]", fn, error);
 }
 
+static bool decode_paired_device_list_result(pb_istream_t *stream, const pb_field_t *field, void **arg);
+static bool decode_paired_device(pb_istream_t *stream, const pb_field_t *field, void **arg);
+
 bool actionslink_decode_to_mcu_message(pb_istream_t *stream, const pb_field_t *field, void **arg)
 {
     // The contents of the message can be accessed like this if needed
@@ -66,6 +69,19 @@ bool actionslink_decode_to_mcu_response_message(pb_istream_t *stream, const pb_f
         device_name->Result.name.funcs.decode = actionslink_decode_string;
         device_name->Result.name.arg = actual_arg;
     }
+    else if (field->tag == ActionsLink_ToMcuResponse_get_device_name_tag)
+    {
+        ActionsLink_Bluetooth_ResponseDeviceName *device_name = field->pData;
+        device_name->Result.name.funcs.decode = actionslink_decode_string;
+        device_name->Result.name.arg = actual_arg;
+    }
+    else if (field->tag == ActionsLink_ToMcuResponse_get_paired_device_list_tag)
+    {
+        // The list is a submessage within a oneof, so its callbacks can only be set once it is being decoded
+        ActionsLink_Bluetooth_ResponsePairedDeviceList *device_list = field->pData;
+        device_list->cb_Result.funcs.decode = decode_paired_device_list_result;
+        device_list->cb_Result.arg = actual_arg;
+    }
     else
     {
         return false;
@@ -94,22 +110,69 @@ bool actionslink_decode_string(pb_istream_t *stream, const pb_field_t *field, vo
 
     log_info("decoder: decoding string");
 
-    if (p_buffer_dsc->buffer_size < stream->bytes_left + 1) {
-        log_error("decoder: buffer too small: size is %d but %d bytes need to be stored", p_buffer_dsc->buffer_size, stream->bytes_left + 1);
+    // The string is copied straight from the RX buffer into the buffer of the caller,
+    // whatever does not fit (or is not wanted at all) is skipped without being copied
+    size_t size_to_read = 0;
+    if (p_buffer_dsc != NULL && p_buffer_dsc->p_buffer != NULL && p_buffer_dsc->buffer_size > 0)
+    {
+        size_to_read = (stream->bytes_left < p_buffer_dsc->buffer_size - 1u) ? stream->bytes_left
+                                                                             : p_buffer_dsc->buffer_size - 1u;
+        if (size_to_read < stream->bytes_left)
+        {
+            log_warning("decoder: string truncated to %d bytes (%d received)", size_to_read, stream->bytes_left);
+        }
+
+        if (!pb_read(stream, p_buffer_dsc->p_buffer, size_to_read))
+        {
+            log_decoder_error(__FUNCTION__, stream->errmsg);
+            return false;
+        }
+
+        // Null-terminate the string
+        p_buffer_dsc->p_buffer[size_to_read] = 0;
+    }
+
+    if (!pb_read(stream, NULL, stream->bytes_left))
+    {
+        log_decoder_error(__FUNCTION__, stream->errmsg);
         return false;
     }
+    return true;
+}
 
-    size_t size_to_read =
-        (stream->bytes_left < p_buffer_dsc->buffer_size - 1) ? stream->bytes_left : p_buffer_dsc->buffer_size - 1;
+static bool decode_paired_device_list_result(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+    (void) stream;
 
-    if (!pb_read(stream, p_buffer_dsc->p_buffer, size_to_read))
+    if (field->tag == ActionsLink_Bluetooth_ResponsePairedDeviceList_list_tag)
+    {
+        ActionsLink_Bluetooth_PairedDeviceList *device_list = field->pData;
+        device_list->devices.funcs.decode = decode_paired_device;
+        device_list->devices.arg = *arg;
+    }
+    return true;
+}
+
+static bool decode_paired_device(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+    (void) field;
+    actionslink_bt_paired_device_list_t *p_list = *((actionslink_bt_paired_device_list_t **) arg);
+
+    // Called once per device: each one is decoded on its own and only its address is kept
+    ActionsLink_Bluetooth_Device device = ActionsLink_Bluetooth_Device_init_zero;
+    if (!pb_decode(stream, ActionsLink_Bluetooth_Device_fields, &device))
     {
         log_decoder_error(__FUNCTION__, stream->errmsg);
         return false;
     }
 
-    // Null-terminate the string
-    p_buffer_dsc->p_buffer[size_to_read] = 0;
+    if (p_list->number_of_items >= p_list->list_size)
+    {
+        log_warning("decoder: paired device list full, dropping device");
+        return true;
+    }
+
+    p_list->p_list[p_list->number_of_items++] = device.address;
     return true;
 }
 
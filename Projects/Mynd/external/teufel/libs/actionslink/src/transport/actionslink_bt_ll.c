@@ -26,6 +26,9 @@
 #define PACKET_INDEX_HEADER_CRC         (7u)
 #define PACKET_INDEX_PAYLOAD_START      (8u)
 
+// Position of the payload within a TX frame, assuming that no header byte needs escaping
+#define FRAME_INDEX_PAYLOAD_START       (1u + PACKET_HEADER_SIZE)
+
 #define UART_TX_TIMEOUT_MS          (100u)
 #define UART_RX_TIMEOUT_MS          (100u)
 #define EXPECTED_BYTE_RX_TIMEOUT_MS (1u)
@@ -33,10 +36,23 @@
 #define PROCESS_FRAME_INCOMPLETE    (-1)
 #define PROCESS_FRAME_ERROR         (-2)
 
-#define NACK_REASON_BAD_PACKET      (1u)
-#define NACK_REASON_BAD_CRC         (2u)
-#define NACK_REASON_INVALID_LENGTH  (3u)
-#define NACK_REASON_BUSY            (4u)
+#define NACK_REASON_BAD_PACKET      (ACTIONSLINK_NACK_REASON_BAD_PACKET)
+#define NACK_REASON_BAD_CRC         (ACTIONSLINK_NACK_REASON_BAD_CRC)
+#define NACK_REASON_INVALID_LENGTH  (ACTIONSLINK_NACK_REASON_INVALID_LENGTH)
+#define NACK_REASON_BUSY            (ACTIONSLINK_NACK_REASON_BUSY)
+
+// A burst of corrupted frames at a negotiated baudrate means that the link is not reliable at that speed
+#define FRAME_ERROR_BURST_THRESHOLD (4u)
+#define FRAME_ERROR_BURST_WINDOW_MS (500u)
+
+// State of the nanopb output stream that escapes (and CRCs) the payload while it is being encoded
+typedef struct
+{
+    uint8_t *p_buffer;
+    size_t   size;
+    size_t   length;
+    uint8_t  crc;
+} escaped_ostream_state_t;
 
 typedef enum
 {
@@ -44,6 +60,18 @@ typedef enum
     TRANSPORT_STATE_ESCAPED_DATA,
 } transport_state_t;
 
+// Link statistics owned by this layer, the upper layer keeps the transaction related ones
+typedef struct
+{
+    uint32_t tx_frames;
+    uint32_t rx_frames;
+    uint32_t acks_sent;
+    uint32_t nacks_sent[ACTIONSLINK_NACK_REASON_COUNT];
+    uint32_t rx_timeouts;
+    uint32_t rx_dropped_bytes;
+    uint32_t baudrate_fallbacks;
+} bt_ll_stats_t;
+
 static struct
 {
     const actionslink_config_t *p_config;
@@ -51,21 +79,41 @@ static struct
     size_t                  received_data_length;
     size_t                  buffered_data_length;
     uint32_t                last_rx_timestamp;
+    uint32_t                baudrate;
+    uint8_t                 frame_errors_in_burst;
+    uint32_t                frame_error_burst_timestamp;
 } m_bt_ll;
 
+// Kept apart from the transport state, so the statistics survive reinitializations of the driver
+static bt_ll_stats_t m_stats;
+
 static void    reset_transport_state(void);
 static size_t  get_number_of_escaped_chars(const uint8_t *p_buffer, size_t length);
 static bool    is_escape_required(uint8_t byte);
+static size_t  escape_data(uint8_t *p_dst, const uint8_t *p_src, size_t length);
+static bool    escaped_ostream_write(pb_ostream_t *stream, const pb_byte_t *buf, size_t count);
 static uint8_t calculate_crc8(uint8_t crc, const uint8_t *p_buffer, size_t length);
 static int     process_received_byte(uint8_t byte, actionslink_bt_ll_rx_packet_t *p_packet);
 static int     validate_received_data(actionslink_bt_ll_rx_packet_t *p_packet);
 static int     send_ack(uint8_t transaction_id);
 static int     send_nack(uint8_t transaction_id, uint8_t nack_reason);
+static void    register_frame_error(void);
 
 void actionslink_bt_ll_init(const actionslink_config_t *p_config)
 {
     m_bt_ll.p_config = p_config;
     actionslink_bt_ll_reset();
+
+    // The Actions module always boots with the default baudrate
+    m_bt_ll.baudrate = 0;
+    if (m_bt_ll.p_config->set_baudrate_fn)
+    {
+        actionslink_bt_ll_set_baudrate(ACTIONSLINK_DEFAULT_BAUDRATE);
+    }
+    else
+    {
+        m_bt_ll.baudrate = ACTIONSLINK_DEFAULT_BAUDRATE;
+    }
 }
 
 void actionslink_bt_ll_reset(void)
@@ -76,97 +124,75 @@ void actionslink_bt_ll_reset(void)
 
 int actionslink_bt_ll_tx(const actionslink_bt_ll_tx_packet_t *p_packet)
 {
-    uint8_t *p_tx_buffer                     = m_bt_ll.p_config->p_tx_buffer;
-    uint16_t tx_buffer_size                  = m_bt_ll.p_config->tx_buffer_size;
-    p_tx_buffer[PACKET_INDEX_START_BYTE]     = PACKET_START_MAGIC_BYTE;
-    p_tx_buffer[PACKET_INDEX_PACKET_TYPE]    = (p_packet->value << 3) | p_packet->packet_type;
-    p_tx_buffer[PACKET_INDEX_TRANSACTION_ID] = p_packet->transaction_id;
-    p_tx_buffer[PACKET_INDEX_RESERVED]       = 0x00;
-
-    size_t payload_length;
+    uint8_t *p_tx_buffer    = m_bt_ll.p_config->p_tx_buffer;
+    uint16_t tx_buffer_size = m_bt_ll.p_config->tx_buffer_size;
+
+    // The payload is CRCed and escaped while it is encoded, right behind the space for the start delimiter
+    // and the header, without sizing it first. nanopb still sizes each nested submessage before writing it.
+    // The header depends on the payload, so it is patched in afterwards.
+    escaped_ostream_state_t payload = {
+        .p_buffer = &p_tx_buffer[FRAME_INDEX_PAYLOAD_START],
+        .size     = tx_buffer_size - FRAME_INDEX_PAYLOAD_START - 1,
+        .length   = 0,
+        .crc      = INITIAL_CRC8_VALUE,
+    };
+
+    size_t payload_length = 0;
     if (p_packet->p_payload != NULL)
     {
-        if (!pb_get_encoded_size(&payload_length, ActionsLink_FromMcu_fields, p_packet->p_payload))
-        {
-            log_error("bt_ll: failed to calculate encoded payload size");
-            return -1;
-        }
-
-        pb_ostream_t stream_out = pb_ostream_from_buffer(&p_tx_buffer[PACKET_INDEX_PAYLOAD_START], tx_buffer_size - PACKET_HEADER_SIZE);
+        pb_ostream_t stream_out = {
+            .callback      = escaped_ostream_write,
+            .state         = &payload,
+            .max_size      = SIZE_MAX,
+            .bytes_written = 0,
+        };
         if (!pb_encode(&stream_out, ActionsLink_FromMcu_fields, p_packet->p_payload))
         {
-            log_error("bt_ll: failed to encode payload");
+            log_error("bt_ll: failed to encode payload (%s)", PB_GET_ERROR(&stream_out));
             return -1;
         }
-
-        uint8_t payload_crc = calculate_crc8(INITIAL_CRC8_VALUE, &p_tx_buffer[PACKET_INDEX_PAYLOAD_START], payload_length);
-        p_tx_buffer[PACKET_INDEX_PAYLOAD_LENGTH_LSB] = payload_length & 0xFF;
-        p_tx_buffer[PACKET_INDEX_PAYLOAD_LENGTH_MSB] = (payload_length >> 8) & 0xFF;
-        p_tx_buffer[PACKET_INDEX_PAYLOAD_CRC] = payload_crc;
+        payload_length = stream_out.bytes_written;
     }
-    else
-    {
-        payload_length = 0;
-        p_tx_buffer[PACKET_INDEX_PAYLOAD_LENGTH_LSB] = 0;
-        p_tx_buffer[PACKET_INDEX_PAYLOAD_LENGTH_MSB] = 0;
-        p_tx_buffer[PACKET_INDEX_PAYLOAD_CRC] = INITIAL_CRC8_VALUE;
-    }
-
-    uint8_t header_crc = calculate_crc8(INITIAL_CRC8_VALUE, p_tx_buffer, PACKET_HEADER_SIZE - 1);
-    p_tx_buffer[PACKET_INDEX_HEADER_CRC] = header_crc;
 
-    size_t escaped_chars_in_header  = get_number_of_escaped_chars(p_tx_buffer, PACKET_HEADER_SIZE);
-    size_t escaped_chars_in_payload = get_number_of_escaped_chars(&p_tx_buffer[PACKET_INDEX_PAYLOAD_START], payload_length);
-
-    // The amount of data to send is header + payload,
-    // plus one extra byte per escaped byte
-    // plus 2 bytes for start/end frame delimiters,
-    size_t total_length = PACKET_HEADER_SIZE + payload_length + escaped_chars_in_header + escaped_chars_in_payload + 2;
+    uint8_t header[PACKET_HEADER_SIZE];
+    header[PACKET_INDEX_START_BYTE]         = PACKET_START_MAGIC_BYTE;
+    header[PACKET_INDEX_PACKET_TYPE]        = (p_packet->value << 3) | p_packet->packet_type;
+    header[PACKET_INDEX_TRANSACTION_ID]     = p_packet->transaction_id;
+    header[PACKET_INDEX_PAYLOAD_LENGTH_LSB] = payload_length & 0xFF;
+    header[PACKET_INDEX_PAYLOAD_LENGTH_MSB] = (payload_length >> 8) & 0xFF;
+    header[PACKET_INDEX_PAYLOAD_CRC]        = payload.crc;
+    header[PACKET_INDEX_RESERVED]           = 0x00;
+    header[PACKET_INDEX_HEADER_CRC]         = calculate_crc8(INITIAL_CRC8_VALUE, header, PACKET_HEADER_SIZE - 1);
+
+    // The amount of data to send is the escaped header + escaped payload,
+    // plus 2 bytes for start/end frame delimiters
+    size_t escaped_header_length = PACKET_HEADER_SIZE + get_number_of_escaped_chars(header, PACKET_HEADER_SIZE);
+    size_t total_length          = escaped_header_length + payload.length + 2;
     if (total_length > tx_buffer_size)
     {
         log_error("bt_ll: tx buffer is not large enough for tx (%d required)", total_length);
         return -1;
     }
 
-    // We reuse the same buffer to build the HDLC frame
-    // We start writing to the end of the buffer,
-    // moving the bytes from the end of the original payload
-    // to their final positions in the tx frame.
-    // The index of any given byte in the original payload is always
-    // lower than its index in the final tx frame, so this is safe
-    // i.e. payload[0] is always frame[1], payload[1] is always frame[2] or frame[3], ...
-    size_t index_in_escaped_array         = total_length - 1;
-    p_tx_buffer[index_in_escaped_array--] = HDLC_FRAME_DELIMITER;
-
-    uint32_t length_before_escaping_data = PACKET_HEADER_SIZE + payload_length;
-    for (int i = length_before_escaping_data - 1; i >= 0; i--)
+    // Rarely the header itself needs escaping, in which case the payload has to make room for it
+    if (escaped_header_length > PACKET_HEADER_SIZE)
     {
-        if (is_escape_required(p_tx_buffer[i]))
-        {
-            p_tx_buffer[index_in_escaped_array--] = p_tx_buffer[i] ^ HDLC_ESCAPE_MASK;
-            p_tx_buffer[index_in_escaped_array--] = HDLC_ESCAPE_CHARACTER;
-        }
-        else
-        {
-            p_tx_buffer[index_in_escaped_array--] = p_tx_buffer[i];
-        }
-    }
-
-    // After moving each byte in the payload to its respective index,
-    // we should have ended with index 0, where the frame delimiter goes
-    if (index_in_escaped_array != 0)
-    {
-        log_error("bt_ll: failed to construct tx frame");
-        return -1;
+        memmove(&p_tx_buffer[1 + escaped_header_length], payload.p_buffer, payload.length);
     }
 
     p_tx_buffer[0] = HDLC_FRAME_DELIMITER;
+    escape_data(&p_tx_buffer[1], header, PACKET_HEADER_SIZE);
+    p_tx_buffer[total_length - 1] = HDLC_FRAME_DELIMITER;
 
     int ret_val = m_bt_ll.p_config->write_buffer_fn(p_tx_buffer, total_length, UART_TX_TIMEOUT_MS);
     if (ret_val != 0)
     {
         log_error("bt_ll: failed to send data over UART");
     }
+    else
+    {
+        m_stats.tx_frames++;
+    }
 
     return ret_val;
 }
@@ -189,7 +215,9 @@ int actionslink_bt_ll_rx(actionslink_bt_ll_rx_packet_t *p_packet)
         // Return if there were any frame errors
         if (rx_result == PROCESS_FRAME_ERROR)
         {
+            m_stats.rx_dropped_bytes += m_bt_ll.received_data_length;
             reset_transport_state();
+            register_frame_error();
             return -1;
         }
     }
@@ -201,7 +229,12 @@ int actionslink_bt_ll_rx(actionslink_bt_ll_rx_packet_t *p_packet)
         {
             log_debug("bt_ll: timeout -> discarding partial frame (%d bytes)",
                         m_bt_ll.buffered_data_length);
+            m_stats.rx_timeouts++;
+            m_stats.rx_dropped_bytes += m_bt_ll.received_data_length;
             reset_transport_state();
+
+            // Garbage received at a wrong baudrate rarely contains frame delimiters
+            register_frame_error();
         }
     }
 
@@ -209,6 +242,93 @@ int actionslink_bt_ll_rx(actionslink_bt_ll_rx_packet_t *p_packet)
     return 0;
 }
 
+int actionslink_bt_ll_set_baudrate(uint32_t baudrate)
+{
+    if (m_bt_ll.p_config->set_baudrate_fn == NULL)
+    {
+        log_error("bt_ll: changing the baudrate is not supported");
+        return -1;
+    }
+
+    if (baudrate == m_bt_ll.baudrate)
+    {
+        return 0;
+    }
+
+    if (m_bt_ll.p_config->set_baudrate_fn(baudrate) != 0)
+    {
+        log_error("bt_ll: failed to set baudrate %d", baudrate);
+        return -1;
+    }
+
+    log_info("bt_ll: baudrate set to %d", baudrate);
+    m_bt_ll.baudrate              = baudrate;
+    m_bt_ll.frame_errors_in_burst = 0;
+
+    // Anything partially received belongs to the old baudrate
+    m_stats.rx_dropped_bytes += m_bt_ll.received_data_length;
+    reset_transport_state();
+    return 0;
+}
+
+uint32_t actionslink_bt_ll_get_baudrate(void)
+{
+    return m_bt_ll.baudrate;
+}
+
+void actionslink_bt_ll_report_link_loss(void)
+{
+    if (m_bt_ll.baudrate == ACTIONSLINK_DEFAULT_BAUDRATE)
+    {
+        return;
+    }
+
+    log_error("bt_ll: link lost at %d, falling back to the default baudrate", m_bt_ll.baudrate);
+    m_stats.baudrate_fallbacks++;
+    actionslink_bt_ll_set_baudrate(ACTIONSLINK_DEFAULT_BAUDRATE);
+}
+
+void actionslink_bt_ll_get_stats(actionslink_link_stats_t *p_stats)
+{
+    p_stats->tx_frames          = m_stats.tx_frames;
+    p_stats->rx_frames          = m_stats.rx_frames;
+    p_stats->acks_sent          = m_stats.acks_sent;
+    p_stats->rx_timeouts        = m_stats.rx_timeouts;
+    p_stats->rx_dropped_bytes   = m_stats.rx_dropped_bytes;
+    p_stats->baudrate_fallbacks = m_stats.baudrate_fallbacks;
+    memcpy(p_stats->nacks_sent, m_stats.nacks_sent, sizeof(p_stats->nacks_sent));
+}
+
+void actionslink_bt_ll_reset_stats(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+static void register_frame_error(void)
+{
+    if (m_bt_ll.baudrate == ACTIONSLINK_DEFAULT_BAUDRATE)
+    {
+        return;
+    }
+
+    if (m_bt_ll.frame_errors_in_burst == 0 ||
+        actionslink_utils_get_ms_since(m_bt_ll.frame_error_burst_timestamp) > FRAME_ERROR_BURST_WINDOW_MS)
+    {
+        m_bt_ll.frame_errors_in_burst       = 0;
+        m_bt_ll.frame_error_burst_timestamp = actionslink_utils_get_ms();
+    }
+
+    if (++m_bt_ll.frame_errors_in_burst >= FRAME_ERROR_BURST_THRESHOLD)
+    {
+        // The Actions module applies the same rule, so both sides end up at the default baudrate.
+        // If only one side detected the burst, the other one will see garbage and follow shortly after.
+        log_error("bt_ll: %d frame errors within %d ms, falling back to the default baudrate",
+                    m_bt_ll.frame_errors_in_burst, FRAME_ERROR_BURST_WINDOW_MS);
+        m_stats.baudrate_fallbacks++;
+        actionslink_bt_ll_set_baudrate(ACTIONSLINK_DEFAULT_BAUDRATE);
+    }
+}
+
 static void reset_transport_state(void)
 {
     m_bt_ll.received_data_length = 0;
@@ -324,6 +444,15 @@ static int validate_received_data(actionslink_bt_ll_rx_packet_t *p_packet) {
     uint8_t transaction_id = p_rx_data[PACKET_INDEX_TRANSACTION_ID];
     uint16_t payload_length = (p_rx_data[PACKET_INDEX_PAYLOAD_LENGTH_MSB] << 8) | p_rx_data[PACKET_INDEX_PAYLOAD_LENGTH_LSB];
 
+    // Never trust the length in the header beyond what was actually received
+    if (payload_length > m_bt_ll.buffered_data_length - PACKET_HEADER_SIZE)
+    {
+        log_error("bt_ll: invalid payload length (header %d, received %d)",
+                        payload_length, m_bt_ll.buffered_data_length - PACKET_HEADER_SIZE);
+        send_nack(0, NACK_REASON_INVALID_LENGTH);
+        return PROCESS_FRAME_ERROR;
+    }
+
     uint8_t calculated_payload_crc = calculate_crc8(INITIAL_CRC8_VALUE, &p_rx_data[PACKET_INDEX_PAYLOAD_START], payload_length);
     if (calculated_payload_crc != p_rx_data[PACKET_INDEX_PAYLOAD_CRC])
     {
@@ -367,6 +496,8 @@ static int validate_received_data(actionslink_bt_ll_rx_packet_t *p_packet) {
     p_packet->payload.p_raw_data = &p_rx_data[PACKET_INDEX_PAYLOAD_START];
     p_packet->payload.raw_data_length = payload_length;
 
+    m_stats.rx_frames++;
+
     const char * const packet_type_str = (packet_type == ACTIONSLINK_BT_LL_PACKET_TYPE_ACK) ? "ack" : "protobuf";
     log_debug("bt_ll: received %s packet with value %d (tx ID: %d)",
                     packet_type_str, value_for_packet_type, transaction_id);
@@ -401,6 +532,40 @@ static bool is_escape_required(uint8_t byte)
     return (byte == HDLC_FRAME_DELIMITER || byte == HDLC_ESCAPE_CHARACTER);
 }
 
+static size_t escape_data(uint8_t *p_dst, const uint8_t *p_src, size_t length)
+{
+    size_t escaped_length = 0;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (is_escape_required(p_src[i]))
+        {
+            p_dst[escaped_length++] = HDLC_ESCAPE_CHARACTER;
+            p_dst[escaped_length++] = p_src[i] ^ HDLC_ESCAPE_MASK;
+        }
+        else
+        {
+            p_dst[escaped_length++] = p_src[i];
+        }
+    }
+    return escaped_length;
+}
+
+static bool escaped_ostream_write(pb_ostream_t *stream, const pb_byte_t *buf, size_t count)
+{
+    escaped_ostream_state_t *p_state = stream->state;
+
+    // Worst case every byte needs escaping, only check precisely when close to the end of the buffer
+    if (p_state->length + 2 * count > p_state->size &&
+        p_state->length + count + get_number_of_escaped_chars(buf, count) > p_state->size)
+    {
+        PB_RETURN_ERROR(stream, "tx buffer too small");
+    }
+
+    p_state->crc = calculate_crc8(p_state->crc, buf, count);
+    p_state->length += escape_data(&p_state->p_buffer[p_state->length], buf, count);
+    return true;
+}
+
 // Lookup table for CRC-8 calculation
 // - POLY: 0x07
 // - INIT: 0x00
@@ -459,6 +624,7 @@ static int send_ack(uint8_t transaction_id)
         .p_payload = NULL,
     };
     log_debug("bt_ll: sending ack packet (tx ID: %d)", transaction_id);
+    m_stats.acks_sent++;
     return actionslink_bt_ll_tx(&packet);
 }
 
@@ -471,5 +637,6 @@ static int send_nack(uint8_t transaction_id, uint8_t reason)
         .p_payload      = NULL,
     };
     log_debug("bt_ll: sending nack packet (tx ID: %d)", transaction_id);
+    m_stats.nacks_sent[reason < ACTIONSLINK_NACK_REASON_COUNT ? reason : ACTIONSLINK_NACK_REASON_UNKNOWN]++;
     return actionslink_bt_ll_tx(&packet);
 }
@@ -67,3 +67,41 @@ int actionslink_bt_ll_tx(const actionslink_bt_ll_tx_packet_t *p_packet);
  *         -1 if a communication error occurred
  */
 int actionslink_bt_ll_rx(actionslink_bt_ll_rx_packet_t *p_packet);
+
+/**
+ * @brief Changes the baudrate of the link to the Actions module.
+ * @note  This only reconfigures the MCU side, the Actions module must be switched
+ *        beforehand (see `actionslink_negotiate_uart_baudrate()`).
+ *
+ * @param[in] baudrate          new baudrate
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int actionslink_bt_ll_set_baudrate(uint32_t baudrate);
+
+/**
+ * @brief Gets the baudrate currently used for the link to the Actions module.
+ *
+ * @return baudrate
+ */
+uint32_t actionslink_bt_ll_get_baudrate(void);
+
+/**
+ * @brief Reports that the Actions module stopped acknowledging messages.
+ * @note  At a negotiated baudrate this most likely means that the module fell back to the
+ *        default baudrate, so the link follows it.
+ */
+void actionslink_bt_ll_report_link_loss(void);
+
+/**
+ * @brief Gets the link statistics collected by the low layer.
+ * @note  Only the frame related fields of `p_stats` are written, the others are left untouched.
+ *
+ * @param[out] p_stats          pointer to where the statistics will be written to
+ */
+void actionslink_bt_ll_get_stats(actionslink_link_stats_t *p_stats);
+
+/**
+ * @brief Resets the link statistics collected by the low layer.
+ */
+void actionslink_bt_ll_reset_stats(void);
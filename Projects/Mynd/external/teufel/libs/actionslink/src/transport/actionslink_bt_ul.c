@@ -1,44 +1,102 @@
 #include "actionslink_bt_ul.h"
 #include "actionslink_bt_ll.h"
+#include "actionslink_decoders.h"
 #include "actionslink_log.h"
 #include "actionslink_utils.h"
+#include <string.h>
 
 #define MAX_NUMBER_OF_TX_RETRIES    (2u)
 #define MESSAGE_RESPONSE_TIMEOUT_MS (300u)
 
+#define TRANSACTION_RESULT_SUCCESS  (0)
+#define TRANSACTION_RESULT_ERROR    (-1)
+#define TRANSACTION_RESULT_TIMEOUT  (-2)
+#define TRANSACTION_RESULT_REPLACED (-3)
+
 typedef enum
 {
-    TRANSPORT_STATE_IDLE,
-    TRANSPORT_STATE_ACK,
-    TRANSPORT_STATE_RESPONSE,
-    TRANSPORT_STATE_SUCCESS,
-    TRANSPORT_STATE_ERROR,
-    TRANSPORT_STATE_TIMEOUT,
-} transport_state_t;
+    TRANSACTION_STATE_FREE,
+    TRANSACTION_STATE_ACK,
+    TRANSACTION_STATE_RESPONSE,
+} transaction_state_t;
+
+// A single outstanding message of the transmission window.
+// The message is kept so it can be retransmitted if the ACK/response does not arrive in time.
+typedef struct
+{
+    transaction_state_t              state;
+    uint16_t                         tag;
+    uint8_t                          transaction_id;
+    uint8_t                          attempts;
+    bool                             expect_response;
+    uint32_t                         seq;
+    uint32_t                         submit_order;
+    uint32_t                         timestamp;
+    uint32_t                         submit_timestamp;
+    ActionsLink_FromMcu              message;
+    ActionsLink_ToMcu               *p_response;
+    actionslink_bt_ul_completion_fn_t completion_fn;
+    void                            *p_context;
+} transaction_t;
+
+typedef struct
+{
+    bool              is_done;
+    int               result;
+    ActionsLink_ToMcu *p_response;
+} sync_transaction_t;
 
-static struct
+// Link statistics owned by this layer, the lower layer keeps the frame related ones
+typedef struct
 {
-    uint16_t tag;
-    uint8_t  transaction_id;
-    bool     expect_response;
-    uint32_t timestamp;
-} m_message;
+    uint32_t              acks_received;
+    uint32_t              nacks_received[ACTIONSLINK_NACK_REASON_COUNT];
+    uint32_t              retransmissions;
+    uint32_t              transaction_timeouts;
+    uint32_t              rtt_histogram[ACTIONSLINK_LINK_STATS_RTT_BUCKETS];
+    actionslink_tag_rtt_t max_rtt[ACTIONSLINK_LINK_STATS_MAX_TRACKED_TAGS];
+} bt_ul_stats_t;
+
+static const uint16_t m_rtt_bucket_limits_ms[] = ACTIONSLINK_LINK_STATS_RTT_BUCKET_LIMITS_MS;
+
+static transaction_t m_window[ACTIONSLINK_BT_UL_WINDOW_SIZE];
+
+// Kept apart from the transport state, so the statistics survive reinitializations of the driver
+static bt_ul_stats_t m_stats;
+
+// Scratch buffer used to decode received messages while a blocking call pumps the receiver
+static ActionsLink_ToMcu m_rx_message;
 
 static struct
 {
     const actionslink_config_t         *p_config;
     actionslink_bt_ul_event_handler_t   event_handler;
     actionslink_bt_ul_request_handler_t request_handler;
-    transport_state_t                   state;
-    uint8_t                             tx_retries;
     volatile bool                       stop_requested;
     uint8_t                             next_tx_transaction_id;
+    uint8_t                             pending_transactions;
+    uint32_t                            next_submit_order;
     bool                                within_event_handler;
+    bool                                within_rx;
+    pb_callback_t                       user_payload_decoder;
 } m_bt_ul;
 
-static transport_state_t transport_state_idle(const actionslink_bt_ll_rx_packet_t *p_packet);
-static transport_state_t transport_state_ack(const actionslink_bt_ll_rx_packet_t *p_packet);
-static transport_state_t transport_state_response(const actionslink_bt_ll_rx_packet_t *p_packet);
+static int            send_transaction(transaction_t *p_transaction);
+static transaction_t *find_free_transaction(void);
+static transaction_t *find_transaction_by_id(uint8_t transaction_id);
+static transaction_t *find_transaction_by_response(uint32_t seq, uint16_t tag);
+static transaction_t *find_event_transaction(uint16_t tag);
+static transaction_t *find_oldest_expired_transaction(void);
+static void           complete_transaction(transaction_t *p_transaction, int result, const ActionsLink_ToMcu *p_response);
+static void           record_round_trip_time(const transaction_t *p_transaction);
+static bool           process_packet(const actionslink_bt_ll_rx_packet_t *p_packet);
+static bool           process_timeouts(void);
+static void           expire_unacknowledged_transactions(void);
+static void           abort_transactions(void);
+static void           yield(void);
+static void           on_sync_transaction_complete(int result, const ActionsLink_ToMcu *p_response, void *p_context);
+static bool           decode_to_mcu_message(pb_istream_t *stream, const pb_field_t *field, void **arg);
+static bool           decode_to_mcu_response_message(pb_istream_t *stream, const pb_field_t *field, void **arg);
 
 void actionslink_bt_ul_init(const actionslink_config_t *p_config, actionslink_bt_ul_event_handler_t event_handler,
                             actionslink_bt_ul_request_handler_t request_handler)
@@ -47,16 +105,22 @@ void actionslink_bt_ul_init(const actionslink_config_t *p_config, actionslink_bt
     m_bt_ul.p_config               = p_config;
     m_bt_ul.event_handler          = event_handler;
     m_bt_ul.request_handler        = request_handler;
-    m_bt_ul.state                  = TRANSPORT_STATE_IDLE;
     m_bt_ul.stop_requested         = false;
-    m_bt_ul.tx_retries             = 0;
     m_bt_ul.next_tx_transaction_id = 0;
+    m_bt_ul.pending_transactions   = 0;
+    m_bt_ul.next_submit_order      = 0;
     m_bt_ul.within_event_handler   = false;
+    m_bt_ul.within_rx              = false;
+
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
+    {
+        m_window[i].state = TRANSACTION_STATE_FREE;
+    }
 }
 
 bool actionslink_bt_ul_is_busy(void)
 {
-    return m_bt_ul.state != TRANSPORT_STATE_IDLE;
+    return m_bt_ul.pending_transactions > 0;
 }
 
 void actionslink_bt_ul_stop_communication(void)
@@ -77,68 +141,60 @@ bool actionslink_bt_ul_is_communication_allowed(void) {
 
 int actionslink_bt_ul_tx_rx(ActionsLink_FromMcu *p_message, ActionsLink_ToMcu *p_response)
 {
-    // Do not process commands if a protocol stop was requested
-    if (m_bt_ul.stop_requested)
-    {
-        return -1;
-    }
-
     // Do not attempt to send a message if we are within an event handler
     // This may cause handling events within events within events, which ends up
     // causing handling events out of order, which may be important for the application
-    if (m_bt_ul.within_event_handler)
+    if (m_bt_ul.within_event_handler || m_bt_ul.within_rx)
     {
         log_error("bt_ul: can't send messages within an event handler");
         return -1;
     }
 
-    int result_rx;
-    m_bt_ul.tx_retries = 0;
-    do
+    sync_transaction_t sync = {
+        .is_done    = false,
+        .result     = TRANSACTION_RESULT_ERROR,
+        .p_response = p_response,
+    };
+
+    if (actionslink_bt_ul_tx_async(p_message, on_sync_transaction_complete, &sync) != 0)
     {
-        if (actionslink_bt_ul_tx(p_message) == 0)
-        {
-            do
-            {
-                // Keep processing received bytes until either we get the expected response or a timeout
-                result_rx = actionslink_bt_ul_rx(p_response);
-                // If we haven't received a response, yield the task and check again later
-                if (result_rx == 0)
-                {
-                    if (m_bt_ul.p_config->task_yield_fn)
-                    {
-                        m_bt_ul.p_config->task_yield_fn();
-                    }
-                }
-            } while (result_rx == 0);
+        return -1;
+    }
 
-            if (result_rx == 1)
-            {
-                log_debug("bt_ul: message sent and confirmed");
-                return 0;
-            }
+    // Keep processing received bytes until our transaction completes.
+    // Other outstanding transactions (and events) are processed in the meantime as well.
+    while (!sync.is_done)
+    {
+        if (m_bt_ul.stop_requested)
+        {
+            // The transaction references this stack frame, it must not outlive it
+            abort_transactions();
+            return -1;
         }
-        else
+
+        if (actionslink_bt_ul_rx(&m_rx_message) == 0 && !sync.is_done)
         {
-            // We failed to send the message, yield the task and try again later
-            if (m_bt_ul.p_config->task_yield_fn)
-            {
-                m_bt_ul.p_config->task_yield_fn();
-            }
+            yield();
         }
-        m_bt_ul.tx_retries++;
-        log_debug("bt_ul: tx attempt %d/%d failed", m_bt_ul.tx_retries,
-                    MAX_NUMBER_OF_TX_RETRIES);
-    } while (m_bt_ul.tx_retries < MAX_NUMBER_OF_TX_RETRIES && m_bt_ul.stop_requested == false);
+    }
 
-    log_error("bt_ul: tx failed (tag %d)", m_message.tag);
+    if (sync.result != TRANSACTION_RESULT_SUCCESS)
+    {
+        log_error("bt_ul: tx failed (result %d)", sync.result);
+        return -1;
+    }
 
-    // Failed to receive a response after timing out X times
-    // or RX failed because of something else other than a timeout
-    return -1;
+    log_debug("bt_ul: message sent and confirmed");
+    return 0;
 }
 
 int actionslink_bt_ul_tx(ActionsLink_FromMcu *p_message)
+{
+    return actionslink_bt_ul_tx_async(p_message, NULL, NULL);
+}
+
+int actionslink_bt_ul_tx_async(const ActionsLink_FromMcu *p_message, actionslink_bt_ul_completion_fn_t completion_fn,
+                               void *p_context)
 {
     // Do not process commands if a protocol stop was requested
     if (m_bt_ul.stop_requested)
@@ -146,60 +202,82 @@ int actionslink_bt_ul_tx(ActionsLink_FromMcu *p_message)
         return -1;
     }
 
-    // Guard against sending packets while we are expecting for responses
-    if (m_bt_ul.state != TRANSPORT_STATE_IDLE)
+    // Events are notifications of a state, only the newest value counts. An older event with the same tag that
+    // is still in flight is replaced instead of being retransmitted later, which could deliver the stale value
+    // after the newer one.
+    if (p_message->which_Payload == ActionsLink_FromMcu_event_tag)
     {
-        log_info("bt_ul: transport busy");
-        return -1;
+        transaction_t *p_older = find_event_transaction(p_message->Payload.event.which_Event);
+
+        // A blocking sender waits for the result of its own message, it is left alone
+        if (p_older != NULL && p_older->completion_fn != on_sync_transaction_complete)
+        {
+            log_debug("bt_ul: replacing the in-flight event with tag %d", p_older->tag);
+            complete_transaction(p_older, TRANSACTION_RESULT_REPLACED, NULL);
+        }
     }
 
-    m_bt_ul.state                 = TRANSPORT_STATE_ACK;
-    m_message.timestamp           = actionslink_utils_get_ms();
+    transaction_t *p_transaction = find_free_transaction();
+
+    // The window is full: keep processing received data until a slot is freed.
+    // This is not possible while we are already processing received data (e.g. within an event handler).
+    while (p_transaction == NULL)
+    {
+        if (m_bt_ul.within_rx || m_bt_ul.stop_requested)
+        {
+            log_info("bt_ul: transport busy");
+            return -1;
+        }
+
+        if (actionslink_bt_ul_rx(&m_rx_message) == 0)
+        {
+            yield();
+        }
+        p_transaction = find_free_transaction();
+    }
 
-    uint8_t sequence_number = 0;
     switch (p_message->which_Payload)
     {
         case ActionsLink_FromMcu_request_tag:
-            m_message.tag             = p_message->Payload.request.which_Request;
-            sequence_number           = p_message->Payload.request.seq;
-            m_message.expect_response = true;
+            p_transaction->tag             = p_message->Payload.request.which_Request;
+            p_transaction->seq             = p_message->Payload.request.seq;
+            p_transaction->expect_response = true;
             break;
         case ActionsLink_FromMcu_response_tag:
-            m_message.tag             = p_message->Payload.response.which_Response;
-            sequence_number           = p_message->Payload.response.seq;
-            m_message.expect_response = false;
+            p_transaction->tag             = p_message->Payload.response.which_Response;
+            p_transaction->seq             = p_message->Payload.response.seq;
+            p_transaction->expect_response = false;
             break;
         case ActionsLink_FromMcu_event_tag:
-            m_message.tag             = p_message->Payload.event.which_Event;
-            sequence_number           = 0;
-            m_message.expect_response = false;
+            p_transaction->tag             = p_message->Payload.event.which_Event;
+            p_transaction->seq             = 0;
+            p_transaction->expect_response = false;
             break;
         default:
             log_error("bt_ul: invalid message type %d", p_message->which_Payload);
             return -1;
     }
 
-    actionslink_bt_ll_tx_packet_t packet = {
-        .packet_type = ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF,
-        .value = 0,
-        .transaction_id = m_bt_ul.next_tx_transaction_id++,
-        .p_payload = p_message,
-    };
-
-    m_message.transaction_id = packet.transaction_id;
+    p_transaction->message          = *p_message;
+    p_transaction->attempts         = 0;
+    p_transaction->submit_timestamp = actionslink_utils_get_ms();
+    p_transaction->submit_order     = m_bt_ul.next_submit_order++;
+    p_transaction->completion_fn = completion_fn;
+    p_transaction->p_context     = p_context;
+    p_transaction->p_response    = NULL;
 
-    log_debug("bt_ul: sending packet (tx id %d, tag %d, seq %d)",
-                    m_message.transaction_id,
-                    m_message.tag,
-                    sequence_number);
+    if (completion_fn == on_sync_transaction_complete)
+    {
+        p_transaction->p_response = ((sync_transaction_t *) p_context)->p_response;
+    }
 
-    if (actionslink_bt_ll_tx(&packet) != 0)
+    if (send_transaction(p_transaction) != 0)
     {
-        m_bt_ul.state = TRANSPORT_STATE_IDLE;
         return -1;
     }
 
-    log_debug("bt_ul: tx successful");
+    p_transaction->state = TRANSACTION_STATE_ACK;
+    m_bt_ul.pending_transactions++;
     return 0;
 }
 
@@ -211,150 +289,271 @@ int actionslink_bt_ul_rx(ActionsLink_ToMcu *p_response)
         return -1;
     }
 
-    actionslink_bt_ll_rx_packet_t packet = {0};
-    packet.payload.p_message = p_response;
+    // Nested processing is not allowed, received messages must be handled in order
+    if (m_bt_ul.within_rx)
+    {
+        return 0;
+    }
+
+    m_bt_ul.within_rx = true;
+
+    // Callers not interested in the received messages share the scratch message of this module
+    // instead of each having their own copy on the stack
+    if (p_response == NULL)
+    {
+        p_response = &m_rx_message;
+        m_rx_message.cb_Payload.funcs.decode = NULL;
+        m_rx_message.cb_Payload.arg          = NULL;
+    }
+
+    // Received responses are routed to the decoders of the transaction they belong to,
+    // anything else goes to the decoder provided by the caller (if any)
+    m_bt_ul.user_payload_decoder = p_response->cb_Payload;
 
-    // Check if the lower layer received a complete message
-    int rx_result = actionslink_bt_ll_rx(&packet);
+    int  result    = 0;
+    bool completed = false;
+    int  rx_result;
 
-    // We received a message
-    if (rx_result == 1)
+    // Drain all the frames that are already available, so that a burst of ACKs
+    // frees the window in a single call
+    do
     {
-        log_debug("bt_ul: received ll packet (tx ID: %d)", packet.transaction_id);
+        actionslink_bt_ll_rx_packet_t packet = {0};
+        packet.payload.p_message             = p_response;
+
+        *p_response                       = (ActionsLink_ToMcu) ActionsLink_ToMcu_init_zero;
+        p_response->cb_Payload.funcs.decode = decode_to_mcu_message;
+        p_response->cb_Payload.arg          = &m_bt_ul.user_payload_decoder;
 
-        switch (m_bt_ul.state)
+        rx_result = actionslink_bt_ll_rx(&packet);
+        if (rx_result == 1)
         {
-            case TRANSPORT_STATE_IDLE:
-                m_bt_ul.state = transport_state_idle(&packet);
-                break;
-            case TRANSPORT_STATE_ACK:
-                m_bt_ul.state = transport_state_ack(&packet);
-                break;
-            case TRANSPORT_STATE_RESPONSE:
-                m_bt_ul.state = transport_state_response(&packet);
-                break;
-            default:
-                break;
+            log_debug("bt_ul: received ll packet (tx ID: %d)", packet.transaction_id);
+            completed |= process_packet(&packet);
         }
+        else if (rx_result == -1)
+        {
+            // Something went wrong in the lower layer, most likely we lost an ACK:
+            // do not wait for the full timeout before retransmitting
+            expire_unacknowledged_transactions();
+            result = -1;
+        }
+    } while (rx_result == 1 && !m_bt_ul.stop_requested);
+
+    // Restore the decoder of the caller
+    p_response->cb_Payload = m_bt_ul.user_payload_decoder;
+
+    completed |= process_timeouts();
+
+    m_bt_ul.within_rx = false;
+
+    if (result != 0)
+    {
+        return result;
     }
-    else if (rx_result == -1)
+    return completed ? 1 : 0;
+}
+
+void actionslink_bt_ul_get_stats(actionslink_link_stats_t *p_stats)
+{
+    p_stats->acks_received        = m_stats.acks_received;
+    p_stats->retransmissions      = m_stats.retransmissions;
+    p_stats->transaction_timeouts = m_stats.transaction_timeouts;
+    memcpy(p_stats->nacks_received, m_stats.nacks_received, sizeof(p_stats->nacks_received));
+    memcpy(p_stats->rtt_histogram, m_stats.rtt_histogram, sizeof(p_stats->rtt_histogram));
+    memcpy(p_stats->max_rtt, m_stats.max_rtt, sizeof(p_stats->max_rtt));
+}
+
+void actionslink_bt_ul_reset_stats(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+static int send_transaction(transaction_t *p_transaction)
+{
+    actionslink_bt_ll_tx_packet_t packet = {
+        .packet_type    = ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF,
+        .value          = 0,
+        .transaction_id = m_bt_ul.next_tx_transaction_id++,
+        .p_payload      = &p_transaction->message,
+    };
+
+    p_transaction->transaction_id = packet.transaction_id;
+    p_transaction->timestamp      = actionslink_utils_get_ms();
+    p_transaction->attempts++;
+
+    log_debug("bt_ul: sending packet (tx id %d, tag %d, seq %d, attempt %d)",
+                    p_transaction->transaction_id,
+                    p_transaction->tag,
+                    p_transaction->seq,
+                    p_transaction->attempts);
+
+    if (actionslink_bt_ll_tx(&packet) != 0)
     {
-        // Something went wrong in the lower layer
-        m_bt_ul.state = TRANSPORT_STATE_ERROR;
+        return -1;
     }
-    else
+
+    log_debug("bt_ul: tx successful");
+    return 0;
+}
+
+static transaction_t *find_free_transaction(void)
+{
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
     {
-        // We haven't received anything yet
-        // Check if we have a message in progress and check for response timeouts
-        if ((m_bt_ul.state == TRANSPORT_STATE_ACK) || (m_bt_ul.state == TRANSPORT_STATE_RESPONSE))
+        if (m_window[i].state == TRANSACTION_STATE_FREE)
         {
-            if (actionslink_utils_get_ms_since(m_message.timestamp) > MESSAGE_RESPONSE_TIMEOUT_MS)
-            {
-                log_debug("bt_ul: message with tag %d timed out: no response",
-                            m_message.tag);
-                m_bt_ul.state = TRANSPORT_STATE_TIMEOUT;
-            }
+            return &m_window[i];
         }
     }
+    return NULL;
+}
 
-    switch (m_bt_ul.state)
+static transaction_t *find_transaction_by_id(uint8_t transaction_id)
+{
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
     {
-        case TRANSPORT_STATE_SUCCESS:
-            m_bt_ul.state = TRANSPORT_STATE_IDLE;
-            return 1;
-        case TRANSPORT_STATE_ERROR:
-            m_bt_ul.state = TRANSPORT_STATE_IDLE;
-            return -1;
-        case TRANSPORT_STATE_TIMEOUT:
-            m_bt_ul.state = TRANSPORT_STATE_IDLE;
-            return -2;
-        default:
-            // Not done yet - keep the state as is
-            return 0;
+        if (m_window[i].state == TRANSACTION_STATE_ACK && m_window[i].transaction_id == transaction_id)
+        {
+            return &m_window[i];
+        }
     }
+    return NULL;
 }
 
-static transport_state_t transport_state_idle(const actionslink_bt_ll_rx_packet_t *p_packet)
+static transaction_t *find_transaction_by_response(uint32_t seq, uint16_t tag)
 {
-    const ActionsLink_ToMcu *p_message = p_packet->payload.p_message;
-    switch (p_packet->packet_type)
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
     {
-        case ACTIONSLINK_BT_LL_PACKET_TYPE_ACK:
-            log_warning("bt_ul: received unexpected ACK (tx ID: %d)", p_packet->transaction_id);
-            break;
+        // The response may overtake a lost ACK, so transactions still waiting for the ACK are considered as well
+        if (m_window[i].state != TRANSACTION_STATE_FREE && m_window[i].expect_response && m_window[i].seq == seq &&
+            m_window[i].tag == tag)
+        {
+            return &m_window[i];
+        }
+    }
+    return NULL;
+}
 
-        case ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF:
-            switch (p_message->which_Payload)
-            {
-                case ActionsLink_ToMcu_request_tag:
-                    log_debug("bt_ul: received request message");
-                    m_bt_ul.request_handler(&p_message->Payload.request, p_packet->payload.p_raw_data, p_packet->payload.raw_data_length);
-                    break;
+static transaction_t *find_event_transaction(uint16_t tag)
+{
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
+    {
+        if (m_window[i].state != TRANSACTION_STATE_FREE &&
+            m_window[i].message.which_Payload == ActionsLink_FromMcu_event_tag && m_window[i].tag == tag)
+        {
+            return &m_window[i];
+        }
+    }
+    return NULL;
+}
 
-                case ActionsLink_ToMcu_response_tag:
-                    log_warning("bt_ul: received unexpected response message (tag %d)",
-                                    p_message->Payload.response.which_Response);
-                    break;
+static transaction_t *find_oldest_expired_transaction(void)
+{
+    transaction_t *p_oldest = NULL;
 
-                case ActionsLink_ToMcu_event_tag:
-                    log_debug("bt_ul: received event message");
-                    m_bt_ul.within_event_handler = true;
-                    m_bt_ul.event_handler(&p_message->Payload.event, p_packet->payload.p_raw_data, p_packet->payload.raw_data_length);
-                    m_bt_ul.within_event_handler = false;
-                    break;
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
+    {
+        transaction_t *p_transaction = &m_window[i];
+        if (p_transaction->state == TRANSACTION_STATE_FREE ||
+            actionslink_utils_get_ms_since(p_transaction->timestamp) <= MESSAGE_RESPONSE_TIMEOUT_MS)
+        {
+            continue;
+        }
 
-                default:
-                    log_error("bt_ul: received invalid message type %d", p_message->which_Payload);
-                    break;
-            }
-            break;
+        // Freed slots are reused in any order, the submission counter tells which message is the oldest
+        if (p_oldest == NULL || (int32_t) (p_transaction->submit_order - p_oldest->submit_order) < 0)
+        {
+            p_oldest = p_transaction;
+        }
+    }
+    return p_oldest;
+}
 
-        default:
-            log_error("bt_ul: received invalid packet type %d", p_packet->packet_type);
-            break;
+static void complete_transaction(transaction_t *p_transaction, int result, const ActionsLink_ToMcu *p_response)
+{
+    // Free the slot before calling the completion function, so it can submit a new message right away
+    actionslink_bt_ul_completion_fn_t completion_fn = p_transaction->completion_fn;
+    void                             *p_context     = p_transaction->p_context;
 
+    if (result == TRANSACTION_RESULT_SUCCESS)
+    {
+        record_round_trip_time(p_transaction);
     }
 
-    return TRANSPORT_STATE_IDLE;
+    p_transaction->state = TRANSACTION_STATE_FREE;
+    m_bt_ul.pending_transactions--;
+
+    if (completion_fn)
+    {
+        completion_fn(result, p_response, p_context);
+    }
 }
 
-static transport_state_t transport_state_ack(const actionslink_bt_ll_rx_packet_t *p_packet)
+static bool process_packet(const actionslink_bt_ll_rx_packet_t *p_packet)
 {
     const ActionsLink_ToMcu *p_message = p_packet->payload.p_message;
+    transaction_t           *p_transaction;
+
     switch (p_packet->packet_type)
     {
         case ACTIONSLINK_BT_LL_PACKET_TYPE_ACK:
-
-            if (p_packet->transaction_id == m_message.transaction_id)
+            // NACKs carry the reason in the value and do not identify the rejected frame,
+            // so retransmit everything that has not been acknowledged yet
+            if (p_packet->value != 0)
             {
-                log_debug("bt_ul: received ACK (tx ID: %d)", p_packet->transaction_id);
-                if (m_message.expect_response)
-                {
-                    m_message.timestamp = actionslink_utils_get_ms();
-                    return TRANSPORT_STATE_RESPONSE;
-                }
-                return TRANSPORT_STATE_SUCCESS;
+                log_warning("bt_ul: received NACK (reason %d)", p_packet->value);
+                m_stats.nacks_received[p_packet->value < ACTIONSLINK_NACK_REASON_COUNT
+                                           ? p_packet->value
+                                           : ACTIONSLINK_NACK_REASON_UNKNOWN]++;
+                expire_unacknowledged_transactions();
+                break;
             }
-            else
+
+            m_stats.acks_received++;
+            p_transaction = find_transaction_by_id(p_packet->transaction_id);
+            if (p_transaction == NULL)
             {
-                log_warning("bt_ul: received ACK with invalid transaction ID (exp %d, recv %d)",
-                                m_message.transaction_id, p_packet->transaction_id);
+                log_warning("bt_ul: received unexpected ACK (tx ID: %d)", p_packet->transaction_id);
+                break;
             }
-            break;
 
+            log_debug("bt_ul: received ACK (tx ID: %d)", p_packet->transaction_id);
+            if (p_transaction->expect_response)
+            {
+                p_transaction->state     = TRANSACTION_STATE_RESPONSE;
+                p_transaction->timestamp = actionslink_utils_get_ms();
+                break;
+            }
+            complete_transaction(p_transaction, TRANSACTION_RESULT_SUCCESS, NULL);
+            return true;
 
         case ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF:
             switch (p_message->which_Payload)
             {
                 case ActionsLink_ToMcu_request_tag:
-                    log_warning("bt_ul: received request while waiting for ACK (tag %d)",
-                                    p_message->Payload.request.which_Request);
+                    log_debug("bt_ul: received request message");
+                    m_bt_ul.request_handler(&p_message->Payload.request, p_packet->payload.p_raw_data, p_packet->payload.raw_data_length);
                     break;
 
                 case ActionsLink_ToMcu_response_tag:
-                    log_warning("bt_ul: received response while waiting for ACK (tag %d)",
-                                    p_message->Payload.response.which_Response);
-                    break;
+                    p_transaction = find_transaction_by_response(p_message->Payload.response.seq,
+                                                                 p_message->Payload.response.which_Response);
+                    if (p_transaction == NULL)
+                    {
+                        log_warning("bt_ul: received unexpected response message (tag %d, seq %d)",
+                                        p_message->Payload.response.which_Response, p_message->Payload.response.seq);
+                        break;
+                    }
+
+                    log_debug("bt_ul: received response (tag %d)", p_message->Payload.response.which_Response);
+                    if (p_transaction->p_response)
+                    {
+                        p_transaction->p_response->which_Payload = p_message->which_Payload;
+                        p_transaction->p_response->Payload       = p_message->Payload;
+                    }
+                    complete_transaction(p_transaction, TRANSACTION_RESULT_SUCCESS, p_message);
+                    return true;
 
                 case ActionsLink_ToMcu_event_tag:
                     log_debug("bt_ul: received event message");
@@ -372,61 +571,165 @@ static transport_state_t transport_state_ack(const actionslink_bt_ll_rx_packet_t
         default:
             log_error("bt_ul: received invalid packet type %d", p_packet->packet_type);
             break;
+    }
+
+    return false;
+}
 
+static bool process_timeouts(void)
+{
+    bool           completed = false;
+    transaction_t *p_transaction;
+
+    // Retransmit in the order of submission, so the module receives the messages in the same order as the first
+    // time (e.g. after a NACK, which expires all unacknowledged messages at once). Every handled message gets a
+    // new timestamp or is completed, so each one is handled once.
+    while ((p_transaction = find_oldest_expired_transaction()) != NULL)
+    {
+        log_debug("bt_ul: message with tag %d timed out: no %s (attempt %d/%d)", p_transaction->tag,
+                    p_transaction->state == TRANSACTION_STATE_ACK ? "ACK" : "response",
+                    p_transaction->attempts, MAX_NUMBER_OF_TX_RETRIES);
+
+        // Retransmit with a new transaction ID, the sequence number stays the same
+        if (p_transaction->attempts < MAX_NUMBER_OF_TX_RETRIES && !m_bt_ul.stop_requested &&
+            send_transaction(p_transaction) == 0)
+        {
+            m_stats.retransmissions++;
+            p_transaction->state = TRANSACTION_STATE_ACK;
+            continue;
+        }
+
+        log_error("bt_ul: tx failed (tag %d)", p_transaction->tag);
+        m_stats.transaction_timeouts++;
+        actionslink_bt_ll_report_link_loss();
+        complete_transaction(p_transaction, TRANSACTION_RESULT_TIMEOUT, NULL);
+        completed = true;
     }
 
-    return TRANSPORT_STATE_ACK;
+    return completed;
 }
 
-static transport_state_t transport_state_response(const actionslink_bt_ll_rx_packet_t *p_packet)
+static void record_round_trip_time(const transaction_t *p_transaction)
 {
-    const ActionsLink_ToMcu *p_message = p_packet->payload.p_message;
-    switch (p_packet->packet_type)
+    uint32_t rtt_ms = actionslink_utils_get_ms_since(p_transaction->submit_timestamp);
+
+    size_t bucket = 0;
+    while (bucket < ACTIONSLINK_LINK_STATS_RTT_BUCKETS - 1 && rtt_ms >= m_rtt_bucket_limits_ms[bucket])
     {
-        case ACTIONSLINK_BT_LL_PACKET_TYPE_ACK:
-            log_warning("bt_ul: received ACK while waiting for response (tx ID: %d)", p_packet->transaction_id);
-            break;
+        bucket++;
+    }
+    m_stats.rtt_histogram[bucket]++;
 
-        case ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF:
-            switch (p_message->which_Payload)
-            {
-                case ActionsLink_ToMcu_request_tag:
-                    log_warning("bt_ul: received request while waiting for response (tag %d)",
-                                    p_message->Payload.request.which_Request);
-                    break;
+    uint16_t              clamped_rtt_ms = rtt_ms > UINT16_MAX ? UINT16_MAX : (uint16_t) rtt_ms;
+    uint8_t               payload_type   = p_transaction->message.which_Payload;
+    actionslink_tag_rtt_t *p_entries     = m_stats.max_rtt;
+    const size_t           n_entries     = ACTIONSLINK_LINK_STATS_MAX_TRACKED_TAGS;
 
-                case ActionsLink_ToMcu_response_tag:
-                    if (p_message->Payload.response.which_Response == m_message.tag)
-                    {
-                        log_debug("bt_ul: received response (tag %d)",
-                                        p_message->Payload.response.which_Response);
-                        return TRANSPORT_STATE_SUCCESS;
-                    }
-                    else
-                    {
-                        log_warning("bt_ul: received response with unexpected tag %d",
-                                        p_message->Payload.response.which_Response);
-                    }
-                    break;
+    // The table is sorted by descending round trip time and unused entries are at its end
+    size_t i = 0;
+    while (i < n_entries && p_entries[i].payload_type != 0 &&
+           (p_entries[i].payload_type != payload_type || p_entries[i].tag != p_transaction->tag))
+    {
+        i++;
+    }
 
-                case ActionsLink_ToMcu_event_tag:
-                    log_debug("bt_ul: received event message");
-                    m_bt_ul.within_event_handler = true;
-                    m_bt_ul.event_handler(&p_message->Payload.event, p_packet->payload.p_raw_data, p_packet->payload.raw_data_length);
-                    m_bt_ul.within_event_handler = false;
-                    break;
+    if (i == n_entries)
+    {
+        // Not tracked and no room left: replace the fastest tracked message, if this one is slower
+        i = n_entries - 1;
+    }
 
-                default:
-                    log_error("bt_ul: received invalid message type %d", p_message->which_Payload);
-                    break;
-            }
-            break;
+    if (p_entries[i].payload_type != 0 && p_entries[i].max_rtt_ms >= clamped_rtt_ms)
+    {
+        return;
+    }
 
-        default:
-            log_error("bt_ul: received invalid packet type %d", p_packet->packet_type);
-            break;
+    // Move the entry up to its sorted position
+    while (i > 0 && p_entries[i - 1].max_rtt_ms < clamped_rtt_ms)
+    {
+        p_entries[i] = p_entries[i - 1];
+        i--;
+    }
+
+    p_entries[i].payload_type = payload_type;
+    p_entries[i].tag          = p_transaction->tag;
+    p_entries[i].max_rtt_ms   = clamped_rtt_ms;
+}
+
+static void expire_unacknowledged_transactions(void)
+{
+    // Backdate the timestamps so the next timeout check retransmits these messages
+    uint32_t expired_timestamp = actionslink_utils_get_ms() - MESSAGE_RESPONSE_TIMEOUT_MS - 1u;
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
+    {
+        if (m_window[i].state == TRANSACTION_STATE_ACK)
+        {
+            m_window[i].timestamp = expired_timestamp;
+        }
+    }
+}
+
+static void abort_transactions(void)
+{
+    for (size_t i = 0; i < ACTIONSLINK_BT_UL_WINDOW_SIZE; i++)
+    {
+        if (m_window[i].state != TRANSACTION_STATE_FREE)
+        {
+            complete_transaction(&m_window[i], TRANSACTION_RESULT_ERROR, NULL);
+        }
+    }
+}
+
+static void yield(void)
+{
+    if (m_bt_ul.p_config->task_yield_fn)
+    {
+        m_bt_ul.p_config->task_yield_fn();
+    }
+}
 
+static void on_sync_transaction_complete(int result, const ActionsLink_ToMcu *p_response, void *p_context)
+{
+    (void) p_response;
+    sync_transaction_t *p_sync = p_context;
+    p_sync->result             = result;
+    p_sync->is_done            = true;
+}
+
+static bool decode_to_mcu_message(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+    const pb_callback_t *p_user_decoder = *((const pb_callback_t **) arg);
+
+    if (field->tag == ActionsLink_ToMcu_response_tag)
+    {
+        ActionsLink_ToMcuResponse *response = field->pData;
+        response->cb_Response.funcs.decode  = decode_to_mcu_response_message;
+        response->cb_Response.arg           = NULL;
+        return true;
+    }
+
+    if (p_user_decoder->funcs.decode)
+    {
+        void *user_arg = p_user_decoder->arg;
+        return p_user_decoder->funcs.decode(stream, field, &user_arg);
+    }
+    return true;
+}
+
+static bool decode_to_mcu_response_message(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+    (void) arg;
+
+    // The sequence number precedes the payload, so it is already decoded at this point
+    const ActionsLink_ToMcuResponse *response      = field->message;
+    transaction_t                   *p_transaction = find_transaction_by_response(response->seq, field->tag);
+
+    // Only the transaction that requested this response knows where to decode callback fields into
+    if (p_transaction == NULL || p_transaction->p_response == NULL ||
+        p_transaction->p_response->cb_Payload.funcs.decode == NULL)
+    {
+        return true;
     }
 
-    return TRANSPORT_STATE_RESPONSE;
+    return actionslink_decode_to_mcu_response_message(stream, field, &p_transaction->p_response->cb_Payload.arg);
 }
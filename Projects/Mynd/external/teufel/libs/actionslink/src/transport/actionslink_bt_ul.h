@@ -3,6 +3,17 @@
 #include "actionslink_types.h"
 #include "message.pb.h"
 
+/**
+ * @brief Maximum number of transactions that can be outstanding (sent, but not yet ACKed/responded to) at once.
+ * @note  Every slot of the window keeps a copy of the message to be able to retransmit it,
+ *        so this directly affects the RAM usage of the library: a slot is sizeof(ActionsLink_FromMcu) plus 44 bytes
+ *        of bookkeeping, i.e. WINDOW_SIZE x (sizeof(ActionsLink_FromMcu) + 44) bytes in total.
+ *        A window size of 1 reproduces the classic stop-and-wait behaviour.
+ */
+#ifndef ACTIONSLINK_BT_UL_WINDOW_SIZE
+#define ACTIONSLINK_BT_UL_WINDOW_SIZE (4u)
+#endif
+
 /**
  * @brief Handler for events sent by the Actions module.
  *
@@ -21,6 +32,16 @@ typedef void (*actionslink_bt_ul_event_handler_t)(const ActionsLink_ToMcuEvent *
  */
 typedef void (*actionslink_bt_ul_request_handler_t)(const ActionsLink_ToMcuRequest *p_request, const uint8_t *p_data, uint16_t data_length);
 
+/**
+ * @brief Function called once a transaction submitted with `actionslink_bt_ul_tx_async()` has completed.
+ *
+ * @param[in] result        0 if successful, -1 if the transaction failed, -2 if it timed out,
+ *                          -3 if the event was replaced by a newer one with the same tag before being ACKed
+ * @param[in] p_response    pointer to the received response (NULL if no response was expected or on failure)
+ * @param[in] p_context     user context passed on submission
+ */
+typedef void (*actionslink_bt_ul_completion_fn_t)(int result, const ActionsLink_ToMcu *p_response, void *p_context);
+
 /**
  * @brief Initializes the upper layer of the Actionslink transport.
  *
@@ -33,7 +54,7 @@ void actionslink_bt_ul_init(const actionslink_config_t *p_config, actionslink_bt
 /**
  * @brief Checks if the Actions upper transport layer is busy.
  *
- * @return true if busy, false otherwise
+ * @return true if there is at least one outstanding transaction, false otherwise
  */
 bool actionslink_bt_ul_is_busy(void);
 
@@ -45,6 +66,7 @@ void actionslink_bt_ul_stop(void);
 /**
  * @brief Sends a message and waits for the Actions module to send the ACK/confirmation response.
  * @note  This function validates that the response corresponds to the sent message.
+ *        Other transactions in the window keep progressing while waiting.
  *
  * @param[in]  p_message        pointer to message to send
  * @param[out] p_response       pointer to struct where the response should be written to
@@ -54,7 +76,9 @@ void actionslink_bt_ul_stop(void);
 int actionslink_bt_ul_tx_rx(ActionsLink_FromMcu *p_message, ActionsLink_ToMcu *p_response);
 
 /**
- * @brief Sends a command to the Actions module, expecting a response.
+ * @brief Sends a message to the Actions module without waiting for its ACK.
+ * @note  The ACK is processed (and the message retransmitted if needed) in subsequent
+ *        `actionslink_bt_ul_rx()` calls.
  *
  * @param[in] p_message         pointer to message to send
  *
@@ -63,14 +87,47 @@ int actionslink_bt_ul_tx_rx(ActionsLink_FromMcu *p_message, ActionsLink_ToMcu *p
 int actionslink_bt_ul_tx(ActionsLink_FromMcu *p_message);
 
 /**
- * @brief Processes received data and gets a response, if any.
+ * @brief Submits a message into the transaction window and returns as soon as it has been sent.
+ * @note  The message is copied into the window, so it does not need to outlive this call.
+ *        Memory referenced by encode callbacks of the message must stay valid until completion.
+ *        Events carry a state, so an event replaces a not yet ACKed one with the same tag (which completes
+ *        with -3): a retransmission of the older one could otherwise overwrite the newer value.
+ *        If the window is full, this function keeps processing received data until a slot is freed,
+ *        unless it is called from within an event/request handler, in which case it fails immediately.
+ *
+ * @param[in] p_message         pointer to message to send
+ * @param[in] completion_fn     function to call once the transaction completes (can be NULL)
+ * @param[in] p_context         user context passed to the completion function
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int actionslink_bt_ul_tx_async(const ActionsLink_FromMcu *p_message, actionslink_bt_ul_completion_fn_t completion_fn,
+                               void *p_context);
+
+/**
+ * @brief Processes received data, matches ACKs/responses to outstanding transactions
+ *        and handles per-transaction retransmissions and timeouts.
  * @note  This function must be called periodically.
  *        It also parses and triggers events to be handled by the application.
  *
- * @param[out] p_response       pointer to struct where the response should be written to
+ * @param[out] p_response       pointer to struct used as scratch buffer for decoding received messages,
+ *                              NULL to use the internal one (received messages are then only dispatched)
  *
- * @return  0 if nothing was received
- *          1 if a message was expected and received
- *         -1 if a message was expected, but something went wrong
+ * @return  0 if no transaction completed
+ *          1 if at least one transaction completed
+ *         -1 if a communication error occurred
  */
 int actionslink_bt_ul_rx(ActionsLink_ToMcu *p_response);
+
+/**
+ * @brief Gets the link statistics collected by the upper layer.
+ * @note  Only the transaction related fields of `p_stats` are written, the others are left untouched.
+ *
+ * @param[out] p_stats          pointer to where the statistics will be written to
+ */
+void actionslink_bt_ul_get_stats(actionslink_link_stats_t *p_stats);
+
+/**
+ * @brief Resets the link statistics collected by the upper layer.
+ */
+void actionslink_bt_ul_reset_stats(void);
@@ -0,0 +1,600 @@
+#include "actionslink_sim.h"
+#include "pb_encode.h"
+#include "pb_decode.h"
+#include <string.h>
+
+#define HDLC_FRAME_DELIMITER        (0x7Eu)
+#define HDLC_ESCAPE_CHARACTER       (0x7Du)
+#define HDLC_ESCAPE_MASK            (0x20u)
+
+#define PACKET_HEADER_SIZE          (8u)
+#define PACKET_START_MAGIC_BYTE     (0x55u)
+#define PACKET_TYPE_ACK             (0x00u)
+#define PACKET_TYPE_PROTOBUF        (0x01u)
+
+#define NACK_REASON_BAD_PACKET      (1u)
+#define NACK_REASON_BAD_CRC         (2u)
+#define NACK_REASON_INVALID_LENGTH  (3u)
+
+#define LINK_BUFFER_SIZE            (512u)
+#define PIPE_SIZE                   (8192u)
+#define BITS_PER_BYTE               (10u) // start + 8 data + stop bits
+
+// Same rules as the MCU side, see actionslink_bt_ll.c
+#define BAUDRATE_CONFIRM_TIMEOUT_NS (1000000000ull)
+#define FRAME_ERROR_BURST_THRESHOLD (4u)
+#define FRAME_ERROR_BURST_WINDOW_NS (500000000ull)
+#define RX_TIMEOUT_NS               (100000000ull)
+
+typedef struct
+{
+    uint64_t arrival_ns;
+    uint32_t baudrate; // Baudrate of the sender, a receiver using another baudrate only sees garbage
+    uint8_t  byte;
+} pipe_entry_t;
+
+typedef struct
+{
+    pipe_entry_t entries[PIPE_SIZE];
+    size_t       head;
+    size_t       count;
+    uint64_t     line_free_ns;
+} pipe_t;
+
+static struct
+{
+    actionslink_sim_config_t config;
+    actionslink_sim_stats_t  stats;
+    actionslink_config_t     link_config;
+    uint64_t                 now_ns;
+    uint32_t                 random_state;
+    uint32_t                 mcu_baudrate;
+    pipe_t                   to_module;
+    pipe_t                   to_mcu;
+
+    // Module state
+    uint32_t module_baudrate;
+    uint8_t  next_transaction_id;
+    uint8_t  rx_frame[LINK_BUFFER_SIZE];
+    size_t   rx_length;
+    uint64_t rx_timestamp_ns;
+    bool     rx_escaped;
+    bool     rx_overflow;
+    uint8_t  tx_frame[2 * LINK_BUFFER_SIZE];
+    uint8_t  tx_payload[LINK_BUFFER_SIZE];
+    bool     baudrate_switch_pending;
+    uint8_t  baudrate_switch_transaction_id;
+    uint32_t baudrate_switch_value;
+    bool     baudrate_confirm_pending;
+    uint64_t baudrate_confirm_deadline_ns;
+    uint8_t  frame_errors_in_burst;
+    uint64_t frame_error_burst_ns;
+} m_sim;
+
+static uint8_t m_mcu_rx_buffer[LINK_BUFFER_SIZE];
+static uint8_t m_mcu_tx_buffer[LINK_BUFFER_SIZE];
+
+static uint32_t next_random(void);
+static bool     roll_ppm(uint32_t ppm);
+static uint64_t get_byte_time_ns(uint32_t baudrate);
+static void     pipe_write(pipe_t *p_pipe, const uint8_t *p_data, size_t length, uint64_t start_ns, uint32_t baudrate);
+static bool     pipe_read(pipe_t *p_pipe, uint64_t until_ns, uint32_t rx_baudrate, uint8_t *p_byte);
+static bool     pipe_has_arrived(const pipe_t *p_pipe, size_t length, uint64_t until_ns);
+static uint8_t  calculate_crc8(uint8_t crc, const uint8_t *p_buffer, size_t length);
+static void     module_process_byte(uint8_t byte);
+static void     module_process_frame(void);
+static void     module_process_message(const ActionsLink_FromMcu *p_message);
+static void     module_reject_frame(uint8_t nack_reason);
+static void     module_register_frame_error(void);
+static void     module_set_baudrate(uint32_t baudrate);
+static int      module_send(uint8_t packet_type, uint8_t value, uint8_t transaction_id, const ActionsLink_ToMcu *p_message,
+                            uint64_t start_ns);
+
+static int      mcu_write_buffer(const uint8_t *p_data, uint8_t length, uint32_t timeout);
+static int      mcu_read_buffer(uint8_t *p_data, uint8_t length, uint32_t timeout);
+static uint32_t mcu_get_tick_ms(void);
+static void     mcu_task_yield(void);
+static int      mcu_set_baudrate(uint32_t baudrate);
+
+void actionslink_sim_init(const actionslink_sim_config_t *p_config)
+{
+    memset(&m_sim, 0, sizeof(m_sim));
+    m_sim.config          = *p_config;
+    m_sim.random_state    = p_config->seed ? p_config->seed : 1u;
+    m_sim.mcu_baudrate    = ACTIONSLINK_DEFAULT_BAUDRATE;
+    m_sim.module_baudrate = ACTIONSLINK_DEFAULT_BAUDRATE;
+
+    m_sim.link_config = (actionslink_config_t) {
+        .write_buffer_fn = mcu_write_buffer,
+        .read_buffer_fn  = mcu_read_buffer,
+        .get_tick_ms_fn  = mcu_get_tick_ms,
+        .task_yield_fn   = mcu_task_yield,
+        .set_baudrate_fn = mcu_set_baudrate,
+        .p_rx_buffer     = m_mcu_rx_buffer,
+        .p_tx_buffer     = m_mcu_tx_buffer,
+        .rx_buffer_size  = sizeof(m_mcu_rx_buffer),
+        .tx_buffer_size  = sizeof(m_mcu_tx_buffer),
+    };
+}
+
+actionslink_config_t *actionslink_sim_get_link_config(void)
+{
+    return &m_sim.link_config;
+}
+
+int actionslink_sim_boot(void)
+{
+    ActionsLink_ToMcuEvent event = {0};
+    event.which_Event            = ActionsLink_ToMcuEvent_notify_system_ready_tag;
+    return actionslink_sim_send_event(&event);
+}
+
+int actionslink_sim_send_event(const ActionsLink_ToMcuEvent *p_event)
+{
+    ActionsLink_ToMcu message = ActionsLink_ToMcu_init_zero;
+    message.which_Payload     = ActionsLink_ToMcu_event_tag;
+    message.Payload.event     = *p_event;
+    return module_send(PACKET_TYPE_PROTOBUF, 0, m_sim.next_transaction_id++, &message, m_sim.now_ns);
+}
+
+void actionslink_sim_advance(uint32_t us)
+{
+    uint64_t target_ns = m_sim.now_ns + (uint64_t) us * 1000u;
+
+    // Bytes are processed at the time they arrive, so that the responses are timed correctly
+    while (pipe_has_arrived(&m_sim.to_module, 1, target_ns))
+    {
+        const pipe_entry_t *p_entry = &m_sim.to_module.entries[m_sim.to_module.head];
+        if (p_entry->arrival_ns > m_sim.now_ns)
+        {
+            m_sim.now_ns = p_entry->arrival_ns;
+        }
+
+        // The UART of the module reports bytes sent at another baudrate as framing errors
+        bool    is_framing_error = p_entry->baudrate != m_sim.module_baudrate;
+        uint8_t byte;
+        pipe_read(&m_sim.to_module, m_sim.now_ns, m_sim.module_baudrate, &byte);
+        if (is_framing_error)
+        {
+            module_register_frame_error();
+            continue;
+        }
+        module_process_byte(byte);
+    }
+
+    m_sim.now_ns = target_ns;
+
+    if (m_sim.rx_length > 0 && m_sim.now_ns - m_sim.rx_timestamp_ns > RX_TIMEOUT_NS)
+    {
+        m_sim.rx_length  = 0;
+        m_sim.rx_escaped = false;
+        module_register_frame_error();
+    }
+
+    // Without the confirmation the module returns to the default baudrate on its own
+    if (m_sim.baudrate_confirm_pending && m_sim.now_ns >= m_sim.baudrate_confirm_deadline_ns)
+    {
+        m_sim.baudrate_confirm_pending = false;
+        module_set_baudrate(ACTIONSLINK_DEFAULT_BAUDRATE);
+    }
+}
+
+uint64_t actionslink_sim_get_us(void)
+{
+    return m_sim.now_ns / 1000u;
+}
+
+uint32_t actionslink_sim_get_module_baudrate(void)
+{
+    return m_sim.module_baudrate;
+}
+
+const actionslink_sim_stats_t *actionslink_sim_get_stats(void)
+{
+    return &m_sim.stats;
+}
+
+// xorshift32, good enough to spread impairments and reproducible across platforms
+static uint32_t next_random(void)
+{
+    uint32_t x = m_sim.random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_sim.random_state = x;
+    return x;
+}
+
+static bool roll_ppm(uint32_t ppm)
+{
+    return ppm > 0 && (next_random() % 1000000u) < ppm;
+}
+
+static uint64_t get_byte_time_ns(uint32_t baudrate)
+{
+    return baudrate ? (BITS_PER_BYTE * 1000000000ull) / baudrate : 0;
+}
+
+static void pipe_write(pipe_t *p_pipe, const uint8_t *p_data, size_t length, uint64_t start_ns, uint32_t baudrate)
+{
+    uint64_t byte_time_ns = get_byte_time_ns(baudrate);
+
+    if (p_pipe->line_free_ns < start_ns)
+    {
+        p_pipe->line_free_ns = start_ns;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        // Lost bytes still occupy the line
+        p_pipe->line_free_ns += byte_time_ns;
+
+        if (roll_ppm(m_sim.config.loss_ppm))
+        {
+            m_sim.stats.bytes_lost++;
+            continue;
+        }
+
+        if (p_pipe->count == PIPE_SIZE)
+        {
+            m_sim.stats.bytes_overflowed++;
+            continue;
+        }
+
+        uint8_t byte = p_data[i];
+        if (roll_ppm(m_sim.config.corruption_ppm))
+        {
+            byte ^= 1u << (next_random() % 8u);
+            m_sim.stats.bytes_corrupted++;
+        }
+
+        pipe_entry_t *p_entry = &p_pipe->entries[(p_pipe->head + p_pipe->count) % PIPE_SIZE];
+        p_entry->arrival_ns   = p_pipe->line_free_ns + (uint64_t) m_sim.config.latency_us * 1000u;
+        p_entry->baudrate     = baudrate;
+        p_entry->byte         = byte;
+        p_pipe->count++;
+    }
+}
+
+static bool pipe_read(pipe_t *p_pipe, uint64_t until_ns, uint32_t rx_baudrate, uint8_t *p_byte)
+{
+    if (!pipe_has_arrived(p_pipe, 1, until_ns))
+    {
+        return false;
+    }
+
+    const pipe_entry_t *p_entry = &p_pipe->entries[p_pipe->head];
+    *p_byte = (p_entry->baudrate == rx_baudrate) ? p_entry->byte : (uint8_t) next_random();
+
+    p_pipe->head = (p_pipe->head + 1) % PIPE_SIZE;
+    p_pipe->count--;
+    return true;
+}
+
+static bool pipe_has_arrived(const pipe_t *p_pipe, size_t length, uint64_t until_ns)
+{
+    // Bytes arrive in order, so checking the last one is enough
+    return length <= p_pipe->count &&
+           (length == 0 || p_pipe->entries[(p_pipe->head + length - 1) % PIPE_SIZE].arrival_ns <= until_ns);
+}
+
+static uint8_t calculate_crc8(uint8_t crc, const uint8_t *p_buffer, size_t length)
+{
+    while (length--)
+    {
+        crc ^= *p_buffer++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x80u) ? (uint8_t) ((crc << 1) ^ 0x07u) : (uint8_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void module_process_byte(uint8_t byte)
+{
+    m_sim.rx_timestamp_ns = m_sim.now_ns;
+
+    if (byte == HDLC_FRAME_DELIMITER)
+    {
+        if (m_sim.rx_length > 0 || m_sim.rx_overflow)
+        {
+            module_process_frame();
+        }
+        m_sim.rx_length   = 0;
+        m_sim.rx_escaped  = false;
+        m_sim.rx_overflow = false;
+    }
+    else if (byte == HDLC_ESCAPE_CHARACTER)
+    {
+        m_sim.rx_escaped = true;
+    }
+    else if (m_sim.rx_length < sizeof(m_sim.rx_frame))
+    {
+        m_sim.rx_frame[m_sim.rx_length++] = m_sim.rx_escaped ? (byte ^ HDLC_ESCAPE_MASK) : byte;
+        m_sim.rx_escaped                  = false;
+    }
+    else
+    {
+        m_sim.rx_overflow = true;
+    }
+}
+
+static void module_process_frame(void)
+{
+    const uint8_t *p_frame = m_sim.rx_frame;
+
+    if (m_sim.rx_overflow || m_sim.rx_length < PACKET_HEADER_SIZE)
+    {
+        module_reject_frame(NACK_REASON_INVALID_LENGTH);
+        return;
+    }
+
+    if (calculate_crc8(0, p_frame, PACKET_HEADER_SIZE - 1) != p_frame[7])
+    {
+        module_reject_frame(NACK_REASON_BAD_CRC);
+        return;
+    }
+
+    uint8_t  packet_type    = p_frame[1] & 0x07u;
+    uint8_t  value          = p_frame[1] >> 3;
+    uint8_t  transaction_id = p_frame[2];
+    uint16_t payload_length = (uint16_t) (p_frame[3] | (p_frame[4] << 8));
+
+    if (p_frame[0] != PACKET_START_MAGIC_BYTE || packet_type > PACKET_TYPE_PROTOBUF)
+    {
+        module_reject_frame(NACK_REASON_BAD_PACKET);
+        return;
+    }
+
+    if (payload_length > m_sim.rx_length - PACKET_HEADER_SIZE)
+    {
+        module_reject_frame(NACK_REASON_INVALID_LENGTH);
+        return;
+    }
+
+    if (calculate_crc8(0, &p_frame[PACKET_HEADER_SIZE], payload_length) != p_frame[5])
+    {
+        module_reject_frame(NACK_REASON_BAD_CRC);
+        return;
+    }
+
+    if (packet_type == PACKET_TYPE_ACK)
+    {
+        m_sim.stats.frames_to_module++;
+        if (value != 0)
+        {
+            m_sim.stats.nacks++;
+            return;
+        }
+
+        m_sim.stats.acks++;
+        if (m_sim.baudrate_switch_pending && transaction_id == m_sim.baudrate_switch_transaction_id)
+        {
+            m_sim.baudrate_switch_pending = false;
+            if (m_sim.baudrate_switch_value != m_sim.module_baudrate)
+            {
+                module_set_baudrate(m_sim.baudrate_switch_value);
+                m_sim.baudrate_confirm_pending     = true;
+                m_sim.baudrate_confirm_deadline_ns = m_sim.now_ns + BAUDRATE_CONFIRM_TIMEOUT_NS;
+            }
+        }
+        return;
+    }
+
+    ActionsLink_FromMcu message = ActionsLink_FromMcu_init_zero;
+    pb_istream_t        stream  = pb_istream_from_buffer(&p_frame[PACKET_HEADER_SIZE], payload_length);
+    if (payload_length == 0 || !pb_decode(&stream, ActionsLink_FromMcu_fields, &message))
+    {
+        module_reject_frame(NACK_REASON_BAD_PACKET);
+        return;
+    }
+
+    m_sim.stats.frames_to_module++;
+    module_send(PACKET_TYPE_ACK, 0, transaction_id, NULL, m_sim.now_ns);
+    module_process_message(&message);
+}
+
+static void module_process_message(const ActionsLink_FromMcu *p_message)
+{
+    switch (p_message->which_Payload)
+    {
+        case ActionsLink_FromMcu_request_tag:
+        {
+            const ActionsLink_FromMcuRequest *p_request = &p_message->Payload.request;
+            m_sim.stats.requests++;
+
+            // Requests and their responses share the same tag numbers
+            ActionsLink_ToMcu response               = ActionsLink_ToMcu_init_zero;
+            response.which_Payload                   = ActionsLink_ToMcu_response_tag;
+            response.Payload.response.seq            = p_request->seq;
+            response.Payload.response.which_Response = p_request->which_Request;
+
+            uint8_t transaction_id = m_sim.next_transaction_id++;
+            if (p_request->which_Request == ActionsLink_FromMcuRequest_set_uart_config_tag)
+            {
+                uint32_t baudrate = p_request->Request.set_uart_config.baudrate;
+                if (baudrate > m_sim.config.max_baudrate)
+                {
+                    baudrate = m_sim.config.max_baudrate;
+                }
+                if (baudrate < ACTIONSLINK_DEFAULT_BAUDRATE)
+                {
+                    baudrate = ACTIONSLINK_DEFAULT_BAUDRATE;
+                }
+                response.Payload.response.Response.set_uart_config.baudrate = baudrate;
+
+                // A request at the current baudrate confirms it
+                if (baudrate == m_sim.module_baudrate)
+                {
+                    m_sim.baudrate_confirm_pending = false;
+                }
+                m_sim.baudrate_switch_pending        = true;
+                m_sim.baudrate_switch_transaction_id = transaction_id;
+                m_sim.baudrate_switch_value          = baudrate;
+            }
+
+            module_send(PACKET_TYPE_PROTOBUF, 0, transaction_id, &response,
+                        m_sim.now_ns + (uint64_t) m_sim.config.response_delay_us * 1000u);
+            break;
+        }
+
+        case ActionsLink_FromMcu_response_tag:
+            m_sim.stats.responses++;
+            break;
+
+        case ActionsLink_FromMcu_event_tag:
+            m_sim.stats.events++;
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void module_reject_frame(uint8_t nack_reason)
+{
+    m_sim.stats.bad_frames++;
+    module_send(PACKET_TYPE_ACK, nack_reason, 0, NULL, m_sim.now_ns);
+    module_register_frame_error();
+}
+
+static void module_register_frame_error(void)
+{
+    if (m_sim.module_baudrate == ACTIONSLINK_DEFAULT_BAUDRATE)
+    {
+        return;
+    }
+
+    if (m_sim.frame_errors_in_burst == 0 || m_sim.now_ns - m_sim.frame_error_burst_ns > FRAME_ERROR_BURST_WINDOW_NS)
+    {
+        m_sim.frame_errors_in_burst = 0;
+        m_sim.frame_error_burst_ns  = m_sim.now_ns;
+    }
+
+    if (++m_sim.frame_errors_in_burst >= FRAME_ERROR_BURST_THRESHOLD)
+    {
+        m_sim.baudrate_confirm_pending = false;
+        module_set_baudrate(ACTIONSLINK_DEFAULT_BAUDRATE);
+    }
+}
+
+static void module_set_baudrate(uint32_t baudrate)
+{
+    m_sim.module_baudrate       = baudrate;
+    m_sim.frame_errors_in_burst = 0;
+    m_sim.rx_length             = 0;
+    m_sim.rx_escaped            = false;
+}
+
+static size_t escape_data(uint8_t *p_dst, const uint8_t *p_src, size_t length)
+{
+    size_t escaped_length = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        if (p_src[i] == HDLC_FRAME_DELIMITER || p_src[i] == HDLC_ESCAPE_CHARACTER)
+        {
+            p_dst[escaped_length++] = HDLC_ESCAPE_CHARACTER;
+            p_dst[escaped_length++] = p_src[i] ^ HDLC_ESCAPE_MASK;
+        }
+        else
+        {
+            p_dst[escaped_length++] = p_src[i];
+        }
+    }
+    return escaped_length;
+}
+
+static int module_send(uint8_t packet_type, uint8_t value, uint8_t transaction_id, const ActionsLink_ToMcu *p_message,
+                       uint64_t start_ns)
+{
+    size_t payload_length = 0;
+    if (p_message != NULL)
+    {
+        pb_ostream_t stream = pb_ostream_from_buffer(m_sim.tx_payload, sizeof(m_sim.tx_payload));
+        if (!pb_encode(&stream, ActionsLink_ToMcu_fields, p_message))
+        {
+            return -1;
+        }
+        payload_length = stream.bytes_written;
+    }
+
+    uint8_t header[PACKET_HEADER_SIZE] = {
+        PACKET_START_MAGIC_BYTE,
+        (uint8_t) ((value << 3) | packet_type),
+        transaction_id,
+        (uint8_t) (payload_length & 0xFFu),
+        (uint8_t) (payload_length >> 8),
+        calculate_crc8(0, m_sim.tx_payload, payload_length),
+        0x00,
+        0x00,
+    };
+    header[7] = calculate_crc8(0, header, PACKET_HEADER_SIZE - 1);
+
+    size_t length            = 0;
+    m_sim.tx_frame[length++] = HDLC_FRAME_DELIMITER;
+    length += escape_data(&m_sim.tx_frame[length], header, PACKET_HEADER_SIZE);
+    length += escape_data(&m_sim.tx_frame[length], m_sim.tx_payload, payload_length);
+    m_sim.tx_frame[length++] = HDLC_FRAME_DELIMITER;
+
+    m_sim.stats.frames_to_mcu++;
+    m_sim.stats.bytes_to_mcu += length;
+    pipe_write(&m_sim.to_mcu, m_sim.tx_frame, length, start_ns, m_sim.module_baudrate);
+    return 0;
+}
+
+static int mcu_write_buffer(const uint8_t *p_data, uint8_t length, uint32_t timeout)
+{
+    (void) timeout;
+    m_sim.stats.bytes_to_module += length;
+    pipe_write(&m_sim.to_module, p_data, length, m_sim.now_ns, m_sim.mcu_baudrate);
+    return 0;
+}
+
+static int mcu_read_buffer(uint8_t *p_data, uint8_t length, uint32_t timeout)
+{
+    (void) timeout;
+    if (!pipe_has_arrived(&m_sim.to_mcu, length, m_sim.now_ns))
+    {
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+        pipe_read(&m_sim.to_mcu, m_sim.now_ns, m_sim.mcu_baudrate, &p_data[i]);
+    }
+    return 0;
+}
+
+static uint32_t mcu_get_tick_ms(void)
+{
+    return (uint32_t) (m_sim.now_ns / 1000000u);
+}
+
+static void mcu_task_yield(void)
+{
+    // Skip ahead to the next byte for the MCU, but keep the timeouts of the library accurate
+    uint64_t step_ns = 1000000u;
+    if (m_sim.to_mcu.count > 0)
+    {
+        uint64_t arrival_ns = m_sim.to_mcu.entries[m_sim.to_mcu.head].arrival_ns;
+        if (arrival_ns > m_sim.now_ns && arrival_ns - m_sim.now_ns < step_ns)
+        {
+            step_ns = arrival_ns - m_sim.now_ns;
+        }
+    }
+
+    actionslink_sim_advance((uint32_t) ((step_ns + 999u) / 1000u));
+}
+
+static int mcu_set_baudrate(uint32_t baudrate)
+{
+    // Bytes that were already received at the old baudrate are discarded, as the BSP does
+    uint8_t byte;
+    while (pipe_read(&m_sim.to_mcu, m_sim.now_ns, m_sim.mcu_baudrate, &byte))
+    {
+    }
+
+    m_sim.mcu_baudrate = baudrate;
+    return 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+/**
+ * Host simulation of the Actions module and of the UART connecting it to the MCU.
+ *
+ * The simulation runs on a virtual clock (microsecond resolution) that only advances when the
+ * library yields (`task_yield_fn`) or when `actionslink_sim_advance()` is called, so runs are
+ * deterministic for a given configuration and seed.
+ *
+ * Every byte occupies the line for 10 bit times of the sender's baudrate and arrives after an
+ * additional fixed latency. Bytes can be dropped or corrupted (single bit flip) with a configurable
+ * probability. If both sides are not using the same baudrate, the receiver only sees garbage.
+ *
+ * The simulated module:
+ *  - ACKs every valid protobuf frame and NACKs invalid ones
+ *  - answers every request with an empty response of the same tag and sequence number,
+ *    i.e. `Common.Result` responses report success
+ *  - implements the `set_uart_config` baudrate negotiation, switching after the ACK of its response
+ *  - does not retransmit its own frames
+ */
+
+#include "actionslink_types.h"
+#include "message.pb.h"
+
+typedef struct
+{
+    uint32_t max_baudrate;      // Highest baudrate accepted by the module in `set_uart_config`
+    uint32_t latency_us;        // One-way latency added to every byte
+    uint32_t response_delay_us; // Time the module takes to process a request before responding
+    uint32_t loss_ppm;          // Probability of a byte being lost, in parts per million
+    uint32_t corruption_ppm;    // Probability of a byte being corrupted, in parts per million
+    uint32_t seed;              // Seed of the pseudo random generator used for the impairments
+} actionslink_sim_config_t;
+
+typedef struct
+{
+    uint32_t frames_to_module;   // Valid frames received by the module
+    uint32_t frames_to_mcu;      // Frames sent by the module
+    uint32_t bad_frames;         // Invalid frames received by the module
+    uint32_t bytes_to_module;
+    uint32_t bytes_to_mcu;
+    uint32_t bytes_lost;
+    uint32_t bytes_corrupted;
+    uint32_t bytes_overflowed;   // Bytes dropped because the receiver did not read them in time
+    uint32_t requests;           // Requests received by the module
+    uint32_t responses;          // Responses received by the module
+    uint32_t events;             // Events received by the module
+    uint32_t acks;               // ACKs received by the module
+    uint32_t nacks;              // NACKs received by the module
+} actionslink_sim_stats_t;
+
+/**
+ * @brief Resets the simulation: clock, line, module state and statistics.
+ *
+ * @param[in] p_config      pointer to the simulation configuration
+ */
+void actionslink_sim_init(const actionslink_sim_config_t *p_config);
+
+/**
+ * @brief Gets the library configuration connected to the simulated module.
+ * @note  Buffers, UART, clock and yield functions are provided by the simulation. The log function
+ *        can be changed by the caller.
+ *
+ * @return pointer to the library configuration
+ */
+actionslink_config_t *actionslink_sim_get_link_config(void);
+
+/**
+ * @brief Makes the module send the system ready event, as it does after booting.
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int actionslink_sim_boot(void);
+
+/**
+ * @brief Makes the module send an event to the MCU.
+ *
+ * @param[in] p_event       pointer to the event to send
+ *
+ * @return 0 if successful, -1 otherwise
+ */
+int actionslink_sim_send_event(const ActionsLink_ToMcuEvent *p_event);
+
+/**
+ * @brief Advances the virtual clock, letting the module process what it received in the meantime.
+ *
+ * @param[in] us            time to advance in microseconds
+ */
+void actionslink_sim_advance(uint32_t us);
+
+/**
+ * @brief Gets the current time of the virtual clock.
+ *
+ * @return time in microseconds since `actionslink_sim_init()`
+ */
+uint64_t actionslink_sim_get_us(void);
+
+/**
+ * @brief Gets the baudrate the simulated module is currently using.
+ *
+ * @return baudrate
+ */
+uint32_t actionslink_sim_get_module_baudrate(void);
+
+/**
+ * @brief Gets the statistics collected since `actionslink_sim_init()`.
+ *
+ * @return pointer to the statistics
+ */
+const actionslink_sim_stats_t *actionslink_sim_get_stats(void);
@@ -0,0 +1,299 @@
+/**
+ * Host benchmark for the TX path of the Actionslink lower transport layer.
+ *
+ * Every FromMcu message type is framed with `actionslink_bt_ll_tx()` and with a reference
+ * implementation of the previous framing (size calculation, encoding, escape counting and backwards
+ * in-place escaping). Both frames must be identical, the time per frame is reported.
+ *
+ * `actionslink_bt_ll_tx()` drops the top-level `pb_get_encoded_size()` call and the two escape passes
+ * of the reference, it is not a single pass: nanopb still sizes every nested submessage before writing
+ * it, in both implementations. The time of the dropped `pb_get_encoded_size()` call is reported on its
+ * own, the rest of the difference comes from the escape passes.
+ *
+ * The sequence number is chosen so that the payload contains bytes that need escaping.
+ *
+ * Build (nanopb sources and the generated .pb.c/.pb.h files are required):
+ *   gcc -O2 -DACTIONSLINK_LOG_LEVEL=0 -I<includes> bench_bt_ll_tx.c actionslink_bt_ll.c actionslink_utils.c \
+ *       actionslink_log.c pb_common.c pb_encode.c pb_decode.c *.pb.c -o bench_bt_ll_tx
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "actionslink_bt_ll.h"
+#include "actionslink_utils.h"
+#include "pb_encode.h"
+
+#define BENCH_ITERATIONS    (20000u)
+#define BENCH_BUFFER_SIZE   (256u)
+#define BENCH_SEQUENCE_ID   (0x7Eu)
+
+#define FROM_MCU_REQUESTS \
+    X(soft_reset)                  \
+    X(get_firmware_version)        \
+    X(set_power_state)             \
+    X(enter_dfu_mode)              \
+    X(set_uart_config)             \
+    X(set_audio_source)            \
+    X(set_volume)                  \
+    X(play_sound_icon)             \
+    X(stop_sound_icon)             \
+    X(get_a2dp_data)               \
+    X(send_avrcp_action)           \
+    X(set_absolute_avrcp_volume)   \
+    X(get_paired_device_list)      \
+    X(get_device_name)             \
+    X(disconnect_all_bt_devices)   \
+    X(enable_bt_reconnection)      \
+    X(clear_bt_paired_device_list) \
+    X(set_bt_pairing_state)        \
+    X(get_bt_pairing_state)        \
+    X(get_bt_connection_state)     \
+    X(get_csb_state)               \
+    X(exit_csb_mode)               \
+    X(get_bt_mac_address)          \
+    X(get_ble_mac_address)         \
+    X(get_bt_rssi_value)           \
+    X(get_this_device_name)        \
+    X(send_usb_hid_action)         \
+    X(send_app_packet)
+
+#define FROM_MCU_RESPONSES \
+    X(get_mcu_firmware_version)          \
+    X(get_color)                         \
+    X(set_off_timer)                     \
+    X(get_off_timer)                     \
+    X(set_brightness)                    \
+    X(get_brightness)                    \
+    X(get_pdcontroller_firmware_version) \
+    X(set_bass)                          \
+    X(get_bass)                          \
+    X(set_treble)                        \
+    X(get_treble)                        \
+    X(set_eco_mode)                      \
+    X(get_eco_mode)                      \
+    X(set_sound_icons)                   \
+    X(get_sound_icons)                   \
+    X(set_battery_friendly_charging)     \
+    X(get_battery_friendly_charging)     \
+    X(get_battery_capacity)              \
+    X(get_battery_max_capacity)
+
+#define FROM_MCU_EVENTS \
+    X(notify_aux_connected)              \
+    X(notify_usb_connected)              \
+    X(notify_battery_level)              \
+    X(notify_charger_status)             \
+    X(notify_color)                      \
+    X(notify_battery_friendly_charging)  \
+    X(notify_battery_history_buffer_15m) \
+    X(notify_battery_history_buffer_1h)  \
+    X(notify_battery_history_buffer_5h)  \
+    X(notify_battery_history_buffer_24h) \
+    X(notify_eco_mode)
+
+typedef struct
+{
+    const char         *name;
+    ActionsLink_FromMcu message;
+} bench_message_t;
+
+static uint8_t m_tx_buffer[BENCH_BUFFER_SIZE];
+static uint8_t m_rx_buffer[BENCH_BUFFER_SIZE];
+static uint8_t m_last_frame[BENCH_BUFFER_SIZE];
+static size_t  m_last_frame_length;
+
+static int write_buffer(const uint8_t *p_data, uint8_t length, uint32_t timeout)
+{
+    (void) timeout;
+    memcpy(m_last_frame, p_data, length);
+    m_last_frame_length = length;
+    return 0;
+}
+
+static int read_buffer(uint8_t *p_data, uint8_t length, uint32_t timeout)
+{
+    (void) p_data;
+    (void) length;
+    (void) timeout;
+    return -1;
+}
+
+static uint32_t get_tick_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) (ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+
+static const actionslink_config_t m_config = {
+    .write_buffer_fn = write_buffer,
+    .read_buffer_fn  = read_buffer,
+    .get_tick_ms_fn  = get_tick_ms,
+    .p_rx_buffer     = m_rx_buffer,
+    .p_tx_buffer     = m_tx_buffer,
+    .rx_buffer_size  = BENCH_BUFFER_SIZE,
+    .tx_buffer_size  = BENCH_BUFFER_SIZE,
+};
+
+static uint8_t crc8(uint8_t crc, const uint8_t *p_buffer, size_t length)
+{
+    while (length--)
+    {
+        crc ^= *p_buffer++;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = (crc & 0x80) ? (uint8_t) ((crc << 1) ^ 0x07) : (uint8_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Previous implementation: encoded size, encode, count escaped bytes, escape backwards in place
+static size_t reference_frame(const ActionsLink_FromMcu *p_message, uint8_t transaction_id, uint8_t *p_buffer, size_t size)
+{
+    size_t payload_length;
+    if (!pb_get_encoded_size(&payload_length, ActionsLink_FromMcu_fields, p_message))
+    {
+        return 0;
+    }
+
+    pb_ostream_t stream = pb_ostream_from_buffer(&p_buffer[8], size - 8);
+    if (!pb_encode(&stream, ActionsLink_FromMcu_fields, p_message))
+    {
+        return 0;
+    }
+
+    p_buffer[0] = 0x55;
+    p_buffer[1] = ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF;
+    p_buffer[2] = transaction_id;
+    p_buffer[3] = payload_length & 0xFF;
+    p_buffer[4] = (payload_length >> 8) & 0xFF;
+    p_buffer[5] = crc8(0, &p_buffer[8], payload_length);
+    p_buffer[6] = 0;
+    p_buffer[7] = crc8(0, p_buffer, 7);
+
+    size_t escaped = 0;
+    for (size_t i = 0; i < 8 + payload_length; i++)
+    {
+        escaped += (p_buffer[i] == 0x7E || p_buffer[i] == 0x7D);
+    }
+
+    size_t total_length = 8 + payload_length + escaped + 2;
+    if (total_length > size)
+    {
+        return 0;
+    }
+
+    size_t index            = total_length - 1;
+    p_buffer[index--]       = 0x7E;
+    for (int i = (int) (8 + payload_length) - 1; i >= 0; i--)
+    {
+        if (p_buffer[i] == 0x7E || p_buffer[i] == 0x7D)
+        {
+            p_buffer[index--] = p_buffer[i] ^ 0x20;
+            p_buffer[index--] = 0x7D;
+        }
+        else
+        {
+            p_buffer[index--] = p_buffer[i];
+        }
+    }
+    p_buffer[0] = 0x7E;
+    return total_length;
+}
+
+static double elapsed_ns(const struct timespec *p_start, const struct timespec *p_end)
+{
+    return (double) (p_end->tv_sec - p_start->tv_sec) * 1e9 + (double) (p_end->tv_nsec - p_start->tv_nsec);
+}
+
+int main(void)
+{
+    static bench_message_t messages[] = {
+#define X(name)                                                                                                        \
+    { "request." #name,                                                                                                \
+      { .which_Payload = ActionsLink_FromMcu_request_tag,                                                              \
+        .Payload.request = { .seq = BENCH_SEQUENCE_ID, .which_Request = ActionsLink_FromMcuRequest_##name##_tag } } },
+        FROM_MCU_REQUESTS
+#undef X
+#define X(name)                                                                                                        \
+    { "response." #name,                                                                                               \
+      { .which_Payload = ActionsLink_FromMcu_response_tag,                                                             \
+        .Payload.response = { .seq = BENCH_SEQUENCE_ID, .which_Response = ActionsLink_FromMcuResponse_##name##_tag } } },
+        FROM_MCU_RESPONSES
+#undef X
+#define X(name)                                                                                                        \
+    { "event." #name,                                                                                                  \
+      { .which_Payload = ActionsLink_FromMcu_event_tag,                                                                \
+        .Payload.event = { .which_Event = ActionsLink_FromMcuEvent_##name##_tag } } },
+        FROM_MCU_EVENTS
+#undef X
+    };
+
+    actionslink_utils_init(&m_config);
+    actionslink_bt_ll_init(&m_config);
+
+    static uint8_t reference[BENCH_BUFFER_SIZE];
+    double         total_new_ns = 0;
+    double         total_reference_ns   = 0;
+    double         total_size_ns        = 0;
+    int            mismatches           = 0;
+
+    printf("%-48s %8s %12s %12s %12s\n", "message", "bytes", "ref [ns]", "size [ns]", "new [ns]");
+    for (size_t m = 0; m < sizeof(messages) / sizeof(messages[0]); m++)
+    {
+        const bench_message_t        *p_bench = &messages[m];
+        actionslink_bt_ll_tx_packet_t packet  = {
+             .packet_type    = ACTIONSLINK_BT_LL_PACKET_TYPE_PROTOBUF,
+             .value          = 0,
+             .transaction_id = (uint8_t) m,
+             .p_payload      = &p_bench->message,
+        };
+
+        struct timespec start, end;
+        size_t          reference_length = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            reference_length = reference_frame(&p_bench->message, packet.transaction_id, reference, sizeof(reference));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double reference_ns = elapsed_ns(&start, &end) / BENCH_ITERATIONS;
+
+        // The top-level sizing pass of the reference, which actionslink_bt_ll_tx() no longer makes
+        size_t encoded_size = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            pb_get_encoded_size(&encoded_size, ActionsLink_FromMcu_fields, &p_bench->message);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double size_ns = elapsed_ns(&start, &end) / BENCH_ITERATIONS;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+        {
+            actionslink_bt_ll_tx(&packet);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double new_ns = elapsed_ns(&start, &end) / BENCH_ITERATIONS;
+
+        if (reference_length == 0 || reference_length != m_last_frame_length ||
+            memcmp(reference, m_last_frame, reference_length) != 0)
+        {
+            printf("%-48s frame mismatch\n", p_bench->name);
+            mismatches++;
+            continue;
+        }
+
+        total_reference_ns += reference_ns;
+        total_size_ns += size_ns;
+        total_new_ns += new_ns;
+        printf("%-48s %8zu %12.1f %12.1f %12.1f\n", p_bench->name, m_last_frame_length, reference_ns, size_ns,
+               new_ns);
+    }
+
+    printf("%-48s %8s %12.1f %12.1f %12.1f\n", "total", "", total_reference_ns, total_size_ns, total_new_ns);
+    return mismatches == 0 ? 0 : 1;
+}
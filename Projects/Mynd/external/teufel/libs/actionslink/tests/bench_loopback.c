@@ -0,0 +1,184 @@
+/**
+ * Host throughput benchmark of the Actionslink library against the simulated Actions module.
+ *
+ * Every scenario boots the module, optionally negotiates a faster baudrate and then runs a
+ * workload mixing blocking requests (volume control) with bursts of asynchronous notifications,
+ * like the application does. For each scenario the following is reported:
+ *  - completed and failed requests
+ *  - frames exchanged in both directions and frames per second of simulated link time
+ *  - host CPU time spent per frame (library and simulation together)
+ *  - retransmissions and the slowest round trip time, from the link statistics of the library
+ *
+ * The benchmark fails if a scenario without impairments loses a request, so it can be used in CI.
+ *
+ * Build (nanopb sources and the generated .pb.c/.pb.h files are required):
+ *   gcc -O2 -DACTIONSLINK_LOG_LEVEL=0 -I<includes> bench_loopback.c actionslink_sim.c <actionslink sources> \
+ *       pb_common.c pb_encode.c pb_decode.c *.pb.c -o bench_loopback
+ */
+#include <stdio.h>
+#include <time.h>
+
+#include "actionslink.h"
+#include "actionslink_sim.h"
+
+#define BENCH_ITERATIONS          (2000u)
+#define BENCH_NOTIFICATION_BURST  (4u)
+#define BENCH_BOOT_TIMEOUT_US     (2000000u)
+#define BENCH_BOOT_RETRY_US       (100000u)
+
+typedef struct
+{
+    const char              *name;
+    actionslink_sim_config_t sim_config;
+    uint32_t                 max_baudrate; // 0 to stay at the default baudrate
+    bool                     is_lossless;
+} bench_scenario_t;
+
+static const bench_scenario_t m_scenarios[] = {
+    {
+        .name         = "115200, ideal",
+        .sim_config   = {.max_baudrate = 921600, .seed = 1},
+        .is_lossless  = true,
+    },
+    {
+        .name         = "460800, ideal",
+        .sim_config   = {.max_baudrate = 921600, .seed = 1},
+        .max_baudrate = 460800,
+        .is_lossless  = true,
+    },
+    {
+        .name         = "115200, 2 ms latency, 1 ms processing",
+        .sim_config   = {.max_baudrate = 921600, .latency_us = 2000, .response_delay_us = 1000, .seed = 1},
+        .is_lossless  = true,
+    },
+    {
+        .name         = "115200, 0.01% byte loss",
+        .sim_config   = {.max_baudrate = 921600, .loss_ppm = 100, .seed = 1},
+    },
+    {
+        .name         = "115200, 0.01% byte corruption",
+        .sim_config   = {.max_baudrate = 921600, .corruption_ppm = 100, .seed = 1},
+    },
+    {
+        .name         = "460800, 0.01% byte loss and corruption",
+        .sim_config   = {.max_baudrate = 921600, .loss_ppm = 100, .corruption_ppm = 100, .seed = 1},
+        .max_baudrate = 460800,
+    },
+};
+
+static const actionslink_event_handlers_t   m_event_handlers   = {0};
+static const actionslink_request_handlers_t m_request_handlers = {0};
+
+static uint64_t get_cpu_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static int boot(void)
+{
+    uint64_t start_us = actionslink_sim_get_us();
+    uint64_t boot_us  = start_us;
+
+    actionslink_sim_boot();
+    while (!actionslink_is_ready())
+    {
+        if (actionslink_sim_get_us() - start_us > BENCH_BOOT_TIMEOUT_US)
+        {
+            return -1;
+        }
+
+        // The module does not retransmit its events, so repeat the boot if the event got lost
+        if (actionslink_sim_get_us() - boot_us > BENCH_BOOT_RETRY_US)
+        {
+            boot_us = actionslink_sim_get_us();
+            actionslink_sim_boot();
+        }
+
+        actionslink_tick();
+        actionslink_sim_advance(100);
+    }
+    return 0;
+}
+
+static int run_scenario(const bench_scenario_t *p_scenario)
+{
+    actionslink_sim_init(&p_scenario->sim_config);
+    if (actionslink_init(actionslink_sim_get_link_config(), &m_event_handlers, &m_request_handlers) != 0 ||
+        boot() != 0)
+    {
+        printf("%-40s: boot failed\n", p_scenario->name);
+        return -1;
+    }
+
+    uint32_t baudrate = ACTIONSLINK_DEFAULT_BAUDRATE;
+    if (p_scenario->max_baudrate && actionslink_negotiate_uart_baudrate(p_scenario->max_baudrate, &baudrate) != 0)
+    {
+        printf("%-40s: baudrate negotiation failed\n", p_scenario->name);
+    }
+
+    actionslink_reset_link_stats();
+    actionslink_sim_stats_t stats_before = *actionslink_sim_get_stats();
+    uint64_t                start_us     = actionslink_sim_get_us();
+    uint64_t                start_cpu_ns = get_cpu_time_ns();
+
+    uint32_t failed_requests = 0;
+    for (uint32_t i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        if (((i & 1u) ? actionslink_decrease_volume() : actionslink_increase_volume()) != 0)
+        {
+            failed_requests++;
+        }
+
+        for (uint32_t j = 0; j < BENCH_NOTIFICATION_BURST; j++)
+        {
+            actionslink_send_battery_level((uint8_t) ((i + j) % 100u));
+        }
+    }
+
+    while (actionslink_is_busy())
+    {
+        actionslink_tick();
+        actionslink_sim_advance(100);
+    }
+
+    uint64_t cpu_ns  = get_cpu_time_ns() - start_cpu_ns;
+    uint64_t link_us = actionslink_sim_get_us() - start_us;
+
+    const actionslink_sim_stats_t *p_stats = actionslink_sim_get_stats();
+    uint32_t frames = (p_stats->frames_to_module - stats_before.frames_to_module) +
+                      (p_stats->frames_to_mcu - stats_before.frames_to_mcu);
+    uint32_t events = p_stats->events - stats_before.events;
+
+    actionslink_link_stats_t link_stats;
+    actionslink_get_link_stats(&link_stats);
+
+    printf("%-40s: %6lu bd, requests %5u ok %4u failed, notifications %5u/%5u, frames %6u, "
+           "%7.0f frames/s, %6.0f ns CPU/frame, %u bytes lost, %u corrupted, %u retransmissions, max rtt %u ms\n",
+           p_scenario->name, (unsigned long) baudrate, BENCH_ITERATIONS - failed_requests, failed_requests, events,
+           BENCH_ITERATIONS * BENCH_NOTIFICATION_BURST, frames, link_us ? frames * 1e6 / link_us : 0.0,
+           frames ? (double) cpu_ns / frames : 0.0, p_stats->bytes_lost, p_stats->bytes_corrupted,
+           link_stats.retransmissions, link_stats.max_rtt[0].max_rtt_ms);
+
+    actionslink_deinit();
+
+    if (p_scenario->is_lossless && failed_requests > 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    int result = 0;
+    for (size_t i = 0; i < sizeof(m_scenarios) / sizeof(m_scenarios[0]); i++)
+    {
+        if (run_scenario(&m_scenarios[i]) != 0)
+        {
+            result = 1;
+        }
+    }
+    return result;
+}
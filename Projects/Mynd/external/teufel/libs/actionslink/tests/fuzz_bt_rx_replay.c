@@ -0,0 +1,87 @@
+/**
+ * Runs the RX fuzz target (fuzz_bt_rx.c) without libFuzzer, for compilers without it and for the unit test build.
+ *
+ * Usage:
+ *   fuzz_bt_rx_replay <file>...    runs the target once per file, e.g. to reproduce a crash found by the fuzzer
+ *   fuzz_bt_rx_replay              runs the target on pseudo random inputs (fixed seed)
+ *
+ * The random inputs are not coverage guided, they mostly exercise the deframing and the error paths.
+ * Frame delimiters and escape characters are mixed in often, so the inputs split into many short frames.
+ *
+ * Build: see fuzz_bt_rx.c, with fuzz_bt_rx_replay.c added and without -fsanitize=fuzzer.
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#define REPLAY_RANDOM_RUNS       (20000u)
+#define REPLAY_MAX_INPUT_LENGTH  (512u)
+#define REPLAY_SEED              (0x2545F491u)
+
+int LLVMFuzzerTestOneInput(const uint8_t *p_data, size_t size);
+
+static uint32_t m_random_state = REPLAY_SEED;
+
+// xorshift32, good enough for test inputs and the same on every host
+static uint32_t next_random(void)
+{
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+    return m_random_state;
+}
+
+static int replay_file(const char *p_path)
+{
+    static uint8_t input[64u * 1024u];
+
+    FILE *p_file = fopen(p_path, "rb");
+    if (p_file == NULL)
+    {
+        fprintf(stderr, "%s: cannot open\n", p_path);
+        return -1;
+    }
+
+    size_t size = fread(input, 1, sizeof(input), p_file);
+    fclose(p_file);
+
+    LLVMFuzzerTestOneInput(input, size);
+    printf("%s: %zu bytes ok\n", p_path, size);
+    return 0;
+}
+
+static void replay_random(void)
+{
+    static const uint8_t special_bytes[] = {0x7E, 0x7D, 0x55};
+    static uint8_t       input[REPLAY_MAX_INPUT_LENGTH];
+
+    for (uint32_t run = 0; run < REPLAY_RANDOM_RUNS; run++)
+    {
+        size_t size = 1u + next_random() % REPLAY_MAX_INPUT_LENGTH;
+        for (size_t i = 0; i < size; i++)
+        {
+            uint32_t r = next_random();
+            input[i]   = (r & 0x700u) == 0 ? special_bytes[r % sizeof(special_bytes)] : (uint8_t) r;
+        }
+        LLVMFuzzerTestOneInput(input, size);
+    }
+    printf("%u random inputs ok\n", REPLAY_RANDOM_RUNS);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        replay_random();
+        return 0;
+    }
+
+    int result = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (replay_file(argv[i]) != 0)
+        {
+            result = 1;
+        }
+    }
+    return result;
+}
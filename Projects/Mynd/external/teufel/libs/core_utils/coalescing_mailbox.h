@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @brief Latest-value-wins mailbox with a single slot per message type.
+ * @tparam Ts - Message types, in the order in which they are flushed (highest priority first)
+ * @note Posting replaces a pending value of the same type, so a burst of updates results in a single delivery.
+ *       Values equal to the last delivered one are dropped. Posting is safe from any task, but not from an ISR,
+ *       flushing is meant to be done by a single consumer task.
+ */
+template <typename... Ts>
+class CoalescingMailbox
+{
+    static_assert((std::is_trivially_copyable_v<Ts> && ...), "Mailbox values are compared bytewise");
+
+    template <typename T>
+    struct Slot
+    {
+        std::optional<T> pending;
+        std::optional<T> delivered;
+    };
+
+  public:
+    template <typename T>
+    static constexpr bool accepts = (std::is_same_v<T, Ts> || ...);
+
+    /**
+     * @brief Stores the newest value of a message type.
+     * @return true if the mailbox was empty before, i.e. the consumer needs to be woken up.
+     */
+    template <typename T>
+    requires accepts<T>
+    bool post(const T &value)
+    {
+        taskENTER_CRITICAL();
+        auto &slot      = std::get<Slot<T>>(m_slots);
+        bool  was_empty = m_pending_count == 0;
+
+        if (slot.delivered.has_value() && equal(*slot.delivered, value))
+        {
+            // Back to the state the consumer already knows about, nothing needs to be sent
+            if (slot.pending.has_value())
+            {
+                slot.pending.reset();
+                m_pending_count--;
+            }
+        }
+        else
+        {
+            if (not slot.pending.has_value())
+                m_pending_count++;
+            slot.pending = value;
+        }
+
+        bool wake_up = was_empty && m_pending_count > 0;
+        taskEXIT_CRITICAL();
+        return wake_up;
+    }
+
+    /**
+     * @brief Delivers all pending values in priority order.
+     * @param deliver - Callable invoked with each pending value, returns true if the value was delivered.
+     *                  A value that failed to be delivered stays pending for the next flush, unless a newer one
+     *                  was posted meanwhile, and the next value of its type is not deduplicated.
+     */
+    template <typename F>
+    void flush(F &&deliver)
+    {
+        std::apply([&](auto &...slots) { (flush_slot(slots, deliver), ...); }, m_slots);
+    }
+
+    /**
+     * @brief Forgets pending and delivered values, e.g. when the consumer lost its state.
+     */
+    void reset()
+    {
+        taskENTER_CRITICAL();
+        m_slots         = {};
+        m_pending_count = 0;
+        taskEXIT_CRITICAL();
+    }
+
+    /**
+     * @brief Forgets delivered values only, so that the next post of any value is delivered again.
+     */
+    void invalidate()
+    {
+        taskENTER_CRITICAL();
+        std::apply([](auto &...slots) { (slots.delivered.reset(), ...); }, m_slots);
+        taskEXIT_CRITICAL();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return m_pending_count == 0;
+    }
+
+  private:
+    template <typename T>
+    static bool equal(const T &a, const T &b)
+    {
+        return std::memcmp(&a, &b, sizeof(T)) == 0;
+    }
+
+    template <typename T, typename F>
+    void flush_slot(Slot<T> &slot, F &deliver)
+    {
+        taskENTER_CRITICAL();
+        std::optional<T> value = slot.pending;
+        if (value.has_value())
+        {
+            slot.pending.reset();
+            m_pending_count--;
+        }
+        taskEXIT_CRITICAL();
+
+        if (not value.has_value())
+            return;
+
+        bool delivered = deliver(*value);
+
+        taskENTER_CRITICAL();
+        if (delivered)
+        {
+            slot.delivered = value;
+        }
+        else
+        {
+            // The consumer state is unknown now. A value posted during the delivery is newer, it is sent instead.
+            slot.delivered.reset();
+            if (not slot.pending.has_value())
+            {
+                slot.pending = value;
+                m_pending_count++;
+            }
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    std::tuple<Slot<Ts>...> m_slots{};
+    uint8_t                 m_pending_count = 0;
+};
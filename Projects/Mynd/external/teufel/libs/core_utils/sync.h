@@ -1,63 +1,88 @@
 #pragma once
 
 #include <cstdint>
+#include <initializer_list>
 #include "FreeRTOS.h"
-#if defined(TEUFEL_LOGGER)
-#include "logger.h"
-#else
-#include "dbg_log.h"
-#endif
+#include "event_groups.h"
 
-struct SyncPrimitive
+namespace Teufel::Core
 {
-    template <typename T>
-    static int await(const T &t, uint32_t timeout_ms, const char *msg)
-    {
-        /* FreeRTOS Stream and Message Buffers use the task notification at array index 0.
-         * If you want to maintain the state of a task notification across a call to a Stream,
-         * or Message Buffer API function then use a task notification at an array index greater than 0.
-         * In order to avoid collisions, please consider to use indexes starting from 1. */
-        if (static_cast<uint32_t >(t) == 0)
-            log_warn("SyncPrimitive (%s) Task notification at array index 0!", __func__);
 
-        uint32_t ulNotificationValue =
-            ulTaskNotifyTakeIndexed(static_cast<uint32_t>(t), pdTRUE, pdMS_TO_TICKS(timeout_ms));
-        if (ulNotificationValue == 1)
-        {
-            log_info("Task %s %s", getDesc(t), msg);
-            return 0;
-        }
+/**
+ * @brief Events which any number of tasks can wait for at the same time, e.g. the readiness of the tasks.
+ * @tparam E - Enum of the events, with values below 24 (the bits of an event group with 32-bit ticks)
+ * @note An event stays set until it is cleared: a task waiting for an event which already happened returns right
+ *       away. Setting and waiting are task context only.
+ */
+template <typename E>
+class EventBits
+{
+  public:
+    // Static allocation, the event group can be used before the scheduler starts
+    EventBits() : m_group(xEventGroupCreateStatic(&m_buffer)) {}
 
-        log_err("%s: task %s sync timeout", __func__, getDesc(t));
+    EventBits(const EventBits &)            = delete;
+    EventBits &operator=(const EventBits &) = delete;
 
-        return 1;
+    void set(E event)
+    {
+        xEventGroupSetBits(m_group, bit(event));
     }
 
-    template <typename T>
-    static int notify(const T &t)
+    void clear(E event)
     {
-        static TaskHandle_t xTaskToNotifySystem = nullptr;
+        xEventGroupClearBits(m_group, bit(event));
+    }
 
-        if (!xTaskToNotifySystem)
-        {
-            xTaskToNotifySystem = xTaskGetHandle("System");
-        }
+    bool isSet(E event) const
+    {
+        return (xEventGroupGetBits(m_group) & bit(event)) != 0;
+    }
+
+    /**
+     * @brief Waits until all the events are set.
+     * @param timeout_ms - Counted from the call
+     * @return 0 on success, -1 on timeout
+     */
+    int waitAll(std::initializer_list<E> events, uint32_t timeout_ms)
+    {
+        return wait(bits(events), pdTRUE, timeout_ms);
+    }
 
-        if (xTaskToNotifySystem == nullptr)
-        {
-            log_err("Sys sync notify failed");
-            return -1;
-        }
+    /**
+     * @brief Waits until any of the events is set.
+     * @param timeout_ms - Counted from the call
+     * @return 0 on success, -1 on timeout
+     */
+    int waitAny(std::initializer_list<E> events, uint32_t timeout_ms)
+    {
+        return wait(bits(events), pdFALSE, timeout_ms);
+    }
 
-        /* FreeRTOS Stream and Message Buffers use the task notification at array index 0.
-         * If you want to maintain the state of a task notification across a call to a Stream,
-         * or Message Buffer API function then use a task notification at an array index greater than 0.
-         * In order to avoid collisions, please consider to use indexes starting from 1. */
-        if (static_cast<uint32_t >(t) == 0)
-            log_warn("SyncPrimitive (%s) Task notification at array index 0!", __func__);
+  private:
+    static constexpr EventBits_t bit(E event)
+    {
+        return static_cast<EventBits_t>(1u << static_cast<unsigned>(event));
+    }
 
-        xTaskNotifyGiveIndexed(xTaskToNotifySystem, static_cast<uint32_t>(t));
+    static constexpr EventBits_t bits(std::initializer_list<E> events)
+    {
+        EventBits_t result = 0;
+        for (E event : events)
+            result |= bit(event);
+        return result;
+    }
 
-        return 0;
+    int wait(EventBits_t wanted, BaseType_t wait_for_all, uint32_t timeout_ms)
+    {
+        // Returns the bits at the time the wait ended, the bits are left set for the other waiting tasks
+        const EventBits_t set = xEventGroupWaitBits(m_group, wanted, pdFALSE, wait_for_all, pdMS_TO_TICKS(timeout_ms));
+        const bool        met = wait_for_all ? (set & wanted) == wanted : (set & wanted) != 0;
+        return met ? 0 : -1;
     }
+
+    StaticEventGroup_t m_buffer;
+    EventGroupHandle_t m_group;
 };
+
+}
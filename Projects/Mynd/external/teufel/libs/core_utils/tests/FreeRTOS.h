@@ -0,0 +1,3 @@
+#pragma once
+
+// Host build of the core_utils tests: the mailbox only needs the critical sections of task.h
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host build of the core_utils tests: the tests are single threaded, the critical sections only need to pair up
+inline int g_critical_nesting = 0;
+
+#define taskENTER_CRITICAL() (++g_critical_nesting)
+#define taskEXIT_CRITICAL()  (--g_critical_nesting)
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "core_utils/coalescing_mailbox.h"
+
+struct Level
+{
+    uint8_t value;
+};
+
+struct Status
+{
+    bool on;
+};
+
+using Mailbox = CoalescingMailbox<Status, Level>;
+
+class CoalescingMailboxTest : public ::testing::Test
+{
+  protected:
+    // Delivers everything pending, records the values in the order they were delivered
+    void flush(bool succeed = true)
+    {
+        mailbox.flush(
+            [&](const auto &p)
+            {
+                using T = std::decay_t<decltype(p)>;
+                if constexpr (std::is_same_v<T, Level>)
+                    levels.push_back(p.value);
+                else
+                    statuses.push_back(p.on);
+                order.push_back(std::is_same_v<T, Level> ? 'L' : 'S');
+                EXPECT_EQ(g_critical_nesting, 0) << "delivered within a critical section";
+                return succeed;
+            });
+        ASSERT_EQ(g_critical_nesting, 0);
+    }
+
+    Mailbox              mailbox;
+    std::vector<uint8_t> levels;
+    std::vector<bool>    statuses;
+    std::vector<char>    order;
+};
+
+TEST_F(CoalescingMailboxTest, LatestValueWins)
+{
+    ASSERT_TRUE(mailbox.post(Level{10}));
+    ASSERT_FALSE(mailbox.post(Level{20}));
+    ASSERT_FALSE(mailbox.post(Level{30}));
+    flush();
+    ASSERT_EQ(levels, std::vector<uint8_t>({30}));
+    ASSERT_TRUE(mailbox.empty());
+}
+
+TEST_F(CoalescingMailboxTest, EqualToDeliveredIsDropped)
+{
+    mailbox.post(Level{10});
+    flush();
+    ASSERT_FALSE(mailbox.post(Level{10}));
+    ASSERT_TRUE(mailbox.empty());
+
+    // A change and back before the flush cancels the change
+    mailbox.post(Level{20});
+    mailbox.post(Level{10});
+    ASSERT_TRUE(mailbox.empty());
+    flush();
+    ASSERT_EQ(levels, std::vector<uint8_t>({10}));
+}
+
+TEST_F(CoalescingMailboxTest, FailedDeliveryIsRetried)
+{
+    mailbox.post(Level{10});
+    flush(false);
+    ASSERT_FALSE(mailbox.empty());
+    flush();
+    ASSERT_EQ(levels, std::vector<uint8_t>({10, 10}));
+    ASSERT_TRUE(mailbox.empty());
+}
+
+TEST_F(CoalescingMailboxTest, FailedDeliveryIsNotDeduplicated)
+{
+    mailbox.post(Level{10});
+    flush();
+    mailbox.post(Level{20});
+    flush(false);
+
+    // The consumer may or may not have the failed value, so even the delivered one is sent again
+    mailbox.post(Level{10});
+    ASSERT_FALSE(mailbox.empty());
+    flush();
+    ASSERT_EQ(levels, std::vector<uint8_t>({10, 20, 10}));
+}
+
+TEST_F(CoalescingMailboxTest, NewerValueReplacesFailedOne)
+{
+    mailbox.post(Level{10});
+    mailbox.flush(
+        [&](const auto &p)
+        {
+            if constexpr (std::is_same_v<std::decay_t<decltype(p)>, Level>)
+            {
+                // Posted by another task while the delivery was in progress
+                mailbox.post(Level{20});
+            }
+            return false;
+        });
+    flush();
+    ASSERT_EQ(levels, std::vector<uint8_t>({20}));
+}
+
+TEST_F(CoalescingMailboxTest, FlushesInTypeOrder)
+{
+    mailbox.post(Level{10});
+    mailbox.post(Status{true});
+    flush();
+    ASSERT_EQ(order, std::vector<char>({'S', 'L'}));
+}
+
+TEST_F(CoalescingMailboxTest, InvalidateSendsTheSameValueAgain)
+{
+    mailbox.post(Status{true});
+    flush();
+    mailbox.invalidate();
+    ASSERT_TRUE(mailbox.post(Status{true}));
+    flush();
+    ASSERT_EQ(statuses, std::vector<bool>({true, true}));
+}
+
+TEST_F(CoalescingMailboxTest, ResetForgetsPendingValues)
+{
+    mailbox.post(Level{10});
+    mailbox.reset();
+    ASSERT_TRUE(mailbox.empty());
+    flush();
+    ASSERT_TRUE(levels.empty());
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "core_utils/timer_wheel.h"
+
+using Wheel = TimerWheel<8, 10>;
+
+static uint32_t                 s_now_ms;
+static std::vector<const char *> s_runs;
+
+static uint32_t get_systick()
+{
+    return s_now_ms;
+}
+
+class TimerWheelTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        s_now_ms = 1000;
+        s_runs.clear();
+    }
+
+    // Advances the clock in steps, processing the wheel after each one
+    void advance(uint32_t ms, uint32_t step_ms = 1)
+    {
+        for (uint32_t t = 0; t < ms; t += step_ms)
+        {
+            s_now_ms += step_ms;
+            wheel.process();
+        }
+    }
+
+    Wheel        wheel{get_systick};
+    Wheel::Timer s_a{"a", []() { s_runs.push_back("a"); }};
+    Wheel::Timer s_b{"b", []() { s_runs.push_back("b"); }};
+};
+
+TEST_F(TimerWheelTest, OneShotRunsOnceAtExpiry)
+{
+    wheel.start(s_a, 25);
+    advance(24);
+    ASSERT_TRUE(s_runs.empty());
+    advance(1);
+    ASSERT_EQ(s_runs.size(), 1u);
+    ASSERT_FALSE(wheel.isActive(s_a));
+    advance(200);
+    ASSERT_EQ(s_runs.size(), 1u);
+}
+
+TEST_F(TimerWheelTest, PeriodicDoesNotDrift)
+{
+    wheel.start(s_a, 100, 100);
+    // Processing only every 30 ms delays the runs, but not the following expiries
+    advance(990, 30);
+    ASSERT_EQ(s_runs.size(), 9u);
+    ASSERT_EQ(wheel.msUntilNextExpiry(), 10u);
+    wheel.stop(s_a);
+}
+
+TEST_F(TimerWheelTest, LongDelayOutlastsWheelRotation)
+{
+    // 8 slots of 10 ms cover 80 ms only
+    wheel.start(s_a, 500);
+    advance(499);
+    ASSERT_TRUE(s_runs.empty());
+    advance(1);
+    ASSERT_EQ(s_runs.size(), 1u);
+}
+
+TEST_F(TimerWheelTest, OverdueTimersRunAfterLongSleep)
+{
+    wheel.start(s_a, 20);
+    wheel.start(s_b, 50, 50);
+    s_now_ms += 10000;
+    wheel.process();
+    ASSERT_EQ(s_runs.size(), 2u);
+    // Missed runs of the periodic timer are skipped
+    ASSERT_EQ(wheel.msUntilNextExpiry(), 50u);
+    wheel.stop(s_b);
+}
+
+TEST_F(TimerWheelTest, StopAndRestart)
+{
+    wheel.start(s_a, 30);
+    wheel.start(s_b, 40);
+    wheel.stop(s_a);
+    ASSERT_EQ(wheel.msUntilNextExpiry(), 40u);
+    wheel.start(s_b, 100);
+    advance(99);
+    ASSERT_TRUE(s_runs.empty());
+    advance(1);
+    ASSERT_EQ(s_runs, std::vector<const char *>{"b"});
+    ASSERT_EQ(wheel.msUntilNextExpiry(), std::nullopt);
+}
+
+static Wheel        *s_p_wheel;
+static Wheel::Timer *s_p_restarting;
+
+TEST_F(TimerWheelTest, RestartWithoutDelayRunsOncePerProcess)
+{
+    Wheel::Timer restarting{"restarting", []()
+                            {
+                                s_runs.push_back("restarting");
+                                s_p_wheel->start(*s_p_restarting, 0);
+                            }};
+    s_p_wheel      = &wheel;
+    s_p_restarting = &restarting;
+    wheel.start(restarting, 5);
+    advance(5);
+    ASSERT_EQ(s_runs.size(), 1u);
+    ASSERT_EQ(wheel.msUntilNextExpiry(), 0u);
+    advance(1);
+    ASSERT_EQ(s_runs.size(), 2u);
+    wheel.stop(restarting);
+}
+
+TEST_F(TimerWheelTest, WrapsAroundTickOverflow)
+{
+    s_now_ms = UINT32_MAX - 15;
+    wheel.process();
+    wheel.start(s_a, 30);
+    advance(29);
+    ASSERT_TRUE(s_runs.empty());
+    advance(1);
+    ASSERT_EQ(s_runs.size(), 1u);
+}
+
+static uint32_t s_fired_at[16];
+
+TEST_F(TimerWheelTest, RandomDelaysRunOnTime)
+{
+    Wheel::Timer timers[16];
+    uint32_t     expiries[16];
+    uint32_t     seed = 12345;
+    for (size_t i = 0; i < 16; i++)
+    {
+        seed           = seed * 1103515245u + 12345u;
+        uint32_t delay = (seed >> 16) % 1000;
+        timers[i]      = {"t", nullptr};
+        expiries[i]    = s_now_ms + delay;
+        s_fired_at[i]  = 0;
+        wheel.start(timers[i], delay);
+    }
+
+    for (uint32_t t = 0; t <= 1000; t++)
+    {
+        for (size_t i = 0; i < 16; i++)
+        {
+            if (wheel.isActive(timers[i]))
+                continue;
+            if (s_fired_at[i] == 0)
+                s_fired_at[i] = s_now_ms;
+        }
+        s_now_ms++;
+        wheel.process();
+    }
+
+    for (size_t i = 0; i < 16; i++)
+        ASSERT_EQ(s_fired_at[i], std::max(expiries[i], 1001u)) << "timer " << i;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+/**
+ * @brief Allocation-free hashed timer wheel for the periodic and one-shot jobs of a task.
+ * @tparam SLOTS         - number of slots of the wheel (power of two)
+ * @tparam RESOLUTION_MS - time covered by one slot, the jobs of a slot are checked together
+ * @note Timers are owned by the caller (usually static), the wheel only links them into its slots.
+ *       A wheel and its timers belong to a single task: timers are started, stopped and run from that task only,
+ *       by calling process() from its idle callback. The callbacks therefore run in the context of that task.
+ *       Periodic timers are re-armed relative to their previous expiry, so their period does not drift with the
+ *       latency of the task. If the task falls behind by more than a period, the missed runs are skipped.
+ */
+template <size_t SLOTS, uint32_t RESOLUTION_MS>
+class TimerWheel
+{
+    static_assert(SLOTS > 0 && (SLOTS & (SLOTS - 1)) == 0, "The number of slots must be a power of two");
+    static_assert(RESOLUTION_MS > 0, "The resolution must not be zero");
+
+  public:
+    using get_systick_fn_t = uint32_t();
+
+    struct Timer
+    {
+        const char *name;
+        void (*callback)();
+
+        // Managed by the wheel
+        uint32_t expiry_ms = 0;
+        uint32_t period_ms = 0;
+        uint32_t run_pass  = 0;
+        size_t   slot      = 0;
+        bool     active    = false;
+        Timer   *next      = nullptr;
+    };
+
+    explicit TimerWheel(get_systick_fn_t *get_systick)
+      : m_get_systick(get_systick)
+    {
+    }
+
+    /**
+     * @brief Starts (or restarts) a timer.
+     * @param delay_ms  - time until the first expiry
+     * @param period_ms - time between the following expiries, 0 for a one-shot timer
+     */
+    void start(Timer &timer, uint32_t delay_ms, uint32_t period_ms = 0)
+    {
+        stop(timer);
+
+        timer.expiry_ms = m_get_systick() + delay_ms;
+        timer.period_ms = period_ms;
+        insert(timer);
+    }
+
+    void stop(Timer &timer)
+    {
+        if (not timer.active)
+            return;
+
+        for (Timer **pp = &m_slots[timer.slot]; *pp != nullptr; pp = &(*pp)->next)
+        {
+            if (*pp == &timer)
+            {
+                *pp = timer.next;
+                m_active_count--;
+                break;
+            }
+        }
+
+        timer.next   = nullptr;
+        timer.active = false;
+    }
+
+    bool isActive(const Timer &timer) const
+    {
+        return timer.active;
+    }
+
+    /**
+     * @brief Runs the callbacks of the expired timers.
+     */
+    void process()
+    {
+        const uint32_t now_ms  = m_get_systick();
+        const uint32_t from_ms = m_processed_ms;
+
+        // Timers started by the callbacks with an expiry in the past go to the slot of now, visited first next time
+        m_processed_ms = now_ms;
+        m_pass++;
+
+        // Visit every slot the clock went through since the last call, but each slot at most once
+        // (all of them if the tick counter wrapped around)
+        uint32_t slots_to_visit = now_ms / RESOLUTION_MS - from_ms / RESOLUTION_MS + 1;
+        if (slots_to_visit > SLOTS)
+            slots_to_visit = SLOTS;
+
+        for (uint32_t i = 0; i < slots_to_visit; i++)
+        {
+            run_expired(m_slots[(slot_of(from_ms) + i) & (SLOTS - 1)], now_ms);
+        }
+    }
+
+    /**
+     * @brief Gets the time until the next timer expires, e.g. to let the task sleep until then.
+     * @return 0 if a timer is already overdue, std::nullopt if no timer is active.
+     */
+    std::optional<uint32_t> msUntilNextExpiry() const
+    {
+        if (m_active_count == 0)
+            return std::nullopt;
+
+        const uint32_t now_ms = m_get_systick();
+        uint32_t       min_ms = UINT32_MAX;
+        for (const Timer *p_head : m_slots)
+        {
+            for (const Timer *p = p_head; p != nullptr; p = p->next)
+            {
+                if (is_expired(*p, now_ms))
+                    return 0u;
+                if (p->expiry_ms - now_ms < min_ms)
+                    min_ms = p->expiry_ms - now_ms;
+            }
+        }
+        return min_ms;
+    }
+
+  private:
+    static bool is_expired(const Timer &timer, uint32_t now_ms)
+    {
+        // Wraparound safe as long as expiries are less than half the tick range ahead
+        return static_cast<int32_t>(now_ms - timer.expiry_ms) >= 0;
+    }
+
+    size_t slot_of(uint32_t ms) const
+    {
+        return (ms / RESOLUTION_MS) & (SLOTS - 1);
+    }
+
+    void insert(Timer &timer)
+    {
+        // An expiry in the past goes to the current slot, which process() visits first
+        timer.slot   = slot_of(is_expired(timer, m_processed_ms) ? m_processed_ms : timer.expiry_ms);
+        timer.next   = m_slots[timer.slot];
+        timer.active = true;
+        m_slots[timer.slot] = &timer;
+        m_active_count++;
+    }
+
+    void run_expired(Timer *&head, uint32_t now_ms)
+    {
+        // Restart from the head after every callback, which may start or stop any timer.
+        // A timer runs at most once per pass, even if its callback restarts it without delay.
+        Timer *p = head;
+        while (p != nullptr)
+        {
+            if (not is_expired(*p, now_ms) || p->run_pass == m_pass)
+            {
+                p = p->next;
+                continue;
+            }
+
+            Timer &timer   = *p;
+            timer.run_pass = m_pass;
+            stop(timer);
+
+            if (timer.period_ms != 0)
+            {
+                timer.expiry_ms += timer.period_ms;
+                if (is_expired(timer, now_ms))
+                    timer.expiry_ms = now_ms + timer.period_ms;
+                insert(timer);
+            }
+
+            if (timer.callback)
+                timer.callback();
+
+            p = head;
+        }
+    }
+
+    get_systick_fn_t *m_get_systick;
+    Timer            *m_slots[SLOTS]  = {};
+    uint32_t          m_processed_ms  = 0;
+    uint32_t          m_pass          = 0;
+    size_t            m_active_count  = 0;
+};
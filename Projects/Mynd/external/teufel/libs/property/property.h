@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <memory>
 #include <optional>
+#include <tuple>
 #include <type_traits>
 
 #if defined(TEUFEL_LOGGER)
@@ -27,6 +30,100 @@ struct PropertyMutex
 // Initialize the mutex with a default value
 inline IMutex *PropertyMutex::mutex = nullptr;
 
+/**
+ * @brief Holds the property mutex for its scope, to change several properties together.
+ * @note  A snapshot() sees either none or all of the changes made under a PropertyLock. The mutex is recursive, the
+ *        set() calls within the scope take it again. Keep the scope short: the other writers and the snapshots wait.
+ */
+class PropertyLock : public Teufel::Core::Uncopyable
+{
+  public:
+    PropertyLock()
+      : m_mutex(PropertyMutex::mutex)
+    {
+        if (m_mutex)
+            m_mutex->lock();
+    }
+
+    ~PropertyLock()
+    {
+        if (m_mutex)
+            m_mutex->unlock();
+    }
+
+  private:
+    IMutex *m_mutex;
+};
+
+/**
+ * @brief Value of a property, written under the property mutex and read without it (seqlock).
+ * @note  A writer makes the sequence counter odd before changing the value and even again after. A reader copies the
+ *        value and keeps the copy if the counter was even and did not change meanwhile. Otherwise it takes the mutex
+ *        to read, which makes it wait for the writer (boosted by priority inheritance) instead of spinning while
+ *        the writer cannot run.
+ */
+template <typename V>
+class SeqLockValue
+{
+  public:
+    SeqLockValue() = default;
+    explicit SeqLockValue(const V &value)
+      : m_value(value)
+    {
+    }
+
+    [[nodiscard]] V load() const
+    {
+        const uint32_t seq = m_seq.load(std::memory_order_acquire);
+        if ((seq & 1u) == 0)
+        {
+            V v = m_value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_seq.load(std::memory_order_relaxed) == seq)
+                return v;
+        }
+
+        if (PropertyMutex::mutex)
+            PropertyMutex::mutex->lock();
+
+        V v = m_value;
+
+        if (PropertyMutex::mutex)
+            PropertyMutex::mutex->unlock();
+
+        return v;
+    }
+
+    // The caller holds the property mutex, the writers do not need to be lock-free between each other
+    void store(const V &value)
+    {
+        const uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_value = value;
+
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+  private:
+    std::atomic<uint32_t> m_seq{0};
+    V                     m_value{};
+};
+
+/**
+ * @brief Reads several properties at once, under one lock of the property mutex.
+ * @note  The values are consistent with each other: no writer changes any of them in between. A single property is
+ *        cheaper to read with its get(), which does not take the mutex.
+ * @return Tuple of the values returned by the get() of the properties
+ */
+template <typename... P>
+auto snapshot(const P &...properties)
+{
+    PropertyLock lock;
+    return std::tuple{properties.get()...};
+}
+
 enum class PropertyType
 {
     Optional,
@@ -140,31 +237,26 @@ class _Property<bool, PT> : public Teufel::Core::Uncopyable
 
     [[nodiscard]] auto get() const
     {
-        if (PropertyMutex::mutex)
-            PropertyMutex::mutex->lock();
-
-        auto v = m_value;
-
-        if (PropertyMutex::mutex)
-            PropertyMutex::mutex->unlock();
-
-        return v;
+        return m_value.load();
     }
 
-    void set(bool v)
+    // Returns true if the value has changed
+    bool set(bool v)
     {
-        if (m_value.has_value() && *m_value == v)
-            return;
+        if (const auto current = m_value.load(); current.has_value() && *current == v)
+            return false;
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = v;
+        m_value.store(v);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
 
         log_info("Property (%s) set: %d", m_name, v);
+
+        return true;
     }
 
     void set_default()
@@ -172,7 +264,7 @@ class _Property<bool, PT> : public Teufel::Core::Uncopyable
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = m_default_value;
+        m_value.store(m_default_value);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -186,7 +278,7 @@ class _Property<bool, PT> : public Teufel::Core::Uncopyable
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = std::nullopt;
+        m_value.store(std::nullopt);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -195,9 +287,9 @@ class _Property<bool, PT> : public Teufel::Core::Uncopyable
     }
 
   private:
-    const char         *m_name;          /*!< name specialisation */
-    bool                m_default_value; /*!< default value after initialisation */
-    std::optional<bool> m_value = std::nullopt;
+    const char                       *m_name;          /*!< name specialisation */
+    bool                              m_default_value; /*!< default value after initialisation */
+    SeqLockValue<std::optional<bool>> m_value;
 };
 
 /* Arithmetic type */
@@ -229,34 +321,27 @@ class _Property<T, PT, typename std::enable_if<std::is_arithmetic<T>::value>::ty
 
     ~_Property() = default;
 
-    [[nodiscard]] constexpr auto get() const
+    [[nodiscard]] auto get() const
     {
-        if (PropertyMutex::mutex)
-            PropertyMutex::mutex->lock();
-
-        auto v = m_value;
-
-        if (PropertyMutex::mutex)
-            PropertyMutex::mutex->unlock();
-
-        return v;
+        return m_value.load();
     }
 
-    void set(T v)
+    // Returns true if the value has changed
+    bool set(T v)
     {
         if (v > m_max || v < m_min)
         {
             log_err("Property (%s) set: out of range", m_name);
-            return;
+            return false;
         }
 
-        if (m_value.has_value() && *m_value == v)
-            return;
+        if (const auto current = m_value.load(); current.has_value() && *current == v)
+            return false;
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = v;
+        m_value.store(v);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -274,6 +359,8 @@ class _Property<T, PT, typename std::enable_if<std::is_arithmetic<T>::value>::ty
         {
             log_info("Property (%s) set: %u", m_name, v);
         }
+
+        return true;
     }
 
     void set_default()
@@ -281,7 +368,7 @@ class _Property<T, PT, typename std::enable_if<std::is_arithmetic<T>::value>::ty
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = m_default_value;
+        m_value.store(m_default_value);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -295,7 +382,7 @@ class _Property<T, PT, typename std::enable_if<std::is_arithmetic<T>::value>::ty
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = std::nullopt;
+        m_value.store(std::nullopt);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -328,12 +415,12 @@ class _Property<T, PT, typename std::enable_if<std::is_arithmetic<T>::value>::ty
     }
 
   private:
-    const char      *m_name; /*!< name specialisation */
-    T                m_min;
-    T                m_max;
-    T                m_step;
-    T                m_default_value; /*!< default value (used after set_default() call) */
-    std::optional<T> m_value = std::nullopt;
+    const char                    *m_name; /*!< name specialisation */
+    T                              m_min;
+    T                              m_max;
+    T                              m_step;
+    T                              m_default_value; /*!< default value (used after set_default() call) */
+    SeqLockValue<std::optional<T>> m_value;
 };
 
 /* Enum type */
@@ -359,47 +446,45 @@ class _Property<T, PT, typename std::enable_if<std::is_enum<T>::value>::type> :
 
     std::optional<T> get() const
     {
-        if (PropertyMutex::mutex)
-            PropertyMutex::mutex->lock();
-
-        std::optional<T> v = m_value;
-
-        if (PropertyMutex::mutex)
-            PropertyMutex::mutex->unlock();
-
-        return v;
+        return m_value.load();
     }
 
-    void set(T v)
+    // Returns true if the value has changed
+    bool set(T v)
     {
-        if (m_value.has_value() && *m_value == v)
-            return;
+        if (const auto current = m_value.load(); current.has_value() && *current == v)
+            return false;
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = v;
+        m_value.store(v);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
 
         log_info("Property (%s) set: %u", m_name, v);
+
+        return true;
     }
 
-    void set(T v, const char *desc)
+    // Returns true if the value has changed
+    bool set(T v, [[maybe_unused]] const char *desc)
     {
-        if (m_value.has_value() && *m_value == v)
-            return;
+        if (const auto current = m_value.load(); current.has_value() && *current == v)
+            return false;
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = v;
+        m_value.store(v);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
 
         log_info("Property (%s) set: %s", m_name, desc);
+
+        return true;
     }
 
     void set_default()
@@ -407,7 +492,7 @@ class _Property<T, PT, typename std::enable_if<std::is_enum<T>::value>::type> :
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = m_default_value;
+        m_value.store(m_default_value);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -421,7 +506,7 @@ class _Property<T, PT, typename std::enable_if<std::is_enum<T>::value>::type> :
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->lock();
 
-        m_value = std::nullopt;
+        m_value.store(std::nullopt);
 
         if (PropertyMutex::mutex)
             PropertyMutex::mutex->unlock();
@@ -430,9 +515,9 @@ class _Property<T, PT, typename std::enable_if<std::is_enum<T>::value>::type> :
     }
 
   private:
-    const char      *m_name;
-    T                m_default_value;
-    std::optional<T> m_value = std::nullopt;
+    const char                    *m_name;
+    T                              m_default_value;
+    SeqLockValue<std::optional<T>> m_value;
 };
 
 // clang-format off
@@ -442,7 +527,8 @@ class _Property<T, PT, typename std::enable_if<std::is_enum<T>::value>::type> :
 
 #define TS_GET_PROPERTY_FN(NAMESPACE, VARIABLE, TYPE) \
     std::optional<TYPE> getProperty(TYPE*) { \
-      return NAMESPACE::VARIABLE.get().has_value() ? std::optional<TYPE>{{NAMESPACE::VARIABLE.get().value()}} : std::nullopt; \
+      const auto v = NAMESPACE::VARIABLE.get(); \
+      return v.has_value() ? std::optional<TYPE>{{v.value()}} : std::nullopt; \
     }
 
 #define TS_GET_PROPERTY_NON_OPT_FN(NAMESPACE, VARIABLE, TYPE) \
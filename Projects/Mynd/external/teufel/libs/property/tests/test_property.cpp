@@ -0,0 +1,346 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "property/property.h"
+
+using namespace std::chrono_literals;
+
+// Stand-in for the recursive FreeRTOS mutex of the firmware, counting how often it is taken
+static std::recursive_mutex s_mutex;
+static std::atomic<uint32_t> s_lock_count;
+
+static IMutex s_property_mutex = {
+    .lock =
+        []()
+        {
+            s_lock_count++;
+            s_mutex.lock();
+        },
+    .unlock = []() { s_mutex.unlock(); },
+};
+
+enum class Mode : uint8_t
+{
+    Idle,
+    Playing,
+    Paused,
+};
+
+// Value which takes long to copy, a torn read mixes the words of two writes. The copy gives the other threads a
+// chance to run half way through, as a preemption during the copy would on the target (and on a single core host).
+struct Wide
+{
+    uint32_t words[16];
+
+    Wide() = default;
+    Wide(const Wide &other)
+    {
+        *this = other;
+    }
+    Wide &operator=(const Wide &other)
+    {
+        for (size_t i = 0; i < std::size(words); i++)
+        {
+            if (i == std::size(words) / 2)
+                std::this_thread::yield();
+            words[i] = other.words[i];
+        }
+        return *this;
+    }
+};
+
+static Wide make_wide(uint32_t v)
+{
+    Wide w{};
+    for (auto &word : w.words)
+        word = v;
+    return w;
+}
+
+static bool is_consistent(const Wide &w)
+{
+    for (const auto &word : w.words)
+        if (word != w.words[0])
+            return false;
+    return true;
+}
+
+class PropertyTest : public ::testing::Test
+{
+  protected:
+    void SetUp() override
+    {
+        PropertyMutex::mutex = &s_property_mutex;
+        s_lock_count         = 0;
+    }
+
+    void TearDown() override
+    {
+        PropertyMutex::mutex = nullptr;
+    }
+};
+
+TEST_F(PropertyTest, GetDoesNotTakeTheMutex)
+{
+    PropertyNonOpt<uint8_t> volume("volume", 0, 100, 1, 30, 50);
+    PropertyNonOpt<bool>    mute("mute", false, true);
+    Property<Mode>          mode("mode", Mode::Idle);
+
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(volume.get().value(), 50);
+        EXPECT_TRUE(mute.get().value());
+        EXPECT_FALSE(mode.get().has_value());
+    }
+    EXPECT_EQ(s_lock_count, 0u);
+}
+
+TEST_F(PropertyTest, SetStillSerialisesTheWriters)
+{
+    Property<uint8_t> volume("volume", 0, 100, 1, 30);
+
+    EXPECT_TRUE(volume.set(42));
+    EXPECT_EQ(s_lock_count, 1u);
+    EXPECT_EQ(volume.get().value(), 42);
+
+    // Unchanged value, compared with a snapshot, nothing to write
+    EXPECT_FALSE(volume.set(42));
+    EXPECT_EQ(s_lock_count, 1u);
+
+    // Out of range, rejected
+    EXPECT_FALSE(volume.set(101));
+    EXPECT_EQ(volume.get().value(), 42);
+
+    volume.set_default();
+    EXPECT_EQ(volume.get().value(), 30);
+
+    volume.invalidate();
+    EXPECT_FALSE(volume.get().has_value());
+    EXPECT_EQ(s_lock_count, 3u);
+}
+
+TEST_F(PropertyTest, EnumAndBool)
+{
+    Property<Mode> mode("mode", Mode::Idle);
+    Property<bool> mute("mute", false);
+
+    EXPECT_TRUE(mode.set(Mode::Playing));
+    EXPECT_TRUE(mute.set(true));
+    EXPECT_FALSE(mute.set(true));
+    EXPECT_EQ(mode.get(), Mode::Playing);
+    EXPECT_EQ(mute.get(), true);
+
+    mode.set(Mode::Paused, "paused");
+    mode.invalidate();
+    mute.set_default();
+    EXPECT_FALSE(mode.get().has_value());
+    EXPECT_EQ(mute.get(), false);
+}
+
+TEST_F(PropertyTest, ReadersDoNotWaitForTheMutexHolder)
+{
+    // A writer, or anything else holding the property mutex, is preempted. The readers go on with the last value
+    // instead of blocking behind it (on the target: a higher priority task waiting for a lower priority one)
+    PropertyNonOpt<uint8_t> volume("volume", 0, 100, 1, 30, 50);
+
+    std::atomic<bool> held{false}, readers_done{false};
+    std::thread       holder(
+        [&]
+        {
+            s_mutex.lock();
+            held = true;
+            for (auto deadline = std::chrono::steady_clock::now() + 5s;
+                 !readers_done && std::chrono::steady_clock::now() < deadline;)
+                std::this_thread::sleep_for(1ms);
+            s_mutex.unlock();
+        });
+
+    while (!held)
+        std::this_thread::yield();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100000; i++)
+        ASSERT_EQ(volume.get().value(), 50);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    readers_done = true;
+    holder.join();
+
+    EXPECT_LT(elapsed, 1s);
+    EXPECT_EQ(s_lock_count, 0u);
+}
+
+TEST_F(PropertyTest, NoTornReadsUnderContention)
+{
+    SeqLockValue<Wide> value(make_wide(0));
+
+    constexpr uint32_t writes = 50000;
+    std::atomic<bool>  writing{true};
+    std::atomic<int>   torn{0};
+    std::atomic<int>   reads{0};
+
+    std::thread writer(
+        [&]
+        {
+            for (uint32_t i = 1; i <= writes; i++)
+            {
+                PropertyMutex::mutex->lock();
+                value.store(make_wide(i));
+                PropertyMutex::mutex->unlock();
+            }
+            writing = false;
+        });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; r++)
+        readers.emplace_back(
+            [&]
+            {
+                uint32_t last = 0;
+                while (writing)
+                {
+                    const Wide w = value.load();
+                    if (!is_consistent(w) || w.words[0] < last)
+                        torn++;
+                    last = w.words[0];
+                    reads++;
+                }
+            });
+
+    writer.join();
+    for (auto &reader : readers)
+        reader.join();
+
+    EXPECT_EQ(torn, 0);
+    EXPECT_EQ(value.load().words[0], writes);
+
+    // The writer locked once per write, the rest are the readers which met a write in progress
+    printf("%d reads during %u writes, %u fell back to the mutex\n", reads.load(), writes, s_lock_count - writes);
+}
+
+TEST_F(PropertyTest, SnapshotTakesTheMutexOnce)
+{
+    PropertyNonOpt<uint8_t> level("level", 0, 100, 1, 100, 40);
+    PropertyNonOpt<Mode>    mode("mode", Mode::Idle, Mode::Paused);
+    Property<bool>          mute("mute", false);
+
+    const auto [l, m, u] = snapshot(level, mode, mute);
+    EXPECT_EQ(l, 40);
+    EXPECT_EQ(m, Mode::Paused);
+    EXPECT_FALSE(u.has_value());
+    EXPECT_EQ(s_lock_count, 1u);
+}
+
+TEST_F(PropertyTest, SnapshotSeesGroupedWritesTogether)
+{
+    // The writers keep level + other == 100, changing both under a PropertyLock, with a yield in between as if they
+    // were preempted. Two separate reads can see one change without the other, a snapshot cannot.
+    PropertyNonOpt<uint8_t> level("level", 0, 100, 1, 0, 0);
+    PropertyNonOpt<uint8_t> other("other", 0, 100, 1, 100, 100);
+
+    std::atomic<bool> writing{true};
+    std::atomic<int>  torn_snapshots{0}, torn_separate{0}, snapshots{0};
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; w++)
+        writers.emplace_back(
+            [&, w]
+            {
+                for (int i = 0; i < 20000; i++)
+                {
+                    const uint8_t v = static_cast<uint8_t>((i + w * 50) % 101);
+                    PropertyLock  lock;
+                    level.set(v);
+                    std::this_thread::yield();
+                    other.set(100 - v);
+                }
+            });
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; r++)
+        readers.emplace_back(
+            [&]
+            {
+                while (writing)
+                {
+                    const auto [l, o] = snapshot(level, other);
+                    if (l.value() + o.value() != 100)
+                        torn_snapshots++;
+                    snapshots++;
+
+                    if (level.get().value() + other.get().value() != 100)
+                        torn_separate++;
+
+                    std::this_thread::yield();
+                }
+            });
+
+    for (auto &writer : writers)
+        writer.join();
+    writing = false;
+    for (auto &reader : readers)
+        reader.join();
+
+    EXPECT_EQ(torn_snapshots, 0);
+    EXPECT_GT(snapshots, 0);
+    EXPECT_EQ(level.get().value() + other.get().value(), 100);
+
+    printf("%d snapshots, all consistent; %d pairs of separate reads were not\n", snapshots.load(),
+           torn_separate.load());
+}
+
+// Not a pass/fail test: prints the cost of a read, with the seqlock and with the mutex as before
+TEST_F(PropertyTest, ReadCostBenchmark)
+{
+    PropertyNonOpt<uint8_t> volume("volume", 0, 100, 1, 30, 50);
+    std::optional<uint8_t>  shadow = 50;
+
+    constexpr int reads = 2000000;
+    uint32_t      sum   = 0;
+
+    auto measure = [&](auto &&read)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < reads; i++)
+            sum += read().value();
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / reads;
+    };
+
+    auto seqlock_read = [&] { return volume.get(); };
+    auto mutex_read   = [&]
+    {
+        PropertyMutex::mutex->lock();
+        auto v = shadow;
+        PropertyMutex::mutex->unlock();
+        return v;
+    };
+
+    const double seqlock_ns = measure(seqlock_read);
+    const double mutex_ns   = measure(mutex_read);
+
+    // Same again with a writer changing the value all the time
+    std::atomic<bool> writing{true};
+    std::thread       writer(
+        [&]
+        {
+            for (uint8_t v = 0; writing; v = (v + 1) % 100)
+                volume.set(v);
+        });
+    const double seqlock_contended_ns = measure(seqlock_read);
+    const double mutex_contended_ns   = measure(mutex_read);
+    writing = false;
+    writer.join();
+
+    printf("read cost (ns)     uncontended  with a writer\n");
+    printf("  seqlock          %11.1f  %13.1f\n", seqlock_ns, seqlock_contended_ns);
+    printf("  mutex            %11.1f  %13.1f\n", mutex_ns, mutex_contended_ns);
+
+    EXPECT_NE(sum, 0u);
+}
@@ -6,7 +6,7 @@ extern uint32_t SystemCoreClock;
 #define portREMOVE_STATIC_QUALIFIER
 
 #define configUSE_PREEMPTION                  1
-#define configUSE_TICKLESS_IDLE               0
+#define configUSE_TICKLESS_IDLE               2
 #define configSUPPORT_STATIC_ALLOCATION       1
 #define configSUPPORT_DYNAMIC_ALLOCATION      0
 #define configCPU_CLOCK_HZ                    (SystemCoreClock)
@@ -23,6 +23,16 @@ extern uint32_t SystemCoreClock;
 #define configUSE_RECURSIVE_MUTEXES           1
 #define configQUEUE_REGISTRY_SIZE             8
 
+/* Tickless idle, implemented by the BSP to enter STOP mode while the speaker is off (see bsp_low_power.h) */
+#define configEXPECTED_IDLE_TIME_BEFORE_SLEEP 5
+#if !defined(__ASSEMBLER__)
+#if defined(__cplusplus)
+extern "C"
+#endif
+    void bsp_low_power_suppress_ticks_and_sleep(uint32_t expected_idle_ticks);
+#endif
+#define portSUPPRESS_TICKS_AND_SLEEP(xExpectedIdleTime) bsp_low_power_suppress_ticks_and_sleep(xExpectedIdleTime)
+
 /* Hook function related definitions. */
 #define configUSE_IDLE_HOOK                1
 #define configUSE_TICK_HOOK                0
@@ -31,9 +41,55 @@ extern uint32_t SystemCoreClock;
 #define configUSE_DAEMON_TASK_STARTUP_HOOK 1
 
 #define configUSE_STATS_FORMATTING_FUNCTIONS 0
-#define configGENERATE_RUN_TIME_STATS        0
 
-#define configUSE_TRACE_FACILITY 0
+/* Run time stats for the task load of the 'tasks' shell command, read with uxTaskGetSystemState() */
+#if defined(TASK_RUN_TIME_STATS)
+#define configGENERATE_RUN_TIME_STATS 1
+#define configUSE_TRACE_FACILITY      1
+#if !defined(__ASSEMBLER__)
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+    void     bsp_run_time_stats_timer_init(void);
+    uint32_t bsp_run_time_stats_timer_get(void);
+#if defined(__cplusplus)
+}
+#endif
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS() bsp_run_time_stats_timer_init()
+#define portGET_RUN_TIME_COUNTER_VALUE()         bsp_run_time_stats_timer_get()
+#else
+#define configGENERATE_RUN_TIME_STATS 0
+#define configUSE_TRACE_FACILITY      0
+#endif
+
+/* Scheduling trace of the 'trace' shell command (see trace.h), timestamped by the run time stats clock */
+#if defined(TRACE_RECORDER)
+#if !defined(TASK_RUN_TIME_STATS)
+#error "TRACE_RECORDER needs the run time stats clock and the task numbers of TASK_RUN_TIME_STATS"
+#endif
+#if !defined(__ASSEMBLER__)
+#include "trace.h"
+#endif
+#define traceTASK_SWITCHED_IN() trace_record(TRACE_TASK_SWITCHED_IN, (uint8_t) pxCurrentTCB->uxTCBNumber, 0)
+#define traceQUEUE_SEND(pxQueue)                                                                                       \
+    trace_record(TRACE_QUEUE_SEND, (pxQueue)->ucQueueType, (uint16_t) (uintptr_t) (pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue)                                                                              \
+    trace_record(TRACE_QUEUE_SEND, (pxQueue)->ucQueueType, (uint16_t) (uintptr_t) (pxQueue))
+#define traceQUEUE_SEND_FAILED(pxQueue)                                                                                \
+    trace_record(TRACE_QUEUE_SEND_FAILED, (pxQueue)->ucQueueType, (uint16_t) (uintptr_t) (pxQueue))
+#define traceQUEUE_SEND_FROM_ISR_FAILED(pxQueue)                                                                       \
+    trace_record(TRACE_QUEUE_SEND_FAILED, (pxQueue)->ucQueueType, (uint16_t) (uintptr_t) (pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue)                                                                                    \
+    trace_record(TRACE_QUEUE_RECEIVE, (pxQueue)->ucQueueType, (uint16_t) (uintptr_t) (pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue)                                                                           \
+    trace_record(TRACE_QUEUE_RECEIVE, (pxQueue)->ucQueueType, (uint16_t) (uintptr_t) (pxQueue))
+#define traceTASK_NOTIFY(uxIndexToNotify) trace_record(TRACE_TASK_NOTIFY, (uint8_t) pxTCB->uxTCBNumber, 0)
+#define traceTASK_NOTIFY_FROM_ISR(uxIndexToNotify) trace_record(TRACE_TASK_NOTIFY, (uint8_t) pxTCB->uxTCBNumber, 0)
+#define traceTASK_NOTIFY_GIVE_FROM_ISR(uxIndexToNotify)                                                                \
+    trace_record(TRACE_TASK_NOTIFY, (uint8_t) pxTCB->uxTCBNumber, 0)
+#endif
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES           0
@@ -55,13 +111,13 @@ extern uint32_t SystemCoreClock;
 #define INCLUDE_vTaskDelay                  1
 #define INCLUDE_xTaskGetSchedulerState      0
 #define INCLUDE_xTaskGetCurrentTaskHandle   1
-#define INCLUDE_uxTaskGetStackHighWaterMark 0
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
 #define INCLUDE_xTaskGetIdleTaskHandle      0
 #define INCLUDE_eTaskGetState               0
 #define INCLUDE_xEventGroupSetBitFromISR    1
 #define INCLUDE_xTimerPendFunctionCall      1
 #define INCLUDE_xTaskAbortDelay             0
-#define INCLUDE_xTaskGetHandle              1
+#define INCLUDE_xTaskGetHandle              0
 #define INCLUDE_xTaskResumeFromISR          1
 #define INCLUDE_xQueueGetMutexHolder        1
 
@@ -27,10 +27,12 @@
 #include "board_link_usb_pd_controller.h"
 #include "board_link_eeprom.h"
 #include "bsp_adc.h"
+#include "deferred_work.h"
 
 #include "ux/system/system.h"
 
 #include "external/teufel/libs/property/property.h"
+#include "property_bus.h"
 #include "external/teufel/libs/app_assert/app_assert.h"
 #include "external/teufel/libs/core_utils/ewma.h"
 #include "external/teufel/libs/core_utils/hysteresis.h"
@@ -81,6 +83,8 @@ static std::optional<int> get_battery_current();
 static SemaphoreHandle_t sys_adc_buffer_mutex = nullptr;
 static StaticSemaphore_t sys_adc_buffer_mutex_buffer;
 
+static volatile bool s_adc_smoothing_pending = false;
+
 static constexpr uint8_t c_bat_adc_voltage_divider_ratio = (10000 + 5000) / 5000;
 
 #ifdef INCLUDE_PRODUCTION_TESTS
@@ -177,29 +181,45 @@ void init()
         s_battery.is_charger_initialized = true;
     }
 
+    // Runs in the deferred worker task, the DMA keeps filling the buffer meanwhile (each sample stays at the index
+    // of its channel)
+    static constexpr deferred_work_fn_t smooth_adc_samples = +[](void *)
+    {
+        s_adc_smoothing_pending = false;
+
+        if (xSemaphoreTake(sys_adc_buffer_mutex, 0) == pdFALSE)
+            return;
+
+        static uint32_t s_sample_tick_last = 0;
+        auto            tick               = get_systick();
+        // adc_conv_time_ms = tick - s_sample_tick_last;
+        s_sample_tick_last = std::exchange(tick, get_systick());
+
+        // TODO: drop it, after PP samples are not used anymore
+        for (uint32_t i = 0; i < adc_buffer_size; i += adc_number_of_sampled_channels)
+        {
+            bat_voltage_smoother(s_adc_buffer[i]);
+            isens_ref_smoother(s_adc_buffer[i + 1]);
+            isens_smoother(s_adc_buffer[i + 2]);
+            psys_smoother(s_adc_buffer[i + 3]);
+            ntc_sens_smoother(s_adc_buffer[i + 4]);
+            vrefint_smoother(s_adc_buffer[i + 5]);
+        }
+
+        xSemaphoreGive(sys_adc_buffer_mutex);
+    };
+
     bsp_adc_start((uint32_t *) s_adc_buffer, adc_buffer_size,
                   +[]()
                   {
-                      if (xSemaphoreTakeFromISR(sys_adc_buffer_mutex, NULL) == pdFALSE)
+                      // The samples are smoothed out of the interrupt. Conversions completed before the worker got to
+                      // them are smoothed by the work already queued.
+                      if (s_adc_smoothing_pending)
                           return;
 
-                      static uint32_t s_sample_tick_last = 0;
-                      auto            tick               = get_systick();
-                      // adc_conv_time_ms = tick - s_sample_tick_last;
-                      s_sample_tick_last = std::exchange(tick, get_systick());
-
-                      // TODO: drop it, after PP samples are not used anymore
-                      for (uint32_t i = 0; i < adc_buffer_size; i += adc_number_of_sampled_channels)
-                      {
-                          bat_voltage_smoother(s_adc_buffer[i]);
-                          isens_ref_smoother(s_adc_buffer[i + 1]);
-                          isens_smoother(s_adc_buffer[i + 2]);
-                          psys_smoother(s_adc_buffer[i + 3]);
-                          ntc_sens_smoother(s_adc_buffer[i + 4]);
-                          vrefint_smoother(s_adc_buffer[i + 5]);
-                      }
-
-                      xSemaphoreGiveFromISR(sys_adc_buffer_mutex, NULL);
+                      s_adc_smoothing_pending = true;
+                      if (deferred_work_post_from_isr(smooth_adc_samples, nullptr) != 0)
+                          s_adc_smoothing_pending = false;
                   });
 }
 
@@ -94,7 +94,7 @@ void board_link_amps_enable(bool enable)
     log_info("Amps power %s", enable ? "enabled" : "disabled");
 }
 
-int board_link_amps_setup_woofer(board_link_amps_mode_t mode)
+int board_link_amps_configure_woofer(board_link_amps_mode_t mode)
 {
     int result = 0;
 
@@ -145,6 +145,13 @@ int board_link_amps_setup_woofer(board_link_amps_mode_t mode)
         board_link_amps_set_envelope_tracking_mode(AMP_ENVELOPE_TRACKING_MODE_OFF_MAX_PVDD);
     }
 
+    return result;
+}
+
+int board_link_amps_setup_woofer(board_link_amps_mode_t mode)
+{
+    int result = board_link_amps_configure_woofer(mode);
+
     if (tas5825p_set_state(s_amps.tas5825p, TAS5825P_DEVICE_STATE_PLAY) != 0)
     {
         log_error("Failed to set woofer amp to Play state");
@@ -154,7 +161,7 @@ int board_link_amps_setup_woofer(board_link_amps_mode_t mode)
     return result;
 }
 
-int board_link_amps_setup_tweeter(board_link_amps_mode_t mode)
+int board_link_amps_configure_tweeter(board_link_amps_mode_t mode)
 {
     int result = 0;
     if (tas5805m_set_state(s_amps.tas5805m, TAS5805M_DEVICE_STATE_HI_Z) != 0)
@@ -208,6 +215,32 @@ int board_link_amps_setup_tweeter(board_link_amps_mode_t mode)
         }
     }
 
+    return result;
+}
+
+int board_link_amps_setup_tweeter(board_link_amps_mode_t mode)
+{
+    int result = board_link_amps_configure_tweeter(mode);
+
+    if (tas5805m_set_state(s_amps.tas5805m, TAS5805M_DEVICE_STATE_PLAY) != 0)
+    {
+        log_error("Failed to set tweeter amp to Play state");
+        result = -1;
+    }
+
+    return result;
+}
+
+int board_link_amps_play(void)
+{
+    int result = 0;
+
+    if (tas5825p_set_state(s_amps.tas5825p, TAS5825P_DEVICE_STATE_PLAY) != 0)
+    {
+        log_error("Failed to set woofer amp to Play state");
+        result = -1;
+    }
+
     if (tas5805m_set_state(s_amps.tas5805m, TAS5805M_DEVICE_STATE_PLAY) != 0)
     {
         log_error("Failed to set tweeter amp to Play state");
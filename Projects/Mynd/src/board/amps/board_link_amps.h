@@ -25,6 +25,24 @@ extern "C"
 
     void board_link_amps_enable(bool enable);
 
+    /**
+     * @brief Configures the DSP of an amp, which stays in Hi-Z.
+     *
+     * @details Does not need the I2S clocks, so it can be done while the BT module is booting.
+     *          board_link_amps_play() starts the playback once the I2S BCLK is stable.
+     */
+    int board_link_amps_configure_woofer(board_link_amps_mode_t mode);
+
+    int board_link_amps_configure_tweeter(board_link_amps_mode_t mode);
+
+    /**
+     * @brief Takes both amps out of Hi-Z, the I2S BCLK must be stable.
+     */
+    int board_link_amps_play(void);
+
+    /**
+     * @brief Configures the DSP of an amp and starts the playback, the I2S BCLK must be stable.
+     */
     int board_link_amps_setup_woofer(board_link_amps_mode_t mode);
 
     int board_link_amps_setup_tweeter(board_link_amps_mode_t mode);
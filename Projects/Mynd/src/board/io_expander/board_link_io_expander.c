@@ -92,6 +92,13 @@ void board_link_io_expander_on_interrupt(void)
     }
 }
 
+bool board_link_io_expander_is_interrupt_pending(void)
+{
+    // Interrupt pin is active low
+    return s_io_expander.is_initialized &&
+           HAL_GPIO_ReadPin(IO_EXP_INT_GPIO_PORT, IO_EXP_INT_GPIO_PIN) == GPIO_PIN_RESET;
+}
+
 void board_link_io_expander_reset(bool assert)
 {
     // Reset pin is active low
@@ -37,6 +37,13 @@ extern "C"
      */
     void board_link_io_expander_on_interrupt(void);
 
+    /**
+     * @brief Checks the INT line of the IO expander, which stays asserted until the inputs are read.
+     *
+     * @return true if the IO expander signals an interrupt, false otherwise
+     */
+    bool board_link_io_expander_is_interrupt_pending(void);
+
     /**
      * @brief Asserts/deasserts the reset line of the IO expander.
      *
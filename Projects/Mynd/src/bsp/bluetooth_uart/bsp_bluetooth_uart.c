@@ -12,6 +12,10 @@ UART_HandleTypeDef          UART1_Handle;
 static StreamBufferHandle_t sbuffer_handle_rx;
 static volatile uint8_t     irq_rx_data[1] = {};
 static volatile bool        missed_rx_data = false;
+static uint32_t             baudrate       = BLUETOOTH_UART_BAUDRATE;
+
+// Only written from the UART ISR
+static volatile bsp_bluetooth_uart_stats_t stats;
 
 #define STORAGE_SIZE_BYTES 128u
 static uint8_t              sbuffer_storage[STORAGE_SIZE_BYTES];
@@ -19,15 +23,20 @@ static StaticStreamBuffer_t StreamBufferStruct;
 
 void bsp_bluetooth_uart_init(void)
 {
-    sbuffer_handle_rx = xStreamBufferCreateStatic(sizeof(sbuffer_storage), 0u, sbuffer_storage, &StreamBufferStruct);
+    // The init function may be called again to reconfigure the UART, the stream buffer is kept
     if (sbuffer_handle_rx == NULL)
     {
-        log_err("Failed to create stream buffer");
-        return;
+        sbuffer_handle_rx =
+            xStreamBufferCreateStatic(sizeof(sbuffer_storage), 0u, sbuffer_storage, &StreamBufferStruct);
+        if (sbuffer_handle_rx == NULL)
+        {
+            log_err("Failed to create stream buffer");
+            return;
+        }
     }
 
     UART1_Handle.Instance                    = BLUETOOTH_UART;
-    UART1_Handle.Init.BaudRate               = BLUETOOTH_UART_BAUDRATE;
+    UART1_Handle.Init.BaudRate               = baudrate;
     UART1_Handle.Init.WordLength             = UART_WORDLENGTH_8B;
     UART1_Handle.Init.StopBits               = UART_STOPBITS_1;
     UART1_Handle.Init.Parity                 = UART_PARITY_NONE;
@@ -43,6 +52,34 @@ void bsp_bluetooth_uart_init(void)
     HAL_UART_Receive_IT(&UART1_Handle, (uint8_t *) irq_rx_data, 1);
 }
 
+int bsp_bluetooth_uart_set_baudrate(uint32_t new_baudrate)
+{
+    if (new_baudrate == 0u || new_baudrate > BLUETOOTH_UART_MAX_BAUDRATE)
+    {
+        return -1;
+    }
+
+    // Let the last frame (usually the ACK that triggered the switch) leave the shift register
+    uint32_t ts = HAL_GetTick();
+    while (__HAL_UART_GET_FLAG(&UART1_Handle, UART_FLAG_TC) == RESET)
+    {
+        if (HAL_GetTick() - ts > 10u)
+        {
+            log_error("BT UART TX did not complete");
+            break;
+        }
+    }
+
+    // The pins and the NVIC stay configured, only the peripheral is reinitialized
+    HAL_UART_AbortReceive_IT(&UART1_Handle);
+    baudrate = new_baudrate;
+    bsp_bluetooth_uart_init();
+
+    // Whatever is buffered was received with the old baudrate
+    bsp_bluetooth_uart_clear_buffer();
+    return 0;
+}
+
 void bsp_bluetooth_uart_msp_init(void)
 {
     GPIO_InitTypeDef GPIO_InitStruct;
@@ -143,13 +180,42 @@ void bsp_bluetooth_uart_isr_rx_complete_callback(void)
             1)
         {
             missed_rx_data = true;
+            stats.dropped_bytes++;
         }
     }
     else
     {
         missed_rx_data = true;
+        stats.dropped_bytes++;
     }
 
     // Start receiving
     HAL_UART_Receive_IT(&UART1_Handle, (uint8_t *) irq_rx_data, 1);
 }
+
+void bsp_bluetooth_uart_isr_error_callback(uint32_t error_code)
+{
+    if (error_code & HAL_UART_ERROR_ORE)
+        stats.overruns++;
+    if (error_code & HAL_UART_ERROR_FE)
+        stats.framing_errors++;
+    if (error_code & HAL_UART_ERROR_NE)
+        stats.noise_errors++;
+
+    // An overrun aborts the reception, framing and noise errors don't (HAL_BUSY then)
+    HAL_UART_Receive_IT(&UART1_Handle, (uint8_t *) irq_rx_data, 1);
+}
+
+void bsp_bluetooth_uart_get_stats(bsp_bluetooth_uart_stats_t *p_stats)
+{
+    taskENTER_CRITICAL();
+    *p_stats = stats;
+    taskEXIT_CRITICAL();
+}
+
+void bsp_bluetooth_uart_reset_stats(void)
+{
+    taskENTER_CRITICAL();
+    stats = (bsp_bluetooth_uart_stats_t) {0};
+    taskEXIT_CRITICAL();
+}
@@ -8,11 +8,30 @@ extern "C"
 {
 #endif
 
+    typedef struct
+    {
+        uint32_t overruns;       // Bytes overwritten in the data register before the ISR read them
+        uint32_t framing_errors;
+        uint32_t noise_errors;
+        uint32_t dropped_bytes;  // Bytes received while the RX buffer was full
+    } bsp_bluetooth_uart_stats_t;
+
     /**
      * @brief Initializes the UART hardware needed to interface with the Bluetooth module.
+     * @note  Calling it again reconfigures the UART with the baudrate set by `bsp_bluetooth_uart_set_baudrate()`.
      */
     void bsp_bluetooth_uart_init(void);
 
+    /**
+     * @brief Changes the baudrate of the UART connected to the Bluetooth module.
+     * @note  Pending TX data is sent with the old baudrate, buffered RX data is discarded.
+     *
+     * @param[in] new_baudrate  baudrate to switch to (up to BLUETOOTH_UART_MAX_BAUDRATE)
+     *
+     * @return 0 if successful, -1 otherwise
+     */
+    int bsp_bluetooth_uart_set_baudrate(uint32_t new_baudrate);
+
     void bsp_bluetooth_uart_msp_init(void);
 
     void bsp_bluetooth_uart_msp_deinit(void);
@@ -45,6 +64,18 @@ extern "C"
      */
     int bsp_bluetooth_uart_rx(uint8_t *p_data, size_t length);
 
+    /**
+     * @brief Gets the error counters of the UART connected to the Bluetooth module.
+     *
+     * @param[out] p_stats  pointer to where the counters will be written to
+     */
+    void bsp_bluetooth_uart_get_stats(bsp_bluetooth_uart_stats_t *p_stats);
+
+    /**
+     * @brief Resets the error counters of the UART connected to the Bluetooth module.
+     */
+    void bsp_bluetooth_uart_reset_stats(void);
+
 #if defined(__cplusplus)
 }
 #endif
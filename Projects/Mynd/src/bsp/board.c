@@ -39,6 +39,21 @@ uint32_t get_systick(void)
     return xTaskGetTickCount();
 }
 
+uint32_t board_get_us(void)
+{
+    uint32_t tick_ms;
+    uint32_t systick_val;
+
+    // Retry if the tick count changed while sampling the SysTick counter
+    do
+    {
+        tick_ms     = xTaskGetTickCount();
+        systick_val = SysTick->VAL;
+    } while (tick_ms != xTaskGetTickCount());
+
+    return tick_ms * 1000u + ((SysTick->LOAD - systick_val) * 1000u) / (SysTick->LOAD + 1u);
+}
+
 uint32_t board_get_ms_since(uint32_t tick_ms)
 {
     uint32_t current_tick_ms = get_systick();
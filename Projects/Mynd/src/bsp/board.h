@@ -10,6 +10,8 @@ extern "C"
     void     board_init(void);
     uint32_t get_systick(void);
     uint32_t board_get_ms_since(uint32_t tick_ms);
+    // Microseconds since the scheduler started (wraps around after ~71 minutes), task context only
+    uint32_t board_get_us(void);
 
 #if defined(__cplusplus)
 }
@@ -121,6 +121,7 @@
 #define BLUETOOTH_UART_CLK_DISABLE()        __HAL_RCC_USART1_CLK_DISABLE()
 #define BLUETOOTH_UART                      USART1
 #define BLUETOOTH_UART_BAUDRATE             115200
+#define BLUETOOTH_UART_MAX_BAUDRATE         460800
 #define BLUETOOTH_UART_IRQn                 USART1_IRQn
 
 // Debug UART TX pin
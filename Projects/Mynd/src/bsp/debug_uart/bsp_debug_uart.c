@@ -6,6 +6,7 @@
 #include "stm32f0xx_hal.h"
 #include "stm32f0xx_ll_usart.h"
 #include "logger.h"
+#include "bsp_low_power.h"
 #include <stdbool.h>
 
 UART_HandleTypeDef          UART2_Handle;
@@ -14,6 +15,8 @@ static uint8_t              irq_rx_data[1] = {};
 static volatile bool        missed_rx_data = false;
 
 #define STORAGE_SIZE_BYTES 32
+// The first byte received in STOP mode is lost, the following ones must be received
+#define DEBUG_UART_STAY_AWAKE_MS 30000u
 static uint8_t              sbuffer_storage[STORAGE_SIZE_BYTES];
 static StaticStreamBuffer_t StreamBufferStruct;
 
@@ -105,6 +108,9 @@ int bsp_debug_uart_rx(uint8_t *p_data, size_t length)
 
 void bsp_debug_uart_isr_rx_complete_callback(void)
 {
+    // The UART does not run in STOP mode, stay awake while someone is typing
+    bsp_low_power_stay_awake(DEBUG_UART_STAY_AWAKE_MS);
+
     if (xStreamBufferIsFull(sbuffer_handle_rx) == pdFALSE)
     {
         if (xStreamBufferSendFromISR(sbuffer_handle_rx, (uint8_t *) irq_rx_data, (size_t) 1, (BaseType_t *) pdFALSE) !=
@@ -0,0 +1,252 @@
+#include "bsp_low_power.h"
+#include "board_hw.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stm32f0xx_hal.h"
+#include "logger.h"
+
+// Shorter sleeps are not worth restarting HSI48 for
+#define MIN_STOP_TICKS      5u
+// Keeps the seconds of the RTC unambiguous when measuring the time spent in STOP mode
+#define MAX_STOP_TICKS      20000u
+#define RTC_WAKEUP_DIV      16u
+#define RTC_PREDIV_A        4u
+#define EXTI_LINE_RTC_WAKEUP (1UL << 20)
+
+extern I2C_HandleTypeDef I2C1_Handle;
+extern I2C_HandleTypeDef I2C2_Handle;
+
+// LSI is only accurate to about +-25%, so is the tick count while in STOP mode. Nothing depends on precise timing
+// while the speaker is off.
+static uint32_t          m_rtc_clock_hz   = 0;
+static uint32_t          m_rtc_subsec_hz  = 0;
+static volatile bool     m_stop_allowed   = false;
+static volatile uint32_t m_awake_until_ms = 0;
+static uint32_t          m_residual_us    = 0;
+
+static void rtc_unlock(void)
+{
+    RTC->WPR = 0xCA;
+    RTC->WPR = 0x53;
+}
+
+static void rtc_lock(void)
+{
+    RTC->WPR = 0xFF;
+}
+
+// Gets the time of the RTC in sub-second units, within the current minute
+static uint32_t rtc_get_subsec_of_minute(void)
+{
+    uint32_t ssr, tr;
+
+    // Shadow registers are bypassed, read until no second boundary is crossed in between
+    do
+    {
+        ssr = RTC->SSR;
+        tr  = RTC->TR;
+    } while (ssr != RTC->SSR || tr != RTC->TR);
+
+    uint32_t seconds = ((tr & RTC_TR_ST) >> RTC_TR_ST_Pos) * 10u + ((tr & RTC_TR_SU) >> RTC_TR_SU_Pos);
+    return seconds * m_rtc_subsec_hz + (m_rtc_subsec_hz - 1u - ssr);
+}
+
+static void rtc_clear_wakeup_flag(void)
+{
+    RTC->ISR = (~(RTC_ISR_WUTF | RTC_ISR_INIT) & 0x0000FFFFu) | (RTC->ISR & RTC_ISR_INIT);
+}
+
+static void rtc_start_wakeup_timer(uint32_t ms)
+{
+    uint32_t counts = (ms * (m_rtc_clock_hz / RTC_WAKEUP_DIV)) / 1000u;
+
+    rtc_unlock();
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    while ((RTC->ISR & RTC_ISR_WUTWF) == 0)
+        ;
+    RTC->WUTR = (counts > 1u) ? counts - 1u : 0u;
+    RTC->CR   = (RTC->CR & ~RTC_CR_WUCKSEL) | RTC_CR_WUTE | RTC_CR_WUTIE; // WUCKSEL 0: RTC clock / 16
+    rtc_clear_wakeup_flag();
+    rtc_lock();
+}
+
+static void rtc_stop_wakeup_timer(void)
+{
+    rtc_unlock();
+    RTC->CR &= ~(RTC_CR_WUTE | RTC_CR_WUTIE);
+    rtc_clear_wakeup_flag();
+    rtc_lock();
+
+    EXTI->PR = EXTI_LINE_RTC_WAKEUP;
+}
+
+static uint32_t gpio_port_index(GPIO_TypeDef *port)
+{
+    return ((uint32_t) port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE);
+}
+
+// Lets a pin wake the MCU up from STOP mode with an event on both edges, without changing the GPIO configuration
+static void exti_enable_wakeup_event(GPIO_TypeDef *port, uint16_t pin)
+{
+    uint32_t line  = __builtin_ctz(pin);
+    uint32_t shift = (line % 4u) * 4u;
+
+    SYSCFG->EXTICR[line / 4u] = (SYSCFG->EXTICR[line / 4u] & ~(0xFu << shift)) | (gpio_port_index(port) << shift);
+    EXTI->RTSR |= pin;
+    EXTI->FTSR |= pin;
+    EXTI->EMR |= pin;
+}
+
+static bool is_peripheral_busy(void)
+{
+    HAL_I2C_StateTypeDef i2c1_state = HAL_I2C_GetState(&I2C1_Handle);
+    HAL_I2C_StateTypeDef i2c2_state = HAL_I2C_GetState(&I2C2_Handle);
+    if ((i2c1_state != HAL_I2C_STATE_READY && i2c1_state != HAL_I2C_STATE_RESET) ||
+        (i2c2_state != HAL_I2C_STATE_READY && i2c2_state != HAL_I2C_STATE_RESET))
+    {
+        return true;
+    }
+
+    // The last byte written to a UART is still being shifted out
+    if (((USART1->CR1 & USART_CR1_UE) && (USART1->ISR & USART_ISR_TC) == 0) ||
+        ((USART2->CR1 & USART_CR1_UE) && (USART2->ISR & USART_ISR_TC) == 0))
+    {
+        return true;
+    }
+
+    // The charge controller needs fresh battery readings, the ADC does not convert in STOP mode
+    if (HAL_GPIO_ReadPin(AC_OK_GPIO_PORT, AC_OK_GPIO_PIN) == GPIO_PIN_SET)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+static void restore_system_clock(void)
+{
+    // STOP mode switches the system clock to HSI (8 MHz), the flash latency is kept
+    __HAL_RCC_HSI48_ENABLE();
+    while (__HAL_RCC_GET_FLAG(RCC_FLAG_HSI48RDY) == RESET)
+        ;
+    __HAL_RCC_SYSCLK_CONFIG(RCC_SYSCLKSOURCE_HSI48);
+    while (__HAL_RCC_GET_SYSCLK_SOURCE() != RCC_SYSCLKSOURCE_STATUS_HSI48)
+        ;
+}
+
+void bsp_low_power_init(void)
+{
+    HAL_PWR_EnableBkUpAccess();
+
+    // Selecting another RTC clock would require a backup domain reset, losing the update flag in BKP0R
+    switch (RCC->BDCR & RCC_BDCR_RTCSEL)
+    {
+        case 0:
+            RCC->BDCR |= RCC_BDCR_RTCSEL_LSI;
+            // fall through
+        case RCC_BDCR_RTCSEL_LSI:
+            __HAL_RCC_LSI_ENABLE();
+            while (__HAL_RCC_GET_FLAG(RCC_FLAG_LSIRDY) == RESET)
+                ;
+            m_rtc_clock_hz = LSI_VALUE;
+            break;
+        case RCC_BDCR_RTCSEL_LSE:
+            m_rtc_clock_hz = LSE_VALUE;
+            break;
+        default:
+            log_warning("Unsupported RTC clock, STOP mode disabled");
+            return;
+    }
+    __HAL_RCC_RTC_ENABLE();
+
+    // Only the sub-seconds and seconds of the calendar are used, to measure the time spent in STOP mode
+    m_rtc_subsec_hz = m_rtc_clock_hz / RTC_PREDIV_A;
+    rtc_unlock();
+    RTC->ISR |= RTC_ISR_INIT;
+    while ((RTC->ISR & RTC_ISR_INITF) == 0)
+        ;
+    RTC->PRER = m_rtc_subsec_hz - 1u;
+    RTC->PRER |= (RTC_PREDIV_A - 1u) << RTC_PRER_PREDIV_A_Pos;
+    RTC->ISR &= ~RTC_ISR_INIT;
+    RTC->CR |= RTC_CR_BYPSHAD;
+    rtc_lock();
+
+    // The wakeup timer, the power button and the AC detection only wake up from STOP mode (events, no interrupts).
+    // The buttons behind the IO expander wake up through its interrupt, like any other pending interrupt.
+    EXTI->RTSR |= EXTI_LINE_RTC_WAKEUP;
+    EXTI->EMR |= EXTI_LINE_RTC_WAKEUP;
+    exti_enable_wakeup_event(POWER_BUTTON_GPIO_PORT, POWER_BUTTON_GPIO_PIN);
+    exti_enable_wakeup_event(AC_OK_GPIO_PORT, AC_OK_GPIO_PIN);
+    SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+}
+
+void bsp_low_power_allow_stop(bool allow)
+{
+    m_stop_allowed = allow;
+}
+
+void bsp_low_power_stay_awake(uint32_t ms)
+{
+    uint32_t until_ms = xTaskGetTickCountFromISR() + ms;
+    if ((int32_t) (until_ms - m_awake_until_ms) > 0)
+    {
+        m_awake_until_ms = until_ms;
+    }
+}
+
+void bsp_low_power_suppress_ticks_and_sleep(uint32_t expected_idle_ticks)
+{
+    if (!m_stop_allowed || m_rtc_clock_hz == 0 || expected_idle_ticks < MIN_STOP_TICKS ||
+        (int32_t) (xTaskGetTickCount() - m_awake_until_ms) < 0 || is_peripheral_busy())
+    {
+        return;
+    }
+
+    if (expected_idle_ticks > MAX_STOP_TICKS)
+    {
+        expected_idle_ticks = MAX_STOP_TICKS;
+    }
+
+    __disable_irq();
+
+    // A task got ready, or a tick or an interrupt is pending meanwhile (only new ones wake up from STOP mode)
+    if (eTaskConfirmSleepModeStatus() == eAbortSleep || (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) ||
+        (NVIC->ISPR[0] & NVIC->ISER[0]))
+    {
+        __enable_irq();
+        return;
+    }
+
+    SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+    uint32_t since_tick_us = ((SysTick->LOAD - SysTick->VAL) * 1000u) / (SysTick->LOAD + 1u);
+    uint32_t start         = rtc_get_subsec_of_minute();
+
+    // Wake up a tick early, the remainder is slept with the tick running
+    rtc_start_wakeup_timer(expected_idle_ticks - 1u);
+    HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFE);
+
+    restore_system_clock();
+    rtc_stop_wakeup_timer();
+
+    uint32_t end = rtc_get_subsec_of_minute();
+    if (end < start)
+    {
+        end += 60u * m_rtc_subsec_hz;
+    }
+
+    // The part of a tick left over is carried to the next sleep, so that the tick count does not drift
+    uint64_t slept_us = ((uint64_t) (end - start) * 1000000u) / m_rtc_subsec_hz;
+    uint32_t total_us = (uint32_t) slept_us + since_tick_us + m_residual_us;
+    uint32_t ticks    = total_us / 1000u;
+    m_residual_us     = total_us % 1000u;
+    if (ticks > expected_idle_ticks)
+    {
+        ticks = expected_idle_ticks;
+    }
+    vTaskStepTick(ticks);
+
+    SysTick->VAL = 0;
+    SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+    __enable_irq();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Prepares the RTC wakeup timer and the wakeup sources used by the tickless idle.
+     * @note  Must be called once the scheduler is running. Until then, the idle task only sleeps with WFI.
+     */
+    void bsp_low_power_init(void);
+
+    /**
+     * @brief Allows or forbids STOP mode while the system is idle.
+     * @note  Allowed while the speaker is off only: peripherals such as the Bluetooth UART and the
+     *        amplifiers do not survive STOP mode. The tick keeps running while STOP mode is forbidden.
+     */
+    void bsp_low_power_allow_stop(bool allow);
+
+    /**
+     * @brief Keeps the MCU out of STOP mode for the given time, e.g. after debug UART input, which cannot
+     *        wake the MCU up from STOP mode. Can be called from an ISR.
+     */
+    void bsp_low_power_stay_awake(uint32_t ms);
+
+    /**
+     * @brief Tickless idle of FreeRTOS (portSUPPRESS_TICKS_AND_SLEEP): stops the tick and enters STOP mode
+     *        until the RTC wakeup timer, a button, the IO expander or the AC detection wakes the MCU up.
+     * @note  Returns without sleeping if STOP mode is not allowed, the idle hook then waits for the next tick.
+     */
+    void bsp_low_power_suppress_ticks_and_sleep(uint32_t expected_idle_ticks);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,25 @@
+#include "bsp_run_time_stats.h"
+#include "stm32f0xx_hal.h"
+
+#define RUN_TIME_STATS_CLOCK_HZ 1000000u
+
+void bsp_run_time_stats_timer_init(void)
+{
+    __HAL_RCC_TIM2_CLK_ENABLE();
+    // Keep the counter consistent with the tick while the core is halted by the debugger
+    __HAL_RCC_DBGMCU_CLK_ENABLE();
+    __HAL_DBGMCU_FREEZE_TIM2();
+
+    // TIM2 is the only 32-bit timer, no interrupt is needed to extend the counter
+    TIM2->CR1 = 0;
+    TIM2->PSC = (SystemCoreClock / RUN_TIME_STATS_CLOCK_HZ) - 1u;
+    TIM2->ARR = 0xFFFFFFFFu;
+    TIM2->CNT = 0;
+    TIM2->EGR = TIM_EGR_UG; // Load the prescaler
+    TIM2->CR1 = TIM_CR1_CEN;
+}
+
+uint32_t bsp_run_time_stats_timer_get(void)
+{
+    return TIM2->CNT;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Starts the free running 1 MHz timer (TIM2) used as the run time stats clock of FreeRTOS.
+     * @note  Called by the scheduler through portCONFIGURE_TIMER_FOR_RUN_TIME_STATS. The timer is halted in STOP
+     *        mode, the time spent there is not accounted to any task.
+     */
+    void bsp_run_time_stats_timer_init(void);
+
+    /**
+     * @brief Gets the counter of the run time stats clock in microseconds (wraps around after ~71 minutes).
+     */
+    uint32_t bsp_run_time_stats_timer_get(void);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,117 @@
+#include "deferred_work.h"
+
+#include <atomic>
+#include <cstddef>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "irq_stats.h"
+#include "task_priorities.h"
+#include "external/teufel/libs/app_assert/app_assert.h"
+
+// The work posted by the interrupt handlers is small, but it posts messages to the tasks
+#define TASK_DEFERRED_WORK_STACK_SIZE 128
+// Power of two, the ring indexes wrap around with the 32-bit counters
+#define DEFERRED_WORK_QUEUE_SIZE 16u
+
+static_assert((DEFERRED_WORK_QUEUE_SIZE & (DEFERRED_WORK_QUEUE_SIZE - 1)) == 0, "The queue size must be a power of two");
+
+static StaticTask_t deferred_work_task_buffer;
+static StackType_t  deferred_work_task_stack[TASK_DEFERRED_WORK_STACK_SIZE];
+static TaskHandle_t s_task = nullptr;
+
+struct Work
+{
+    deferred_work_fn_t fn;
+    void              *arg;
+#if defined(IRQ_LATENCY_STATS)
+    uint32_t posted_us;
+#endif
+};
+
+// Written by the interrupt handlers at the head and read by the worker at the tail. The worker frees a slot by
+// moving the tail and never waits for the handlers.
+static Work                  s_ring[DEFERRED_WORK_QUEUE_SIZE];
+static std::atomic<uint32_t> s_head{0};
+static std::atomic<uint32_t> s_tail{0};
+
+static deferred_work_stats_t s_stats;
+
+[[noreturn]] static void worker(void *)
+{
+    uint32_t tail = s_tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (tail != s_head.load(std::memory_order_acquire))
+        {
+            const Work work = s_ring[tail % DEFERRED_WORK_QUEUE_SIZE];
+            s_tail.store(++tail, std::memory_order_release);
+
+#if defined(IRQ_LATENCY_STATS)
+            const uint32_t latency_us = bsp_run_time_stats_timer_get() - work.posted_us;
+            if (latency_us > s_stats.max_latency_us)
+                s_stats.max_latency_us = latency_us;
+#endif
+            work.fn(work.arg);
+        }
+    }
+}
+
+void deferred_work_init(void)
+{
+    s_task = xTaskCreateStatic(worker, "Deferred", TASK_DEFERRED_WORK_STACK_SIZE, nullptr, TASK_DEFERRED_WORK_PRIORITY,
+                               deferred_work_task_stack, &deferred_work_task_buffer);
+    APP_ASSERT(s_task);
+}
+
+int deferred_work_post_from_isr(deferred_work_fn_t fn, void *arg)
+{
+    // The Cortex-M0 has no exclusive load/store, the interrupts of higher priority are masked while a slot is
+    // reserved and filled (a few instructions)
+    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
+
+    const uint32_t head   = s_head.load(std::memory_order_relaxed);
+    const uint32_t queued = head - s_tail.load(std::memory_order_acquire);
+    if (queued >= DEFERRED_WORK_QUEUE_SIZE)
+    {
+        s_stats.dropped++;
+        taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+        return -1;
+    }
+
+    Work &work = s_ring[head % DEFERRED_WORK_QUEUE_SIZE];
+    work.fn    = fn;
+    work.arg   = arg;
+#if defined(IRQ_LATENCY_STATS)
+    work.posted_us = bsp_run_time_stats_timer_get();
+#endif
+    s_head.store(head + 1, std::memory_order_release);
+
+    s_stats.posted++;
+    if (queued + 1 > s_stats.max_queued)
+        s_stats.max_queued = queued + 1;
+
+    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
+
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveFromISR(s_task, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+    return 0;
+}
+
+void deferred_work_get_stats(deferred_work_stats_t *p_stats)
+{
+    taskENTER_CRITICAL();
+    *p_stats = s_stats;
+    taskEXIT_CRITICAL();
+}
+
+void deferred_work_reset_stats(void)
+{
+    taskENTER_CRITICAL();
+    s_stats = {};
+    taskEXIT_CRITICAL();
+}
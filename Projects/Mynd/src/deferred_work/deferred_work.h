@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+    typedef void (*deferred_work_fn_t)(void *arg);
+
+    typedef struct
+    {
+        uint32_t posted;
+        uint32_t dropped;
+        uint32_t max_queued;
+        // Time from posting to running a work item, only measured with IRQ_LATENCY_STATS
+        uint32_t max_latency_us;
+    } deferred_work_stats_t;
+
+    /**
+     * @brief Creates the worker task, which runs the work posted by the interrupt handlers.
+     * @note  Must be called before any interrupt posts work.
+     */
+    void deferred_work_init(void);
+
+    /**
+     * @brief Posts a function to be called by the worker task, out of the interrupt context.
+     * @note  Interrupt context only. The worker has the highest task priority, the work runs right after the interrupt
+     *        handlers return, in the order it was posted.
+     * @return 0 on success, -1 if the queue is full (the work is dropped)
+     */
+    int deferred_work_post_from_isr(deferred_work_fn_t fn, void *arg);
+
+    void deferred_work_get_stats(deferred_work_stats_t *p_stats);
+    void deferred_work_reset_stats(void);
+
+#if defined(__cplusplus)
+}
+#endif
@@ -0,0 +1,102 @@
+#include "irq_stats.h"
+
+#if defined(IRQ_LATENCY_STATS)
+
+#include <cstdio>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stm32f0xx.h"
+
+#include "deferred_work.h"
+#include "external/teufel/libs/tshell/tshell.h"
+
+// Device interrupts of the Cortex-M0
+constexpr int IRQ_COUNT = 32;
+
+struct IrqStats
+{
+    uint32_t count;
+    uint32_t max_us;
+};
+
+static IrqStats s_irqs[IRQ_COUNT];
+
+void irq_stats_record(int irqn, uint32_t start_us)
+{
+    // An interrupt does not preempt itself, each entry has a single writer at a time
+    if (irqn < 0 || irqn >= IRQ_COUNT)
+        return;
+
+    const uint32_t duration_us = bsp_run_time_stats_timer_get() - start_us;
+    IrqStats      &irq         = s_irqs[irqn];
+    irq.count++;
+    if (duration_us > irq.max_us)
+        irq.max_us = duration_us;
+}
+
+static const char *get_irq_name(int irqn)
+{
+    switch (irqn)
+    {
+        case EXTI2_3_IRQn:
+            return "EXTI2_3";
+        case DMA1_Channel1_IRQn:
+            return "DMA1_CH1";
+        case ADC1_COMP_IRQn:
+            return "ADC1";
+        case I2C1_IRQn:
+            return "I2C1";
+        case I2C2_IRQn:
+            return "I2C2";
+        case USART1_IRQn:
+            return "USART1";
+        case USART2_IRQn:
+            return "USART2";
+        default:
+            return "?";
+    }
+}
+
+static void print_irq_stats()
+{
+    printf("%-3s %-9s %4s %10s %7s\r\n", "irq", "name", "prio", "count", "max us");
+    for (int irqn = 0; irqn < IRQ_COUNT; irqn++)
+    {
+        IrqStats irq;
+        taskENTER_CRITICAL();
+        irq = s_irqs[irqn];
+        taskEXIT_CRITICAL();
+
+        if (irq.count == 0)
+            continue;
+        printf("%-3d %-9s %4lu %10lu %7lu\r\n", irqn, get_irq_name(irqn), NVIC_GetPriority((IRQn_Type) irqn),
+               irq.count, irq.max_us);
+    }
+
+    deferred_work_stats_t stats;
+    deferred_work_get_stats(&stats);
+    printf("deferred work: %lu posted, %lu dropped, max %lu queued, max latency %lu us\r\n", stats.posted,
+           stats.dropped, stats.max_queued, stats.max_latency_us);
+}
+
+static void reset_irq_stats()
+{
+    taskENTER_CRITICAL();
+    for (IrqStats &irq : s_irqs)
+        irq = {};
+    taskEXIT_CRITICAL();
+
+    deferred_work_reset_stats();
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_irq,
+                               SHELL_CMD_NO_ARGS(show, "longest interrupt handler times, deferred work latency",
+                                                 print_irq_stats),
+                               SHELL_CMD_NO_ARGS(reset, "reset the counters", reset_irq_stats),
+                               SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(irq, &sub_irq, "interrupt statistics", NULL, 2, 0);
+
+#endif // IRQ_LATENCY_STATS
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(IRQ_LATENCY_STATS)
+#include "bsp_run_time_stats.h"
+#endif
+#if defined(TRACE_RECORDER)
+#include "trace.h"
+#endif
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+#if defined(IRQ_LATENCY_STATS)
+
+    /**
+     * @brief Records the time spent in an interrupt handler, started at start_us.
+     * @note  The time includes the handlers of higher priority which preempted it. The longest time of a handler
+     *        is the worst-case latency it adds to the interrupts of the same and lower priorities and to the tasks.
+     */
+    void irq_stats_record(int irqn, uint32_t start_us);
+
+#define IRQ_LATENCY_ENTER() const uint32_t irq_stats_start_us = bsp_run_time_stats_timer_get()
+#define IRQ_LATENCY_EXIT(irqn) irq_stats_record((irqn), irq_stats_start_us)
+
+#else
+
+#define IRQ_LATENCY_ENTER()
+#define IRQ_LATENCY_EXIT(irqn)
+
+#endif // IRQ_LATENCY_STATS
+
+#if defined(TRACE_RECORDER)
+#define IRQ_TRACE_ENTER(irqn) trace_record(TRACE_ISR_ENTER, (uint8_t) (irqn), 0)
+#define IRQ_TRACE_EXIT(irqn) trace_record(TRACE_ISR_EXIT, (uint8_t) (irqn), 0)
+#else
+#define IRQ_TRACE_ENTER(irqn)
+#define IRQ_TRACE_EXIT(irqn)
+#endif // TRACE_RECORDER
+
+// Bracket the body of an interrupt handler
+#define IRQ_STATS_ENTER(irqn)                                                                                          \
+    IRQ_TRACE_ENTER(irqn);                                                                                             \
+    IRQ_LATENCY_ENTER()
+#define IRQ_STATS_EXIT(irqn)                                                                                           \
+    IRQ_LATENCY_EXIT(irqn);                                                                                            \
+    IRQ_TRACE_EXIT(irqn)
+
+#if defined(__cplusplus)
+}
+#endif
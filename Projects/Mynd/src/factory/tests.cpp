@@ -1,4 +1,5 @@
 #include "external/teufel/libs/property/property.h"
+#include "property_bus.h"
 
 #include "ux/system/system.h"
 #include "ux/input/input.h"
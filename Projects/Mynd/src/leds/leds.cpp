@@ -409,10 +409,19 @@ void user_activity()
     dimming_controller.reset();
 }
 
+// Battery level shown while charging, read by the conditions of the charger patterns
+static std::optional<BatteryIndicationLevel> s_charging_level;
+
 static void update_infinite_patterns()
 {
     using namespace IndicationEngine;
 
+    // Both at once, so that a pattern is not picked from the level before and the status after a change
+    const auto [charger_status, battery_level] = getProperties<Ux::System::ChargerStatus, Ux::System::BatteryLevel>();
+    s_charging_level = charger_status == Ux::System::ChargerStatus::Active
+                           ? std::optional{get_battery_indication_level(battery_level)}
+                           : std::nullopt;
+
     const std::tuple<LedPattern<RGB_LED> &, bool (*)(), void (*)()> infinite_patterns_status[] = {
         {s_moisture_detected, []() { return board_link_moisture_detection_is_detected(); },
          []()
@@ -421,12 +430,7 @@ static void update_infinite_patterns()
              s_status_led_engine.run_inf(s_moisture_detected);
          }},
         {s_status_charger_solid_battery_low,
-         []()
-         {
-             return isProperty(Ux::System::ChargerStatus::Active) &&
-                    get_battery_indication_level(getProperty<Ux::System::BatteryLevel>()) ==
-                        BatteryIndicationLevel::Low;
-         },
+         []() { return s_charging_level == BatteryIndicationLevel::Low; },
          []()
          {
              log_debug("run charger(red)");
@@ -435,12 +439,7 @@ static void update_infinite_patterns()
                                                                    s_status_charger_solid_battery_low_ramp_down);
          }},
         {s_status_charger_solid_battery_mid,
-         []()
-         {
-             return isProperty(Ux::System::ChargerStatus::Active) &&
-                    get_battery_indication_level(getProperty<Ux::System::BatteryLevel>()) ==
-                        BatteryIndicationLevel::Half;
-         },
+         []() { return s_charging_level == BatteryIndicationLevel::Half; },
          []()
          {
              log_debug("run charger(yellow)");
@@ -449,12 +448,7 @@ static void update_infinite_patterns()
                                                                    s_status_charger_solid_battery_mid_ramp_down);
          }},
         {s_status_charger_solid_battery_full,
-         []()
-         {
-             return isProperty(Ux::System::ChargerStatus::Active) &&
-                    get_battery_indication_level(getProperty<Ux::System::BatteryLevel>()) ==
-                        BatteryIndicationLevel::Full;
-         },
+         []() { return s_charging_level == BatteryIndicationLevel::Full; },
          []()
          {
              log_debug("run charger(green)");
@@ -523,11 +517,48 @@ static void update_infinite_patterns()
     }
 }
 
+// Inputs of update_infinite_patterns() other than the properties published by the property bus
+struct IndicationInputs
+{
+    std::optional<uint8_t> status_pattern;
+    std::optional<uint8_t> source_pattern;
+    bool                   moisture_detected;
+    bool                   power_on;
+
+    bool operator==(const IndicationInputs &) const = default;
+};
+
+static std::optional<IndicationInputs> s_last_inputs;
+
+static IndicationInputs read_indication_inputs()
+{
+    return {
+        .status_pattern    = s_status_led_engine.getPatternId(),
+        .source_pattern    = s_source_led_engine.getPatternId(),
+        .moisture_detected = board_link_moisture_detection_is_detected(),
+        .power_on          = isProperty(Teufel::Ux::System::PowerState::On),
+    };
+}
+
+void update_indications()
+{
+    s_last_inputs = read_indication_inputs();
+    update_infinite_patterns();
+}
+
 void tick()
 {
     dimming_controller.tick();
 
-    update_infinite_patterns();
+    // Changes of the properties are handled by update_indications() when they are published, the patterns only
+    // need to be checked again here when an engine has moved on or when the moisture or power state has changed
+    if (read_indication_inputs() != s_last_inputs)
+        update_indications();
+}
+
+bool is_engine_running(Led led)
+{
+    return (led == Led::Status) ? s_status_led_engine.is_running() : s_source_led_engine.is_running();
 }
 
 void run_engines()
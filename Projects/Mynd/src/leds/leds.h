@@ -72,6 +72,8 @@ inline auto getDesc(const SourcePattern &value)
 }
 
 void tick();
+// Checks the charging and source patterns again, after a change of the properties they show
+void update_indications();
 bool is_engine_running(Led led);
 void run_engines();
 void set_solid_color(Led led, Color color);
@@ -4,6 +4,8 @@
 #include "board_hw.h"
 #include "board_link.h"
 #include "bsp_debug_uart.h"
+#include "bsp_low_power.h"
+#include "deferred_work.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -58,6 +60,7 @@ extern "C"
 
         board_init();
         bsp_debug_uart_init();
+        bsp_low_power_init();
 
         snprintf(buffer, sizeof(buffer), "MYND (rev%d)", read_hw_revision());
 
@@ -150,6 +153,7 @@ int main()
 
 #endif // LOGGER_USE_EXTERNAL_THREAD
 
+    deferred_work_init();
     Teufel::Task::System::start();
     vTaskStartScheduler();
 
@@ -198,7 +202,8 @@ void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
     {
         case IO_EXP_INT_GPIO_PIN:
         {
-            board_link_io_expander_on_interrupt();
+            // Its handler posts a message to the audio task, out of the interrupt
+            deferred_work_post_from_isr(+[](void *) { board_link_io_expander_on_interrupt(); }, nullptr);
             break;
         }
     }
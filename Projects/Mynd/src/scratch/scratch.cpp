@@ -0,0 +1,72 @@
+#include "scratch.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "logger.h"
+
+#if !defined(BOOTLOADER)
+#include <cstdio>
+
+#include "external/teufel/libs/tshell/tshell.h"
+#endif
+
+namespace Teufel::Scratch
+{
+
+alignas(8) static uint8_t s_arena[ARENA_SIZE];
+static Owner              s_owner      = Owner::None;
+static size_t             s_high_water = 0;
+
+void *acquire(Owner owner, size_t size)
+{
+    if (owner == Owner::None || size > ARENA_SIZE)
+    {
+        log_error("Scratch: %u bytes requested by %u", static_cast<unsigned>(size), static_cast<unsigned>(owner));
+        return nullptr;
+    }
+
+    taskENTER_CRITICAL();
+    const Owner holder = s_owner;
+    if (holder == Owner::None)
+    {
+        s_owner = owner;
+        if (size > s_high_water)
+            s_high_water = size;
+    }
+    taskEXIT_CRITICAL();
+
+    if (holder != Owner::None)
+    {
+        // Two phases which were thought to be exclusive overlap, one of them has to be moved out of the arena
+        log_error("Scratch: held by %u, requested by %u", static_cast<unsigned>(holder), static_cast<unsigned>(owner));
+        return nullptr;
+    }
+
+    return s_arena;
+}
+
+void release(Owner owner)
+{
+    taskENTER_CRITICAL();
+    if (s_owner == owner)
+        s_owner = Owner::None;
+    taskEXIT_CRITICAL();
+}
+
+#if !defined(BOOTLOADER)
+static void print()
+{
+    printf("arena %u bytes, %u used at most, held by %u\r\n", static_cast<unsigned>(ARENA_SIZE),
+           static_cast<unsigned>(s_high_water), static_cast<unsigned>(s_owner));
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_scratch,
+                               SHELL_CMD_NO_ARGS(show, "size, largest use and holder of the scratch arena", print),
+                               SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(scratch, &sub_scratch, "scratch arena", NULL, 2, 0);
+#endif
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Teufel::Scratch
+{
+
+// Large enough for the biggest borrower, each one checks its needs against it with a static_assert
+constexpr size_t ARENA_SIZE = 320;
+
+// Phases borrowing the arena. They must never overlap: a phase which finds the arena held by another one gets no
+// memory. Add a phase here rather than a static buffer for memory which is only needed for a while.
+enum class Owner : uint8_t
+{
+    None,
+    TaskLoadSample, // System task, once a second
+    TraceDump,      // System task, 'trace dump' shell command
+    TaskStats,      // System task, 'tasks show' shell command
+};
+
+/**
+ * @brief Borrows the arena for a phase, until release() is called by the same phase.
+ * @note  Task context only. The memory is 8-byte aligned and its content is undefined.
+ * @return The arena, nullptr if it is held by another phase or if the size exceeds ARENA_SIZE
+ */
+void *acquire(Owner owner, size_t size);
+
+/**
+ * @brief Gives the arena back, does nothing if it is not held by the phase.
+ */
+void release(Owner owner);
+
+}
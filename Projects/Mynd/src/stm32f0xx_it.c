@@ -1,5 +1,6 @@
 #include "stm32f0xx_hal.h"
 #include "stm32f0xx.h"
+#include "irq_stats.h"
 
 extern ADC_HandleTypeDef  Adc1Handle;
 extern I2C_HandleTypeDef  I2C1_Handle;
@@ -21,43 +22,58 @@ void HardFault_Handler(void)
 
 void EXTI2_3_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(EXTI2_3_IRQn);
     // IO expander interrupt pin
     HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
+    IRQ_STATS_EXIT(EXTI2_3_IRQn);
 }
 
 void I2C1_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(I2C1_IRQn);
     HAL_I2C_EV_IRQHandler(&I2C1_Handle);
     HAL_I2C_ER_IRQHandler(&I2C1_Handle);
+    IRQ_STATS_EXIT(I2C1_IRQn);
 }
 
 void I2C2_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(I2C2_IRQn);
     HAL_I2C_EV_IRQHandler(&I2C2_Handle);
     HAL_I2C_ER_IRQHandler(&I2C2_Handle);
+    IRQ_STATS_EXIT(I2C2_IRQn);
 }
 
 void ADC1_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(ADC1_COMP_IRQn);
     HAL_ADC_IRQHandler(&Adc1Handle);
+    IRQ_STATS_EXIT(ADC1_COMP_IRQn);
 }
 
 void DMA1_Channel1_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(DMA1_Channel1_IRQn);
     HAL_DMA_IRQHandler(Adc1Handle.DMA_Handle);
+    IRQ_STATS_EXIT(DMA1_Channel1_IRQn);
 }
 
 void USART1_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(USART1_IRQn);
     HAL_UART_IRQHandler(&UART1_Handle);
+    IRQ_STATS_EXIT(USART1_IRQn);
 }
 
 void USART2_IRQHandler(void)
 {
+    IRQ_STATS_ENTER(USART2_IRQn);
     HAL_UART_IRQHandler(&UART2_Handle);
+    IRQ_STATS_EXIT(USART2_IRQn);
 }
 
 void bsp_bluetooth_uart_isr_rx_complete_callback(void);
+void bsp_bluetooth_uart_isr_error_callback(uint32_t error_code);
 void bsp_debug_uart_isr_rx_complete_callback(void);
 
 void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
@@ -85,6 +101,8 @@ void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
         __HAL_UART_CLEAR_IDLEFLAG(&UART1_Handle);
 
         HAL_UART_MspInit(&UART1_Handle);
+
+        bsp_bluetooth_uart_isr_error_callback(huart->ErrorCode);
     }
     else if (huart->Instance == USART2)
     {
@@ -19,6 +19,7 @@
 #include "actionslink.h"
 
 #include "external/teufel/libs/property/property.h"
+#include "property_bus.h"
 #include "stm32f0xx_hal.h"
 #include "persistent_storage/kvstorage.h"
 
@@ -27,14 +28,15 @@
 #include "task_audio.h"
 #include "task_bluetooth.h"
 #include "task_system.h"
+#include "timeline.h"
 #include "task_priorities.h"
 #include "tests.h"
 
 #include "external/teufel/libs/tshell/tshell.h"
 #include "external/teufel/libs/core_utils/mapper.h"
 #include "external/teufel/libs/core_utils/overload.h"
-#include "external/teufel/libs/core_utils/sync.h"
 #include "external/teufel/libs/core_utils/debouncer.h"
+#include "external/teufel/libs/core_utils/timer_wheel.h"
 #include "external/teufel/libs/app_assert/app_assert.h"
 
 #ifdef INCLUDE_PRODUCTION_TESTS
@@ -46,6 +48,22 @@
 #define TASK_AUDIO_STACK_SIZE 384
 #define QUEUE_SIZE            5
 
+// Expander interrupts and property changes only need to be handled once, power transitions must not wait behind
+// other work. The idle callback catches up on both, so their posts do not wait: the expander interrupt is posted
+// from the deferred worker, which must not block on a full queue.
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::Audio::AudioMessage, Teufel::Task::Audio::IoExpanderInterrupt> =
+        Teufel::GenericThread::PostPolicy::CoalesceNoWait;
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::Audio::AudioMessage, Teufel::Ux::System::PropertiesChanged> =
+        Teufel::GenericThread::PostPolicy::CoalesceNoWait;
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::Audio::AudioMessage, Teufel::Ux::System::SetPowerState> =
+        Teufel::GenericThread::PostPolicy::Urgent;
+
 namespace Teufel::Task::Audio
 {
 
@@ -86,6 +104,9 @@ static StackType_t  audio_task_stack[TASK_AUDIO_STACK_SIZE];
 static StaticQueue_t queue_static;
 static const size_t  queue_item_size = sizeof(GenericThread::QueueMessage<AudioMessage>);
 static uint8_t       queue_static_buffer[QUEUE_SIZE * queue_item_size];
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+static GenericThread::ThreadStatsBuffer<AudioMessage> thread_stats;
+#endif
 
 // board_link_power_supply_is_ac_ok() briefly loses connection in certain cases, so check if it is "not ok" for > than
 // 2000 ms before powering off
@@ -106,7 +127,6 @@ static Tus::Task                                           ot_id
 static Teufel::GenericThread::GenericThread<AudioMessage> *task_handler               = nullptr;
 static button_handler_t                                   *s_button_handler           = nullptr;
 static uint32_t                                            s_buttons_state            = 0;
-static uint32_t                                            s_connection_poll_ts       = 0;
 static bool                                                s_is_aux_jack_connected    = false;
 static bool                                                s_max_volume_play_feedback = true;
 
@@ -120,6 +140,8 @@ static struct
     bool ignore_hold_until_stop_pairing           = false;
     bool bypass_mode                              = false;
     bool plug_connected                           = false;
+    uint32_t buttons_state_seen                   = 0; // Buttons state the idle pass has seen last
+    uint32_t buttons_changed_ts                   = 0;
 } s_audio;
 
 static const board_link_usb_pd_controller_callbacks_t usb_callbacks = {
@@ -135,6 +157,44 @@ static const board_link_usb_pd_controller_callbacks_t usb_callbacks = {
     .pd_port_role_change_cb = +[](bool source) { log_err("PD port role changed: %s", source ? "source" : "sink"); },
 };
 
+// Periodic jobs of the task, run from its idle callback
+using TaskTimers = TimerWheel<8, 25>;
+static TaskTimers s_timers{get_systick};
+
+// TODO: Rework/de-duplicate conditions for polling USB PD controller and battery
+//       once we add support for polling them in off mode (with USB power supply connected)
+static void poll_connections()
+{
+    // Only do it until the speaker is completely powered on, otherwise we will send events
+    // before the Bluetooth task is ready to handle them
+    if (not isProperty(Tus::PowerState::On))
+        return;
+#ifdef BOARD_CONFIG_HAS_NO_I2C_MODE
+    if (s_audio.no_i2c_mode)
+        return;
+#endif
+
+    board_link_usb_pd_controller_poll_status(&usb_callbacks);
+
+    if (board_link_plug_detection_is_jack_connected() != s_is_aux_jack_connected)
+    {
+        s_is_aux_jack_connected = board_link_plug_detection_is_jack_connected();
+        log_info("Audio jack %s", s_is_aux_jack_connected ? "connected" : "disconnected");
+
+        // Mute and unmute amps to prevent pop noise.
+        // The delay amount of 200 ms is derived from testing
+        board_link_amps_mute(true);
+        vTaskDelay(pdMS_TO_TICKS(200));
+        board_link_amps_mute(false);
+
+        Teufel::Task::Bluetooth::postMessage(ot_id,
+                                             Teufel::Ux::Bluetooth::NotifyAuxConnectionChange{s_is_aux_jack_connected});
+    }
+}
+
+// Polls the USB PD controller/charger/plug detection
+static TaskTimers::Timer s_connection_poll_timer{"connections", poll_connections};
+
 static Leds::SourcePattern get_connected_source_pattern()
 {
     // clang-format off
@@ -278,6 +338,9 @@ TS_KEY_VALUE_CONST_MAP(EventHandlerMapper, uint32_t, button_event_handler_fn_t,
                 Task::System::postMessage(ot_id, Tus::SetPowerState { Tus::PowerState::Off, Tus::PowerState::On });
                 break;
             case Teufel::Ux::InputState::RawPress:
+                // Start of the button press to power on sound time, see the 'timeline' shell command
+                if (isProperty(Tus::PowerState::Off))
+                    Timeline::record(Timeline::Milestone::PowerButtonPressed);
                 if (isProperty(Tus::PowerState::On) && !s_audio.ignore_power_input_until_release /* allow factory reset pattern to play */) {
                     Leds::indicate_battery_level(getProperty<Tus::BatteryLevel>());
                 }
@@ -355,13 +418,13 @@ TS_KEY_VALUE_CONST_MAP(EventHandlerMapper, uint32_t, button_event_handler_fn_t,
                     // Do not change play state in this case
                     return;
                 }
-                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::PlayPause{});
+                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::PlayPause{get_systick()});
                 break;
             case Ux::InputState::DoublePress:
-                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::NextTrack{});
+                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::NextTrack{get_systick()});
                 break;
             case Ux::InputState::TriplePress:
-                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::PreviousTrack{});
+                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::PreviousTrack{get_systick()});
                 break;
             default:
                 break;
@@ -559,6 +622,34 @@ static const button_handler_config_t button_handler_config = {
     .enable_multitouch_support       = false,
 };
 
+static bool leds_enabled()
+{
+    return not(is_test_mode_activated() && is_led_test_activated())
+#ifdef BOARD_CONFIG_HAS_NO_I2C_MODE
+           && (not s_audio.no_i2c_mode)
+#endif
+        ;
+}
+
+// While the speaker is off the idle pass only runs this often, unless something below needs the regular pass.
+// The power button is sampled here (it only wakes the MCU from STOP mode), so this bounds how fast a press is seen.
+constexpr uint32_t c_idle_period_off_ms = 100;
+// After a button change the button handler needs the regular pass to time the press and the repeated presses
+constexpr uint32_t c_button_activity_ms = 1000;
+
+static bool needs_regular_idle()
+{
+    // The charger is polled while charging, STOP mode is not used then anyway
+    if (board_link_power_supply_is_ac_ok())
+        return true;
+
+    if (leds_enabled() && (Leds::is_engine_running(Leds::Led::Status) || Leds::is_engine_running(Leds::Led::Source)))
+        return true;
+
+    return s_buttons_state != 0 || board_get_ms_since(s_audio.buttons_changed_ts) < c_button_activity_ms ||
+           is_test_mode_activated();
+}
+
 static const GenericThread::Config<AudioMessage> threadConfig = {
     .Name      = "Audio",
     .StackSize = TASK_AUDIO_STACK_SIZE,
@@ -567,16 +658,16 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
     .Callback_Idle = []() {
         // Checking if (not isProperty(Tus::PowerState::Off) is unnecessary here. It prevented charging indication from playing while in pseudo off state and
         // the s_source_led_engine has logic in update_infinite_patterns() to ensure it does not run while in a power-off state.
-        if (not (is_test_mode_activated() && is_led_test_activated())
-#ifdef BOARD_CONFIG_HAS_NO_I2C_MODE
-                && (not s_audio.no_i2c_mode)
-#endif
-        )
+        if (leds_enabled())
         {
             Leds::tick();
             Leds::run_engines();
         }
 
+        // The INT line stays asserted until the inputs are read, e.g. if the queue was full when it was posted
+        if (board_link_io_expander_is_interrupt_pending())
+            read_io_expander_inputs();
+
         if (board_link_power_supply_button_is_pressed()) {
             s_buttons_state |= BUTTON_ID_POWER;
         } else {
@@ -584,41 +675,24 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
         }
 
         button_handler_process(s_button_handler, s_buttons_state);
-
-        // TODO: Rework/de-duplicate conditions for polling USB PD controller and battery
-        //       once we add support for polling them in off mode (with USB power supply connected)
-
-        // Poll the USB PD controller/charger/plug detection every 500 ms
-        // Only do it until the speaker is completely powered on, otherwise we will send events
-        // before the Bluetooth task is ready to handle them
-        if ((board_get_ms_since(s_connection_poll_ts) >= 500) &&
-#ifdef BOARD_CONFIG_HAS_NO_I2C_MODE
-            (!s_audio.no_i2c_mode) &&
-#endif
-            (isProperty(Tus::PowerState::On))) {
-            s_connection_poll_ts = get_systick();
-
-            board_link_usb_pd_controller_poll_status(&usb_callbacks);
-
-            if (board_link_plug_detection_is_jack_connected() != s_is_aux_jack_connected) {
-                s_is_aux_jack_connected = board_link_plug_detection_is_jack_connected();
-                log_info("Audio jack %s", s_is_aux_jack_connected ? "connected" : "disconnected");
-
-                // Mute and unmute amps to prevent pop noise.
-                // The delay amount of 200 ms is derived from testing
-                board_link_amps_mute(true);
-                vTaskDelay(pdMS_TO_TICKS(200));
-                board_link_amps_mute(false);
-
-                Teufel::Task::Bluetooth::postMessage(ot_id, Teufel::Ux::Bluetooth::NotifyAuxConnectionChange {s_is_aux_jack_connected});
-            }
+        if (s_buttons_state != s_audio.buttons_state_seen)
+        {
+            s_audio.buttons_state_seen = s_buttons_state;
+            s_audio.buttons_changed_ts = get_systick();
         }
 
+        s_timers.process();
+
 #ifdef BOARD_CONFIG_HAS_NO_I2C_MODE
         if (not s_audio.no_i2c_mode)
 #endif
             Battery::poll();
 
+        // Takes the changes of the battery properties set by this task, which are not posted to itself, and catches
+        // up on a change whose PropertiesChanged message could not be posted
+        if (leds_enabled() && PropertyBus::take(ot_id))
+            Leds::update_indications();
+
         // The unit is already off and running only because we're holding the power supply on
         if (isProperty(Tus::PowerState::Off) &&
             not pwr_ac_debouncer(board_link_power_supply_is_ac_ok()) &&
@@ -641,6 +715,13 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
         }
 
         factory_test_key_process();
+
+        // Nothing to poll quickly while the speaker is off, messages still wake the task up immediately
+        if (isProperty(Tus::PowerState::Off) && not needs_regular_idle())
+        {
+            GenericThread::scheduleIdle(
+                task_handler, std::min(c_idle_period_off_ms, s_timers.msUntilNextExpiry().value_or(UINT32_MAX)));
+        }
     },
     .Callback_Init = []() {
         bsp_shared_i2c_init();
@@ -697,7 +778,9 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
         Battery::init();
         load_persistent_parameters();
 
-        SyncPrimitive::notify(ot_id);
+        s_timers.start(s_connection_poll_timer, 500, 500);
+
+        Teufel::Task::System::setTaskReady(ot_id);
     },
     .QueueSize = QUEUE_SIZE,
     .Callback  = [](uint8_t /*modid*/, AudioMessage msg) {
@@ -715,8 +798,11 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                             Storage::save(getProperty<Tua::EcoMode>());
                             Storage::save(getProperty<Tua::SoundIconsActive>());
                             Storage::save(getProperty<Tua::VolumeLevel>());
-                            Storage::save(getProperty<Tus::OffTimer>());
-                            Storage::save(getProperty<Tus::OffTimerEnabled>());
+                            // The System task may be changing the pair
+                            const auto [off_timer, off_timer_enabled] =
+                                getProperties<Tus::OffTimer, Tus::OffTimerEnabled>();
+                            Storage::save(off_timer);
+                            Storage::save(off_timer_enabled);
                             Battery::save_persistent_parameters();
 
                             // Exit no I2C mode to prepare for shutdown
@@ -759,6 +845,7 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                             Battery::set_power_state(p.to);
 
                             disable_amps();
+                            Timeline::record(Timeline::Milestone::AmpsDisabled);
 
                             s_audio.bypass_mode = false;
                             break;
@@ -783,9 +870,8 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                             // before the I2S clocks start (provided by the BT module, synchronized by the system task)
                             board_link_amps_enable(true);
 
-                            // Likely not necessary considering all the stuff that needs to happen
-                            // before the amps are initialized when we get PowerState::On
                             vTaskDelay(pdMS_TO_TICKS(5));
+                            Timeline::record(Timeline::Milestone::AmpsEnabled);
 
                             if (s_audio.bypass_mode)
                             {
@@ -800,15 +886,16 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                                 if (bl.value > 0)
                                     Leds::indicate_battery_level(getProperty<Tus::BatteryLevel>());
                             }
-                            break;
-                        }
 
-                        case Tus::PowerState::On: {
-                            // The I2S clocks should be stable by now (provided by BT module, synchronized by the system task)
-                            // We should now be able to safely start configuring the amplifiers
+                            // The system task can power on the BT module now, it boots while the amps are configured.
+                            // The amps stay in Hi-Z until PowerState::On, which is handled after the configuration.
+                            Teufel::Task::System::postMessage(ot_id, Tus::PowerStateReached { ot_id, p.to });
+
                             board_link_amps_mode_t amp_mode = s_audio.bypass_mode ? AMP_MODE_BYPASS : AMP_MODE_NORMAL;
-                            board_link_amps_setup_woofer(amp_mode);
-                            board_link_amps_setup_tweeter(amp_mode);
+                            board_link_amps_configure_woofer(amp_mode);
+                            Timeline::record(Timeline::Milestone::WooferConfigured);
+                            board_link_amps_configure_tweeter(amp_mode);
+                            Timeline::record(Timeline::Milestone::TweeterConfigured);
 
                             if (isProperty(Tua::EcoMode{true}))
                             {
@@ -816,6 +903,14 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                                 board_link_amps_enable_eco_mode(true);
 #endif
                             }
+                            return;
+                        }
+
+                        case Tus::PowerState::On: {
+                            // The I2S clocks should be stable by now (provided by BT module, synchronized by the system task)
+                            // The amps can leave Hi-Z
+                            board_link_amps_play();
+                            Timeline::record(Timeline::Milestone::AmpsUnmuted);
 
 #ifdef BOARD_CONFIG_HAS_NO_I2C_MODE
                             if (s_audio.no_i2c_mode)
@@ -836,7 +931,7 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                         default:
                             break;
                     }
-                    SyncPrimitive::notify(ot_id);
+                    Teufel::Task::System::postMessage(ot_id, Tus::PowerStateReached { ot_id, p.to });
                 },
                 [](const IoExpanderInterrupt &) {
                     log_debug("IO expander interrupt");
@@ -946,6 +1041,11 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
                     Leds::indicate_factory_reset(p);
                     s_audio.ignore_power_input_until_release = true; // do not allow batt pattern to override
                 },
+                [](const Tus::PropertiesChanged &) {
+                    // The LED indications follow the charger, battery level and Bluetooth status properties
+                    if (leds_enabled() && PropertyBus::take(ot_id))
+                        Leds::update_indications();
+                },
                 [](const Tus::HardReset &) {
                     disable_amps();
                     vPortEnterCritical();
@@ -958,6 +1058,9 @@ static const GenericThread::Config<AudioMessage> threadConfig = {
     .StaticTask = &audio_task_buffer,
     .StaticQueue = &queue_static,
     .QueueBuffer = queue_static_buffer,
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+    .Stats = &thread_stats,
+#endif
 };
 
 int start()
@@ -970,6 +1073,11 @@ int start()
     return 0;
 }
 
+TaskHandle_t getTaskHandle()
+{
+    return task_handler ? GenericThread::getTaskHandle(task_handler) : nullptr;
+}
+
 int postMessage(Tus::Task source_task, AudioMessage msg)
 {
     return GenericThread::PostMsg(task_handler, static_cast<uint8_t>(source_task), msg);
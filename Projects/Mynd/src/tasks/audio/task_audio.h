@@ -3,6 +3,9 @@
 #include <variant>
 #include <optional>
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "ux/audio/audio.h"
 #include "ux/bluetooth/bluetooth.h"
 #include "ux/system/system.h"
@@ -27,12 +30,16 @@ using AudioMessage = std::variant<
     Teufel::Ux::Audio::TrebleLevel,
     Teufel::Ux::System::BatteryCriticalTemperature,
     Teufel::Ux::System::ChargeType,
-    Teufel::Ux::System::BatteryLowLevelState
+    Teufel::Ux::System::BatteryLowLevelState,
+    Teufel::Ux::System::PropertiesChanged
 >;
 // clang-format on
 
 int start();
 
+// Handle of the task, cached when it is created by start()
+TaskHandle_t getTaskHandle();
+
 int postMessage(Teufel::Ux::System::Task source_task, AudioMessage msg);
 
 }
@@ -7,13 +7,16 @@
 #endif
 
 #include <algorithm>
+#include <array>
 #include <utility>
 #include <optional>
 #include <functional>
+#include <iterator>
 
 #include "config.h"
 #include "board.h"
 #include "board_link.h"
+#include "board_hw.h"
 #include "bsp_bluetooth_uart.h"
 #include "actionslink.h"
 #include "task_priorities.h"
@@ -25,28 +28,43 @@
 #include "task_audio.h"
 #include "task_bluetooth.h"
 #include "task_system.h"
+#include "timeline.h"
 
 #include "external/teufel/libs/property/property.h"
+#include "property_bus.h"
 #include "external/teufel/libs/core_utils/mapper.h"
 #include "external/teufel/libs/core_utils/overload.h"
-#include "external/teufel/libs/core_utils/sync.h"
+#include "external/teufel/libs/core_utils/coalescing_mailbox.h"
+#include "external/teufel/libs/core_utils/timer_wheel.h"
 #include "external/teufel/libs/app_assert/app_assert.h"
 #include "gitversion//version.h"
 #include "persistent_storage/kvstorage.h"
 
-#ifdef INCLUDE_PRODUCTION_TESTS
 #include "external/teufel/libs/tshell/tshell.h"
-#endif // INCLUDE_PRODUCTION_TESTS
 
 #define TASK_BLUETOOTH_STACK_SIZE 448
 #define QUEUE_SIZE                8
+// Interactive commands (media keys, volume steps, sound icons) bypass queued telemetry
+#define PRIORITY_QUEUE_SIZE       4
+#define PRIORITY_BURST_LIMIT      3
 
-// Am Anfang der Datei:
-static uint32_t bt_disconnect_timer_ms = 0;
+// The BT module is switched off once no device has been connected for this long
 static bool bt_powered = true;
 #define BTOFF_TOUT_MS 120000  // 2 Minuten = 120000 ms
 
 
+// Power transitions must not wait behind other work. When the volume buttons are mashed faster than the module
+// follows, the steps are merged (see postMessage()), so one queued VolumeChange is enough and the other commands
+// are not crowded out.
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::Bluetooth::BluetoothMessage, Teufel::Ux::System::SetPowerState> =
+        Teufel::GenericThread::PostPolicy::Urgent;
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::Bluetooth::BluetoothMessage, Teufel::Ux::Bluetooth::VolumeChange> =
+        Teufel::GenericThread::PostPolicy::Coalesce;
+
 namespace Teufel::Task::Bluetooth
 {
 
@@ -70,6 +88,12 @@ static StackType_t  bluetooth_task_stack[TASK_BLUETOOTH_STACK_SIZE];
 static StaticQueue_t queue_static;
 static const size_t  queue_item_size = sizeof(GenericThread::QueueMessage<BluetoothMessage>);
 static uint8_t       queue_static_buffer[QUEUE_SIZE * queue_item_size];
+static StaticQueue_t priority_queue_static;
+static const size_t  priority_queue_item_size = sizeof(GenericThread::QueueMessage<BluetoothMessage>);
+static uint8_t       priority_queue_static_buffer[PRIORITY_QUEUE_SIZE * priority_queue_item_size];
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+static GenericThread::ThreadStatsBuffer<BluetoothMessage> thread_stats;
+#endif
 
 static struct
 {
@@ -92,8 +116,31 @@ static struct
     uint32_t                 power_on_sound_icon_ts   = 0u;
     actionslink_sound_icon_t curr_sound_icon          = ACTIONSLINK_SOUND_ICON_NONE;
     uint32_t                 curr_sound_icon_begin_ts = 0u;
+
+    Tus::PowerStateChangeReason power_off_reason = Tus::PowerStateChangeReason::UserRequest;
+
+    // Firmware version (major, minor, patch) of the module, read on every power on
+    std::array<uint32_t, 3> fw_version = {0, 0, 0};
+    // Set on power on, the negotiation runs once the power on sound icon has been requested
+    bool baudrate_negotiation_pending = false;
+    // Firmware version which failed the baudrate negotiation, it is not tried again until the firmware changes
+    std::optional<std::array<uint32_t, 3>> baudrate_unsupported_fw_version = std::nullopt;
 } s_bluetooth;
 
+// Outbound notifications only carry state, so only the newest value of each kind is sent.
+// The order of the types is the order in which they are flushed.
+using NotificationMailbox = CoalescingMailbox<Tub::NotifyUsbConnectionChange, Tub::NotifyAuxConnectionChange,
+                                              Tus::ChargerStatus, Tus::ChargeType, Tus::BatteryLevel, Tua::EcoMode,
+                                              Tus::Color>;
+static NotificationMailbox s_notifications;
+
+// Net volume steps of the presses not sent yet, positive is up. The queued VolumeChange sends all of them.
+static int8_t s_volume_steps = 0;
+// Time of the first of these presses, the latency of merged steps is measured from it
+static uint32_t s_volume_pressed_ts = 0;
+// More steps than this in one direction are not kept, the module cannot follow that fast anyway
+static constexpr int8_t c_max_pending_volume_steps = 16;
+
 // clang-format off
 TS_KEY_VALUE_CONST_MAP(SoundIconToLengthMapper, actionslink_sound_icon_t, uint16_t,
                        {ACTIONSLINK_SOUND_ICON_POSITIVE_FEEDBACK, 180},
@@ -106,6 +153,29 @@ TS_KEY_VALUE_CONST_MAP(SoundIconToLengthMapper, actionslink_sound_icon_t, uint16
 constexpr uint32_t c_update_bt_state_ts_duration = 200;
 // clang-format on
 
+constexpr uint32_t c_idle_period_off_ms = 500;
+
+// UX spec says that the power off sound icon is 1.832 seconds long
+// We need to mute the amps immediately after playing the power off sound icon to prevent
+// music from playing after the sound icon is played (can't send a command to pause in AUX
+// source) There is some delay between here and the audio task receiving the power off
+// command, so we need consider that the sound icon is played completely a bit before it's
+// actually done
+// TODO: Investigate this delay, it seems suspiciously and unnecessarily long (50-70 ms)
+constexpr uint32_t c_power_off_sound_icon_ms = 1780;
+
+// Latency of the media and volume commands: from the button event in the Audio task until the actionslink call
+// sending the command returned, i.e. the Actions module acknowledged it.
+static struct
+{
+    uint32_t count;
+    uint32_t last_ms;
+    uint32_t max_ms;
+    uint32_t total_ms;
+    uint32_t max_waiting_ms; // From the button event until the BT task started to handle the command
+    uint32_t handling_ts;
+} s_command_latency;
+
 static void actionslink_print_log(actionslink_log_level_t level, const char *dsc);
 static int  actionslink_read_buffer(uint8_t *p_data, uint8_t length, uint32_t timeout);
 static int  actionslink_write_buffer(const uint8_t *p_data, uint8_t length, uint32_t timeout);
@@ -169,22 +239,6 @@ static void hex_to_mac(uint64_t hexNumber, char *formattedMACAddr)
 }
 #endif // INCLUDE_PRODUCTION_TESTS
 
-static int get_bt_fw_version(actionslink_firmware_version_t *p_version)
-{
-    uint8_t                  build_str_buffer[32] = {0};
-    actionslink_buffer_dsc_t build_str            = {
-                   .p_buffer    = build_str_buffer,
-                   .buffer_size = sizeof(build_str_buffer),
-    };
-    p_version->p_build_string = &build_str;
-
-    if (actionslink_get_firmware_version(p_version) == 0)
-    {
-        return 0;
-    }
-    return -1;
-}
-
 static void continue_streaming_check()
 {
     if (s_bluetooth.was_streaming && not isPropertyOneOf(Tub::Status::BluetoothPairing, Tub::Status::SlavePairing))
@@ -200,6 +254,19 @@ static bool power_on_sound_icon_played()
     return s_bluetooth.power_on_sound_icon_ts == UINT32_MAX;
 }
 
+static void negotiate_uart_baudrate()
+{
+    s_bluetooth.baudrate_negotiation_pending = false;
+
+    // Speeds up the rest of the communication, the link stays at the default baudrate on failure
+    uint32_t baudrate = ACTIONSLINK_DEFAULT_BAUDRATE;
+    if (actionslink_negotiate_uart_baudrate(BLUETOOTH_UART_MAX_BAUDRATE, &baudrate) != 0)
+    {
+        log_warn("BT UART baudrate negotiation failed, using %lu", baudrate);
+        s_bluetooth.baudrate_unsupported_fw_version = s_bluetooth.fw_version;
+    }
+}
+
 static void handle_new_bt_state()
 {
     // Can't make decisions about BT state until audio source is known
@@ -318,6 +385,188 @@ static void update_infinite_sound_icons()
     }
 }
 
+static int send_notification(const Tus::BatteryLevel &p)
+{
+    log_dbg("Report battery level: %u", p.value);
+    return actionslink_send_battery_level(p.value);
+}
+
+static int send_notification(const Tus::ChargerStatus &p)
+{
+    return actionslink_send_charger_status(
+        Teufel::Core::mapValue(ChargerStatusMapper, p).value_or(ACTIONSLINK_CHARGER_STATUS_NOT_CONNECTED));
+}
+
+static int send_notification(const Tus::ChargeType &p)
+{
+    return actionslink_send_battery_friendly_charging_notification(p == Ux::System::ChargeType::BatteryFriendly);
+}
+
+static int send_notification(const Tus::Color &p)
+{
+    auto color = Teufel::Core::mapValue(ColorMapper, p).value_or(ACTIONSLINK_DEVICE_COLOR_BLACK);
+    return actionslink_send_color_id(color);
+}
+
+static int send_notification(const Tua::EcoMode &p)
+{
+    return actionslink_send_eco_mode_state(p.value);
+}
+
+static int send_notification(const Tub::NotifyAuxConnectionChange &p)
+{
+    log_debug("Notifying aux connection change: %d", p.connected);
+    if (actionslink_send_aux_connection_notification(p.connected) != 0)
+    {
+        log_error("Failed to notify aux connection");
+        return -1;
+    }
+    return 0;
+}
+
+static int send_notification(const Tub::NotifyUsbConnectionChange &p)
+{
+    log_debug("Notifying USB connection change: %d", p.connected);
+    if (actionslink_send_usb_connection_notification(p.connected) != 0)
+    {
+        log_error("Failed to notify USB con");
+        return -1;
+    }
+    return 0;
+}
+
+static void flush_notifications()
+{
+    // Pending values are kept until the Actions module is able to receive them
+    if (not isProperty(Tus::PowerState::On) || not actionslink_is_ready())
+        return;
+
+    s_notifications.flush([](const auto &p) { return send_notification(p) == 0; });
+}
+
+// Periodic and delayed jobs of the task, run from its idle callback
+using TaskTimers = TimerWheel<8, 100>;
+static TaskTimers        s_timers{get_systick};
+static TaskTimers::Timer s_bt_off_timer{"bt off", []()
+                                        {
+                                            log_info("No BT connection for %u ms, switching BT off", BTOFF_TOUT_MS);
+                                            board_link_bluetooth_set_power(false);
+                                            bt_powered = false;
+                                        }};
+
+static void report_power_state_reached(Tus::PowerState state)
+{
+    Teufel::Task::System::postMessage(ot_id, Tus::PowerStateReached{ot_id, state});
+}
+
+// The audio task requests the battery low sound icon when preparing the power off after booting with a low battery
+static uint32_t ms_until_battery_low_sound_icon_played()
+{
+    if (s_bluetooth.curr_sound_icon != ACTIONSLINK_SOUND_ICON_BATTERY_LOW)
+        return 0;
+
+    const uint32_t length_ms =
+        Teufel::Core::mapValue(SoundIconToLengthMapper, ACTIONSLINK_SOUND_ICON_BATTERY_LOW).value_or(0);
+    const uint32_t played_ms = board_get_ms_since(s_bluetooth.curr_sound_icon_begin_ts);
+    return played_ms < length_ms ? length_ms - played_ms : 0;
+}
+
+// PreOff is reported once the power off sound icon has played
+static TaskTimers::Timer s_power_off_sound_icon_played_timer{
+    "power off si played", []()
+    {
+        Timeline::record(Timeline::Milestone::PowerOffSoundIconPlayed);
+        report_power_state_reached(Tus::PowerState::PreOff);
+    }};
+static TaskTimers::Timer s_power_off_sound_icon_timer{
+    "power off si", []()
+    {
+        if (s_bluetooth.power_off_reason == Tus::PowerStateChangeReason::OffTimer ||
+            not getProperty<Ux::Audio::SoundIconsActive>().value)
+        {
+            report_power_state_reached(Tus::PowerState::PreOff);
+            return;
+        }
+
+        postMessage(ot_id, Tua::RequestSoundIcon{ACTIONSLINK_SOUND_ICON_POWER_OFF,
+                                                 ACTIONSLINK_SOUND_ICON_PLAYBACK_MODE_PLAY_IMMEDIATELY, false});
+        s_timers.start(s_power_off_sound_icon_played_timer, c_power_off_sound_icon_ms);
+    }};
+
+static bool is_interactive_command(const BluetoothMessage &msg)
+{
+    return std::holds_alternative<Tub::PlayPause>(msg) || std::holds_alternative<Tub::NextTrack>(msg) ||
+           std::holds_alternative<Tub::PreviousTrack>(msg) || std::holds_alternative<Tub::VolumeChange>(msg) ||
+           std::holds_alternative<Tua::RequestSoundIcon>(msg) || std::holds_alternative<Tua::StopPlayingSoundIcon>(msg);
+}
+
+// Called once the actionslink call sending a command returned
+static void record_command_latency(uint32_t pressed_ts)
+{
+    if (pressed_ts == 0)
+        return;
+
+    const uint32_t latency_ms = board_get_ms_since(pressed_ts);
+    const uint32_t waiting_ms = s_command_latency.handling_ts - pressed_ts;
+
+    s_command_latency.count++;
+    s_command_latency.total_ms += latency_ms;
+    s_command_latency.last_ms        = latency_ms;
+    s_command_latency.max_ms         = std::max(s_command_latency.max_ms, latency_ms);
+    s_command_latency.max_waiting_ms = std::max(s_command_latency.max_waiting_ms, waiting_ms);
+}
+
+static void print_command_latency()
+{
+    printf("commands %lu, button to sent: last %lu ms, avg %lu ms, max %lu ms (waiting for the bt task max %lu ms)\r\n",
+           s_command_latency.count, s_command_latency.last_ms,
+           s_command_latency.count ? s_command_latency.total_ms / s_command_latency.count : 0, s_command_latency.max_ms,
+           s_command_latency.max_waiting_ms);
+}
+
+static void print_link_stats()
+{
+    // Indexed by the payload tag of ActionsLink_FromMcu
+    static constexpr const char *payload_names[] = {"-", "request", "response", "event"};
+    static constexpr const char *nack_reasons[]  = {"unknown", "bad packet", "bad crc", "invalid length", "busy"};
+    static constexpr uint16_t    rtt_limits_ms[] = ACTIONSLINK_LINK_STATS_RTT_BUCKET_LIMITS_MS;
+    static_assert(std::size(nack_reasons) == ACTIONSLINK_NACK_REASON_COUNT);
+    static_assert(std::size(rtt_limits_ms) == ACTIONSLINK_LINK_STATS_RTT_BUCKETS - 1);
+
+    actionslink_link_stats_t stats;
+    actionslink_get_link_stats(&stats);
+    bsp_bluetooth_uart_stats_t uart_stats;
+    bsp_bluetooth_uart_get_stats(&uart_stats);
+
+    printf("frames: tx %lu, rx %lu\r\n", stats.tx_frames, stats.rx_frames);
+    printf("acks: sent %lu, received %lu\r\n", stats.acks_sent, stats.acks_received);
+    printf("nacks (sent/received):\r\n");
+    for (size_t i = 0; i < ACTIONSLINK_NACK_REASON_COUNT; i++)
+        printf("  %-14s %lu/%lu\r\n", nack_reasons[i], stats.nacks_sent[i], stats.nacks_received[i]);
+    printf("retransmissions %lu, timeouts %lu\r\n", stats.retransmissions, stats.transaction_timeouts);
+    printf("rx: timeouts %lu, dropped bytes %lu\r\n", stats.rx_timeouts, stats.rx_dropped_bytes);
+    printf("baudrate fallbacks %lu\r\n", stats.baudrate_fallbacks);
+    printf("uart: overruns %lu, framing %lu, noise %lu, dropped %lu\r\n", uart_stats.overruns,
+           uart_stats.framing_errors, uart_stats.noise_errors, uart_stats.dropped_bytes);
+
+    printf("rtt:\r\n");
+    for (size_t i = 0; i < ACTIONSLINK_LINK_STATS_RTT_BUCKETS; i++)
+    {
+        if (i < std::size(rtt_limits_ms))
+            printf("  < %3u ms %lu\r\n", rtt_limits_ms[i], stats.rtt_histogram[i]);
+        else
+            printf("  >=%3u ms %lu\r\n", rtt_limits_ms[i - 1], stats.rtt_histogram[i]);
+    }
+
+    printf("max rtt:\r\n");
+    for (const auto &entry : stats.max_rtt)
+    {
+        if (entry.payload_type == 0 || entry.payload_type >= std::size(payload_names))
+            break;
+        printf("  %-8s %3u: %u ms\r\n", payload_names[entry.payload_type], entry.tag, entry.max_rtt_ms);
+    }
+}
+
 static const actionslink_request_handlers_t actionslink_request_handlers = {
     .on_request_get_mcu_firmware_version =
         +[](uint8_t seq_id)
@@ -359,8 +608,8 @@ static const actionslink_request_handlers_t actionslink_request_handlers = {
         +[](uint8_t seq_id)
         {
             log_debug("Request get off timer(seq_id: %d)", seq_id);
-            actionslink_send_get_off_timer_response(seq_id, getProperty<Ux::System::OffTimerEnabled>().value,
-                                                    getProperty<Ux::System::OffTimer>().value);
+            const auto [enabled, minutes] = getProperties<Ux::System::OffTimerEnabled, Ux::System::OffTimer>();
+            actionslink_send_get_off_timer_response(seq_id, enabled.value, minutes.value);
         },
     .on_request_set_brightness =
         +[](uint8_t seq_id, uint32_t value)
@@ -467,6 +716,8 @@ static const actionslink_event_handlers_t actionslink_event_handlers = {
         +[]()
         {
             postMessage(ot_id, ActionsReady{});
+            // The module might have been restarted, so the state it was told about before is gone
+            s_notifications.invalidate();
             postMessage(ot_id, Tus::BatteryLevel{getProperty<Ux::System::BatteryLevel>().value});
             postMessage(ot_id, Tub::NotifyAuxConnectionChange{board_link_plug_detection_is_jack_connected()});
             postMessage(ot_id, Tub::NotifyUsbConnectionChange{s_bluetooth.usb_plug_connected});
@@ -645,6 +896,7 @@ static const actionslink_config_t actionslink_configuration = {
     .msp_deinit_fn   = nullptr,
     .task_yield_fn   = +[]() { vTaskDelay(pdMS_TO_TICKS(2)); },
     .log_fn          = actionslink_print_log,
+    .set_baudrate_fn = bsp_bluetooth_uart_set_baudrate,
     .p_rx_buffer     = actionslink_rx_buffer,
     .p_tx_buffer     = actionslink_tx_buffer,
     .rx_buffer_size  = ACTIONSLINK_RX_BUFFER_SIZE,
@@ -685,24 +937,33 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
             }
         }
 
+        s_timers.process();
+
         if (isProperty(Tus::PowerState::On))
         {
+            flush_notifications();
             actionslink_tick();
 
             Teufel::Ux::Bluetooth::Status bt_status;
             Teufel::Ux::Bluetooth::getProperty(&bt_status);
             bool bt_connected = (bt_status == Teufel::Ux::Bluetooth::Status::BluetoothConnected);
 
-            if (bt_powered && !bt_connected) {
-                bt_disconnect_timer_ms += 1000;
-                if (bt_disconnect_timer_ms >= BTOFF_TOUT_MS) {
-                    board_link_bluetooth_set_power(false);
-                    bt_powered = false;
-                }
-            } else if (bt_connected) {
-                bt_disconnect_timer_ms = 0;
-            }
+            if (bt_connected)
+                s_timers.stop(s_bt_off_timer);
+            else if (bt_powered && not s_timers.isActive(s_bt_off_timer))
+                s_timers.start(s_bt_off_timer, BTOFF_TOUT_MS);
+        }
+        else
+        {
+            s_timers.stop(s_bt_off_timer);
 
+            if (not s_bluetooth.update_bt_state && (s_bluetooth.power_on_sound_icon_ts == 0u ||
+                                                    s_bluetooth.power_on_sound_icon_ts == UINT32_MAX))
+            {
+                // Nothing to poll while the speaker is off, messages still wake the task up immediately
+                GenericThread::scheduleIdle(
+                    task_handler, std::min(c_idle_period_off_ms, s_timers.msUntilNextExpiry().value_or(UINT32_MAX)));
+            }
         }
     },
     .Callback_Init =
@@ -715,12 +976,18 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
 
         board_link_usb_switch_init();
         board_link_usb_switch_to_bluetooth();
-        SyncPrimitive::notify(ot_id);
+
+        Teufel::Task::System::setTaskReady(ot_id);
     },
-    .QueueSize = QUEUE_SIZE,
+    .QueueSize          = QUEUE_SIZE,
+    .PriorityQueueSize  = PRIORITY_QUEUE_SIZE,
+    .PriorityBurstLimit = PRIORITY_BURST_LIMIT,
+    .IsPriority         = is_interactive_command,
     .Callback =
         [](uint8_t /*modid*/, BluetoothMessage msg)
     {
+        s_command_latency.handling_ts = get_systick();
+
         std::visit(
             Teufel::Core::overload{
                 [](const Teufel::Ux::System::SetPowerState &p)
@@ -730,20 +997,20 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                     {
                         case Tus::PowerState::PreOff:
                         {
-                            // Wait until the sound icon is played completely
-                            // UX spec says that the power off sound icon is 1.832 seconds long
-                            // We need to mute the amps immediately after playing the power off sound icon to prevent
-                            // music from playing after the sound icon is played (can't send a command to pause in AUX
-                            // source) There is some delay between here and the audio task receiving the power off
-                            // command, so we need consider that the sound icon is played completely a bit before it's
-                            // actually done
-                            // TODO: Investigate this delay, it seems suspiciously and unnecessarily long (50-70 ms)
-                            vTaskDelay(pdMS_TO_TICKS(1780));
-                            break;
+                            // The power off sound icon follows the battery low sound icon, if it is being played.
+                            // PreOff is reported by the timers once the sound icons have played.
+                            s_bluetooth.power_off_reason =
+                                p.reason.value_or(Tus::PowerStateChangeReason::UserRequest);
+                            s_timers.start(s_power_off_sound_icon_timer, ms_until_battery_low_sound_icon_played());
+                            return;
                         }
 
                         case Tus::PowerState::Off:
                         {
+                            // The System task went on without waiting for the sound icons
+                            s_timers.stop(s_power_off_sound_icon_timer);
+                            s_timers.stop(s_power_off_sound_icon_played_timer);
+
                             s_bluetooth.has_received_power_off_confirmation = false;
                             s_bluetooth.power_on_sound_icon_ts =
                                 0u; // IMPORTANT! needs to be reset when charger is connected
@@ -766,8 +1033,13 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                             actionslink_deinit();
                             board_link_bluetooth_reset(true);
                             board_link_bluetooth_set_power(false);
+                            Timeline::record(Timeline::Milestone::BluetoothOff);
 
-                            s_bluetooth.power_on_sound_icon_ts = 0u;
+                            // The Actions module forgets everything it was told, resend the state on the next power on
+                            s_notifications.reset();
+
+                            s_bluetooth.power_on_sound_icon_ts       = 0u;
+                            s_bluetooth.baudrate_negotiation_pending = false;
 
                             break;
                         }
@@ -776,6 +1048,7 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         {
                             board_link_bluetooth_reset(false);
                             board_link_bluetooth_set_power(true);
+                            bt_powered = true;
 
                             bsp_bluetooth_uart_clear_buffer();
                             actionslink_init(&actionslink_configuration, &actionslink_event_handlers,
@@ -787,12 +1060,25 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                                 actionslink_tick();
                             }
 
+                            // The build string is decoded straight into this buffer, it must outlive the log below
+                            uint8_t                        build_str_buffer[32] = {0};
+                            actionslink_buffer_dsc_t       build_str            = {
+                                           .p_buffer    = build_str_buffer,
+                                           .buffer_size = sizeof(build_str_buffer),
+                            };
                             actionslink_firmware_version_t version = {0};
-                            if (get_bt_fw_version(&version) == 0)
+                            version.p_build_string                 = &build_str;
+                            if (actionslink_get_firmware_version(&version) == 0)
                             {
                                 log_warn("Actions FW version: %d.%d.%d%s", version.major, version.minor, version.patch,
-                                         version.p_build_string->p_buffer);
+                                         build_str_buffer);
                             }
+                            s_bluetooth.fw_version = {version.major, version.minor, version.patch};
+
+                            // Not tried again with a firmware that already failed it, and not before the power on
+                            // sound icon, which must not wait for it
+                            s_bluetooth.baudrate_negotiation_pending =
+                                s_bluetooth.baudrate_unsupported_fw_version != s_bluetooth.fw_version;
 
                             uint8_t pd_version = 0x00;
                             if (board_link_usb_pd_controller_fw_version(&pd_version) == 0)
@@ -812,36 +1098,41 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                                 vTaskDelay(pdMS_TO_TICKS(10));
                                 actionslink_tick();
                             }
+                            Timeline::record(Timeline::Milestone::BluetoothReady);
                             break;
                         }
                         default:
                             break;
                     }
-                    SyncPrimitive::notify(ot_id);
+                    report_power_state_reached(p.to);
                 },
-                [](const Teufel::Ux::System::BatteryLevel &p)
+                // Never queued: postMessage() puts the notifications into the mailbox and queues FlushNotifications
+                // instead. If that post fails, the idle callback flushes the mailbox.
+                []<typename T>(const T &) requires NotificationMailbox::accepts<T> {},
+                [](const FlushNotifications &) { flush_notifications(); },
+                [](const LinkStats &p)
                 {
-                    log_dbg("Report battery level: %u", p.value);
-                    actionslink_send_battery_level(p.value);
-                },
-                [](const Teufel::Ux::System::ChargerStatus &p)
-                {
-                    if (!isProperty(Teufel::Ux::System::PowerState::Off))
-                        actionslink_send_charger_status(Teufel::Core::mapValue(ChargerStatusMapper, p)
-                                                            .value_or(ACTIONSLINK_CHARGER_STATUS_NOT_CONNECTED));
-                },
-                [](const Teufel::Ux::System::ChargeType &p)
-                {
-                    if (not isProperty(Tus::PowerState::Off))
-                        actionslink_send_battery_friendly_charging_notification(
-                            p == Ux::System::ChargeType::BatteryFriendly);
+                    switch (p.action)
+                    {
+                        case LinkStats::Action::Show:
+                            print_link_stats();
+                            break;
+                        case LinkStats::Action::Reset:
+                            actionslink_reset_link_stats();
+                            bsp_bluetooth_uart_reset_stats();
+                            break;
+                    }
                 },
-                [](const Teufel::Ux::System::Color &p)
+                [](const CommandLatency &p)
                 {
-                    auto color = Teufel::Core::mapValue(ColorMapper, p).value_or(ACTIONSLINK_DEVICE_COLOR_BLACK);
-                    if (actionslink_send_color_id(color) != 0)
+                    switch (p.action)
                     {
-                        // log_error("Failed to send color");
+                        case CommandLatency::Action::Show:
+                            print_command_latency();
+                            break;
+                        case CommandLatency::Action::Reset:
+                            s_command_latency = {};
+                            break;
                     }
                 },
                 [](const ActionsReady &)
@@ -869,18 +1160,21 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         log_error("Failed to enable bluetooth reconnection");
                     }
                 },
-                [](const Teufel::Ux::Bluetooth::VolumeChange &p)
+                [](const Teufel::Ux::Bluetooth::VolumeChange &)
                 {
-                    log_info("Volume %s", getDesc(p));
-                    switch (p)
-                    {
-                        case Tub::VolumeChange::Up:
-                            actionslink_increase_volume();
-                            break;
-                        case Tub::VolumeChange::Down:
-                            actionslink_decrease_volume();
-                            break;
-                    }
+                    taskENTER_CRITICAL();
+                    const int8_t   steps      = s_volume_steps;
+                    const uint32_t pressed_ts = s_volume_pressed_ts;
+                    s_volume_steps            = 0;
+                    taskEXIT_CRITICAL();
+
+                    log_info("Volume %d steps", steps);
+                    for (int8_t i = 0; i < steps; i++)
+                        actionslink_increase_volume();
+                    for (int8_t i = 0; i > steps; i--)
+                        actionslink_decrease_volume();
+                    if (steps != 0)
+                        record_command_latency(pressed_ts);
                 },
                 [](const Teufel::Ux::Bluetooth::StartPairing &p)
                 {
@@ -918,23 +1212,6 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         }
                     }
                 },
-                [](const Teufel::Ux::Bluetooth::NotifyAuxConnectionChange &p)
-                {
-                    log_debug("Notifying aux connection change: %d", p.connected);
-                    if (actionslink_send_aux_connection_notification(p.connected) != 0)
-                    {
-                        log_error("Failed to notify aux connection");
-                    }
-                },
-                [](const Teufel::Ux::Bluetooth::NotifyUsbConnectionChange &p)
-                {
-                    log_debug("Notifying USB connection change: %d", p.connected);
-                    s_bluetooth.usb_plug_connected = p.connected;
-                    if (actionslink_send_usb_connection_notification(p.connected) != 0)
-                    {
-                        log_error("Failed to notify USB con");
-                    }
-                },
                 [](const Teufel::Ux::Bluetooth::EnterDfuMode &p)
                 {
                     log_highlight("Entering DFU mode");
@@ -994,7 +1271,7 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                                 Tua::RequestSoundIcon{ACTIONSLINK_SOUND_ICON_POSITIVE_FEEDBACK,
                                                       ACTIONSLINK_SOUND_ICON_PLAYBACK_MODE_PLAY_IMMEDIATELY, false});
                 },
-                [](const Teufel::Ux::Bluetooth::PlayPause &)
+                [](const Teufel::Ux::Bluetooth::PlayPause &p)
                 {
                     log_info("Play/Pause");
                     if (!s_bluetooth.audio_source.has_value())
@@ -1014,8 +1291,9 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         default:
                             break;
                     }
+                    record_command_latency(p.pressed_ts);
                 },
-                [](const Teufel::Ux::Bluetooth::NextTrack &)
+                [](const Teufel::Ux::Bluetooth::NextTrack &p)
                 {
                     log_info("Next track");
                     if (!s_bluetooth.audio_source.has_value())
@@ -1035,8 +1313,9 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         default:
                             break;
                     }
+                    record_command_latency(p.pressed_ts);
                 },
-                [](const Teufel::Ux::Bluetooth::PreviousTrack &)
+                [](const Teufel::Ux::Bluetooth::PreviousTrack &p)
                 {
                     log_info("Previous track");
                     if (!s_bluetooth.audio_source.has_value())
@@ -1056,6 +1335,7 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         default:
                             break;
                     }
+                    record_command_latency(p.pressed_ts);
                 },
                 [](const Tua::RequestSoundIcon &p)
                 {
@@ -1090,6 +1370,11 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                     {
                         log_debug("Sound icon play (si: %d) requested. Sound icons inactive.", p.sound_icon);
                     }
+
+                    if (p.sound_icon == ACTIONSLINK_SOUND_ICON_POWER_ON && s_bluetooth.baudrate_negotiation_pending)
+                    {
+                        negotiate_uart_baudrate();
+                    }
                 },
                 [](const Tua::StopPlayingSoundIcon &p)
                 {
@@ -1110,18 +1395,12 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
                         log_debug("Sound icon stop requested. Sound icons inactive.");
                     }
                 },
-                [](const Tua::EcoMode &p)
-                {
-                    if (actionslink_send_eco_mode_state(p.value) != 0)
-                    {
-                        // log_error("Failed to notify eco mode state");
-                    }
-                },
 #ifdef INCLUDE_PRODUCTION_TESTS
                 [](Teufel::Ux::Bluetooth::FWVersionProdTest)
                 {
+                    // No build string buffer: the decoder skips it
                     actionslink_firmware_version_t version = {0};
-                    if (get_bt_fw_version(&version) == 0)
+                    if (actionslink_get_firmware_version(&version) == 0)
                     {
                         printf("BT:%d.%d.%d\r\n", version.major, version.minor, version.patch);
                     }
@@ -1214,10 +1493,15 @@ static const GenericThread::Config<BluetoothMessage> threadConfig = {
             },
             msg);
     },
-    .StackBuffer = bluetooth_task_stack,
-    .StaticTask  = &bluetooth_task_buffer,
-    .StaticQueue = &queue_static,
-    .QueueBuffer = queue_static_buffer,
+    .StackBuffer         = bluetooth_task_stack,
+    .StaticTask          = &bluetooth_task_buffer,
+    .StaticQueue         = &queue_static,
+    .QueueBuffer         = queue_static_buffer,
+    .StaticPriorityQueue = &priority_queue_static,
+    .PriorityQueueBuffer = priority_queue_static_buffer,
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+    .Stats               = &thread_stats,
+#endif
 };
 
 int start()
@@ -1230,9 +1514,49 @@ int start()
     return 0;
 }
 
+TaskHandle_t getTaskHandle()
+{
+    return task_handler ? GenericThread::getTaskHandle(task_handler) : nullptr;
+}
+
 int postMessage(Teufel::Ux::System::Task source_task, BluetoothMessage msg)
 {
-    return GenericThread::PostMsg(task_handler, static_cast<uint8_t>(source_task), msg);
+    return std::visit(
+        [source_task]<typename T>(const T &p) -> int
+        {
+            if constexpr (std::is_same_v<T, Tub::VolumeChange>)
+            {
+                // Merged into the net steps, a step is only lost beyond the limit. Called from the button handler
+                // of the Audio task, so this is the time of the first press not sent yet.
+                taskENTER_CRITICAL();
+                if (s_volume_steps == 0)
+                    s_volume_pressed_ts = get_systick();
+                if (p == Tub::VolumeChange::Up)
+                    s_volume_steps = std::min<int8_t>(s_volume_steps + 1, c_max_pending_volume_steps);
+                else
+                    s_volume_steps = std::max<int8_t>(s_volume_steps - 1, -c_max_pending_volume_steps);
+                taskEXIT_CRITICAL();
+
+                // Only queued if none is queued yet, the one queued sends the merged steps
+                return GenericThread::PostMsg(task_handler, static_cast<uint8_t>(source_task), BluetoothMessage{p});
+            }
+            else if constexpr (NotificationMailbox::accepts<T>)
+            {
+                if constexpr (std::is_same_v<T, Tub::NotifyUsbConnectionChange>)
+                    s_bluetooth.usb_plug_connected = p.connected;
+
+                // Only the first notification of a burst needs a queue slot to wake up the task
+                if (not s_notifications.post(p))
+                    return 0;
+                return GenericThread::PostMsg(task_handler, static_cast<uint8_t>(source_task),
+                                              BluetoothMessage{FlushNotifications{}});
+            }
+            else
+            {
+                return GenericThread::PostMsg(task_handler, static_cast<uint8_t>(source_task), BluetoothMessage{p});
+            }
+        },
+        msg);
 }
 
 static int actionslink_read_buffer(uint8_t *p_data, uint8_t length, uint32_t timeout)
@@ -1275,6 +1599,30 @@ static void actionslink_print_log(actionslink_log_level_t level, const char *dsc
     }
 }
 
+#ifndef BOOTLOADER
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_link,
+    SHELL_CMD_NO_ARGS(show, "show link stats",
+                      []() { postMessage(Tus::Task::System, LinkStats{LinkStats::Action::Show}); }),
+    SHELL_CMD_NO_ARGS(reset, "reset link stats",
+                      []() { postMessage(Tus::Task::System, LinkStats{LinkStats::Action::Reset}); }),
+    SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(link, &sub_link, "actionslink stats", NULL, 2, 0);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_latency,
+    SHELL_CMD_NO_ARGS(show, "show command latency, button event to sent to the actions module",
+                      []() { postMessage(Tus::Task::System, CommandLatency{CommandLatency::Action::Show}); }),
+    SHELL_CMD_NO_ARGS(reset, "reset command latency",
+                      []() { postMessage(Tus::Task::System, CommandLatency{CommandLatency::Action::Reset}); }),
+    SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(latency, &sub_latency, "bt command latency", NULL, 2, 0);
+#endif
+
 }
 
 // Properties public API
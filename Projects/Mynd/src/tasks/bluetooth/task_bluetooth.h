@@ -3,6 +3,9 @@
 #include <variant>
 #include <optional>
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "ux/audio/audio.h"
 #include "ux/bluetooth/bluetooth.h"
 #include "ux/system/system.h"
@@ -12,6 +15,15 @@ namespace Teufel::Task::Bluetooth
 
 // clang-format off
 struct ActionsReady{};
+struct FlushNotifications{};
+struct LinkStats
+{
+    enum class Action : uint8_t { Show, Reset } action;
+};
+struct CommandLatency
+{
+    enum class Action : uint8_t { Show, Reset } action;
+};
 
 using BluetoothMessage = std::variant<
     Teufel::Ux::System::SetPowerState,
@@ -20,6 +32,9 @@ using BluetoothMessage = std::variant<
     Teufel::Ux::System::ChargeType,
     Teufel::Ux::System::Color,
     ActionsReady,
+    FlushNotifications,
+    LinkStats,
+    CommandLatency,
     Teufel::Ux::Bluetooth::BtWakeUp,
     Teufel::Ux::Bluetooth::StartPairing,
 #ifdef INCLUDE_TWS_MODE
@@ -54,6 +69,9 @@ using BluetoothMessage = std::variant<
 
 int start();
 
+// Handle of the task, cached when it is created by start()
+TaskHandle_t getTaskHandle();
+
 int postMessage(Teufel::Ux::System::Task source_task, BluetoothMessage msg);
 
 }
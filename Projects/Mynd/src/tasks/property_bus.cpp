@@ -0,0 +1,40 @@
+#include "property_bus.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "task_audio.h"
+
+namespace Teufel::Task::PropertyBus
+{
+
+namespace Tus = Teufel::Ux::System;
+
+// Tasks with a change they have not taken yet
+static uint32_t s_changed = 0;
+
+void notify(uint32_t tasks)
+{
+    taskENTER_CRITICAL();
+    s_changed |= tasks;
+    taskEXIT_CRITICAL();
+
+    // The Audio task sets the battery properties itself, its idle callback takes the change without a message.
+    // The source of the message is not known here, the handlers do not use it.
+    if ((tasks & task_bit(Tus::Task::Audio)) && xTaskGetCurrentTaskHandle() != Teufel::Task::Audio::getTaskHandle())
+        Teufel::Task::Audio::postMessage(Tus::Task::System, Tus::PropertiesChanged{});
+}
+
+bool take(Tus::Task task)
+{
+    const uint32_t bit = task_bit(task);
+
+    taskENTER_CRITICAL();
+    const bool changed = (s_changed & bit) != 0;
+    s_changed &= ~bit;
+    taskEXIT_CRITICAL();
+
+    return changed;
+}
+
+}
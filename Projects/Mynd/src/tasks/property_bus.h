@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+
+#include "ux/audio/audio.h"
+#include "ux/bluetooth/bluetooth.h"
+#include "ux/system/system.h"
+
+namespace Teufel::Task::PropertyBus
+{
+
+constexpr uint32_t task_bit(Teufel::Ux::System::Task task)
+{
+    return 1UL << static_cast<unsigned>(task);
+}
+
+/**
+ * @brief Tasks subscribed to the changes of a property, one bit per task (see task_bit()).
+ * @note  A subscribed task gets a Ux::System::PropertiesChanged message when one of its properties has changed.
+ *        The message is coalesced: it only tells that something changed, the task reads the properties it needs
+ *        when handling it. Specialize below for the properties with subscribers.
+ */
+template <typename P>
+constexpr uint32_t subscribers = 0;
+
+// clang-format off
+// LED indications of the Audio task: charging level and source patterns
+template <> constexpr uint32_t subscribers<Teufel::Ux::System::ChargerStatus> = task_bit(Teufel::Ux::System::Task::Audio);
+template <> constexpr uint32_t subscribers<Teufel::Ux::System::BatteryLevel>  = task_bit(Teufel::Ux::System::Task::Audio);
+template <> constexpr uint32_t subscribers<Teufel::Ux::Bluetooth::Status>     = task_bit(Teufel::Ux::System::Task::Audio);
+// clang-format on
+
+// Tasks which handle the PropertiesChanged message
+constexpr uint32_t supported_subscribers = task_bit(Teufel::Ux::System::Task::Audio);
+
+/**
+ * @brief Flags the change for the tasks and posts them a PropertiesChanged message, unless one is still queued.
+ * @note  Task context only. Never waits for space in the queue of a subscriber, and a task does not post to itself:
+ *        the subscriber takes the change from its idle callback then.
+ */
+void notify(uint32_t tasks);
+
+/**
+ * @brief Returns whether a property the task subscribed to has changed since the last call, clears the flag.
+ * @note  Called by the task when handling PropertiesChanged, and from its idle callback to catch up if the message
+ *        could not be posted.
+ */
+bool take(Teufel::Ux::System::Task task);
+
+template <typename P>
+void publish()
+{
+    static_assert((subscribers<P> & ~supported_subscribers) == 0, "A subscriber does not handle PropertiesChanged");
+
+    if constexpr (subscribers<P> != 0)
+        notify(subscribers<P>);
+}
+
+}
+
+// Setters of the properties, publishing the change to the subscribers only if the value has changed
+#define PROPERTY_SET(_TYPE, _VARIABLE)                                                                                 \
+    static void setProperty(_TYPE v)                                                                                   \
+    {                                                                                                                  \
+        if (_VARIABLE.set(v.value))                                                                                    \
+            Teufel::Task::PropertyBus::publish<_TYPE>();                                                               \
+    }
+
+#define PROPERTY_ENUM_SET(_TYPE, _VARIABLE)                                                                            \
+    static void setProperty(_TYPE v)                                                                                   \
+    {                                                                                                                  \
+        if (_VARIABLE.set(v, getDesc(v)))                                                                              \
+            Teufel::Task::PropertyBus::publish<_TYPE>();                                                               \
+    }
@@ -0,0 +1,117 @@
+#include "task_load.h"
+
+#if defined(TASK_RUN_TIME_STATS)
+
+#include <cstdio>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "scratch.h"
+
+namespace Teufel::Task::Load
+{
+
+// Audio, Bluetooth, System, Deferred, Logger, IDLE and Tmr Svc, with room to spare
+constexpr size_t MAX_TASKS = 8;
+
+struct TaskLoad
+{
+    TaskHandle_t task;
+    const char  *name;
+    uint32_t     last_run_time_us;
+    uint64_t     total_us;
+    uint16_t     load_permille[LOAD_WINDOW_S];
+};
+
+// uxTaskGetSystemState() needs room for every task, which would take a lot of the stack. The statuses are only
+// needed while sampling, they are borrowed from the scratch arena.
+static_assert(MAX_TASKS * sizeof(TaskStatus_t) <= Scratch::ARENA_SIZE, "The task statuses must fit the arena");
+
+static TaskLoad s_loads[MAX_TASKS];
+static size_t   s_task_count     = 0;
+static uint32_t s_last_sample_ms = 0;
+static unsigned s_window_index   = 0;
+static unsigned s_window_samples = 0;
+
+static TaskLoad *get_task_load(const TaskStatus_t &status)
+{
+    // Tasks are never deleted, their handles identify them for good
+    for (size_t i = 0; i < s_task_count; i++)
+    {
+        if (s_loads[i].task == status.xHandle)
+            return &s_loads[i];
+    }
+
+    if (s_task_count == MAX_TASKS)
+        return nullptr;
+
+    TaskLoad &load = s_loads[s_task_count++];
+    load.task      = status.xHandle;
+    load.name      = status.pcTaskName;
+    return &load;
+}
+
+void sample()
+{
+    const uint32_t now_ms     = xTaskGetTickCount();
+    const uint32_t elapsed_ms = now_ms - s_last_sample_ms;
+    if (elapsed_ms == 0)
+        return;
+
+    auto *p_status = static_cast<TaskStatus_t *>(
+        Scratch::acquire(Scratch::Owner::TaskLoadSample, MAX_TASKS * sizeof(TaskStatus_t)));
+    if (p_status == nullptr)
+        return;
+
+    // Fails (returns 0) if there are more tasks than MAX_TASKS
+    const UBaseType_t count = uxTaskGetSystemState(p_status, MAX_TASKS, nullptr);
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        TaskLoad *p_load = get_task_load(p_status[i]);
+        if (p_load == nullptr)
+            continue;
+
+        // The clock ticks in microseconds, the difference is right even if the counter wrapped around
+        const uint32_t run_time_us = p_status[i].ulRunTimeCounter - p_load->last_run_time_us;
+        const uint32_t permille    = run_time_us / elapsed_ms;
+
+        p_load->last_run_time_us              = p_status[i].ulRunTimeCounter;
+        p_load->total_us                     += run_time_us;
+        p_load->load_permille[s_window_index] = permille > 1000 ? 1000 : permille;
+    }
+
+    Scratch::release(Scratch::Owner::TaskLoadSample);
+
+    s_last_sample_ms = now_ms;
+    s_window_index   = (s_window_index + 1) % LOAD_WINDOW_S;
+    if (s_window_samples < LOAD_WINDOW_S)
+        s_window_samples++;
+}
+
+void print()
+{
+    if (s_window_samples == 0)
+        return;
+
+    const unsigned last_index = (s_window_index + LOAD_WINDOW_S - 1) % LOAD_WINDOW_S;
+
+    printf("%-10s %10s %6s %6s\r\n", "task", "total ms", "1s", "10s");
+    for (size_t i = 0; i < s_task_count; i++)
+    {
+        const TaskLoad &load = s_loads[i];
+
+        unsigned window_permille = 0;
+        for (unsigned j = 0; j < LOAD_WINDOW_S; j++)
+            window_permille += load.load_permille[j];
+        window_permille /= s_window_samples;
+
+        const unsigned last_permille = load.load_permille[last_index];
+        printf("%-10s %10lu %3u.%u%% %3u.%u%%\r\n", load.name, static_cast<unsigned long>(load.total_us / 1000),
+               last_permille / 10, last_permille % 10, window_permille / 10, window_permille % 10);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#if defined(TASK_RUN_TIME_STATS)
+
+namespace Teufel::Task::Load
+{
+
+// Loads are averaged over the last second and over the last LOAD_WINDOW_S seconds
+constexpr unsigned LOAD_WINDOW_S = 10;
+
+/**
+ * @brief Takes the run time of every task since the previous sample, to be called once a second.
+ * @note  Loads are relative to the time elapsed, according to the tick. The time spent in STOP mode
+ *        is not accounted to any task (the run time stats clock is halted there).
+ */
+void sample();
+
+/**
+ * @brief Prints the cumulative run time and the 1 s and 10 s load of every task.
+ */
+void print();
+
+}
+
+#endif
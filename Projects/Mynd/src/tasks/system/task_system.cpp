@@ -18,15 +18,21 @@
 #include "board.h"
 #include "board_link.h"
 #include "bsp_debug_uart.h"
+#include "bsp_low_power.h"
 #include "logger.h"
 
 #include "task_audio.h"
 #include "task_bluetooth.h"
 #include "task_system.h"
+#include "task_load.h"
+#include "scratch.h"
+#include "timeline.h"
 #include "task_priorities.h"
 #include "external/teufel/libs/property/property.h"
+#include "property_bus.h"
 #include "external/teufel/libs/core_utils/overload.h"
 #include "external/teufel/libs/core_utils/sync.h"
+#include "external/teufel/libs/core_utils/timer_wheel.h"
 #include "external/teufel/libs/app_assert/app_assert.h"
 #include "ux/system/system.h"
 #include "persistent_storage/kvstorage.h"
@@ -37,6 +43,16 @@
 #define TASK_SYSTEM_STACK_SIZE 384
 #define QUEUE_SIZE             5
 
+// Every input event reports user activity, one queued report is enough to restart the idle timeout
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::System::SystemMessage, Teufel::Ux::System::UserActivity> =
+        Teufel::GenericThread::PostPolicy::Coalesce;
+template <>
+constexpr Teufel::GenericThread::PostPolicy
+    Teufel::GenericThread::post_policy<Teufel::Task::System::SystemMessage, Teufel::Ux::System::SetPowerState> =
+        Teufel::GenericThread::PostPolicy::Urgent;
+
 namespace Teufel::Task::System
 {
 
@@ -65,6 +81,9 @@ static StackType_t  system_task_stack[TASK_SYSTEM_STACK_SIZE];
 static StaticQueue_t queue_static;
 static const size_t  queue_item_size = sizeof(GenericThread::QueueMessage<SystemMessage>);
 static uint8_t       queue_static_buffer[QUEUE_SIZE * queue_item_size];
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+static GenericThread::ThreadStatsBuffer<SystemMessage> thread_stats;
+#endif
 
 // We consider that the power state is "transitioning" when the system is first booting up
 // This prevents other tasks from assuming that the system is in a normal stable state
@@ -98,112 +117,293 @@ static struct
     power_state_fn_t  power_state_fn            = reinterpret_cast<power_state_fn_t>(power_state_off);
     uint32_t          last_activity_timestamp   = 0;
     uint32_t          stream_inactive_timestamp = 0;
+    uint32_t          shell_input_timestamp     = 0;
     SemaphoreHandle_t property_mutex            = nullptr;
 } s_system;
 
+// While the speaker is off the idle pass only runs this often, unless the shell has been used recently
+constexpr uint32_t c_idle_period_off_ms = 500;
+constexpr uint32_t c_shell_active_ms    = 30000;
+
 static StaticSemaphore_t property_mutex_buffer;
 
-static power_state_fn_t power_state_on(const Tus::PowerState &p, const Ux::System::PowerStateChangeReason &reason)
+// Set by each task started by the System task once it is initialized, they stay set
+static Core::EventBits<Tus::Task> s_tasks_ready;
+
+static void await_task_ready(Tus::Task task, uint32_t timeout_ms)
 {
-    switch (p)
+    if (s_tasks_ready.waitAll({task}, timeout_ms) == 0)
+        log_info("Task %s started", getDesc(task));
+    else
+        log_err("Task %s start timeout", getDesc(task));
+}
+
+// Power sequencing: each step hands a power state to a task and waits until the task reports that it reached it.
+// The System task keeps handling messages in between, the timeouts are only fallbacks for a task not reporting back.
+enum class PowerStep : uint8_t
+{
+    Idle,
+    // Powering off
+    ExitMultichain,
+    PrepareAudioOff,
+    PlayOffSoundIcon,
+    DisableAmps,
+    DisableBluetooth,
+    OffComplete,
+    // Powering on
+    EnableAmps,
+    EnableBluetooth,
+    StartAmps,
+    OnComplete,
+};
+
+static void power_step_timeout();
+
+static struct
+{
+    PowerStep                             step     = PowerStep::Idle;
+    Tus::PowerStateChangeReason           reason   = Tus::PowerStateChangeReason::UserRequest;
+    Tus::SetPowerState                    msg      = {Tus::PowerState::Off};
+    uint32_t                              start_ts = 0;
+    std::optional<Tus::PowerStateReached> awaited  = std::nullopt;
+    // The last power state requested while a sequence is running, applied once it has completed
+    std::optional<Tus::SetPowerState> deferred_request = std::nullopt;
+} s_power_sequence;
+
+// Periodic and delayed jobs of the task, run from its idle callback
+using TaskTimers = TimerWheel<4, 250>;
+static TaskTimers        s_timers{get_systick};
+static TaskTimers::Timer s_power_step_timer{"power step", power_step_timeout};
+
+static void await_power_state(Tus::Task task, Tus::PowerState state, uint32_t timeout_ms)
+{
+    s_power_sequence.awaited = Tus::PowerStateReached{task, state};
+    s_timers.start(s_power_step_timer, timeout_ms);
+}
+
+// Starts the current step, returns false if there is nothing to wait for
+static bool start_power_step()
+{
+    auto &seq = s_power_sequence;
+
+    switch (seq.step)
     {
-        case Tus::PowerState::Off:
+        case PowerStep::ExitMultichain:
         {
-            log_highlight("Powering off (%s)", getDesc(reason));
-
             // MCU needs to explicitly exit active csb mode if charger is connected when unit is powered off
             // otherwise, the unit powers back on into CSB mode
-            if (isPropertyOneOf(Tub::Status::CsbChainMaster, Tub::Status::ChainSlave))
-            {
-                Teufel::Task::Bluetooth::postMessage(
-                    ot_id, Teufel::Ux::Bluetooth::StopPairingAndMultichain{Tub::MultichainExitReason::PowerOff});
-                vTaskDelay(pdMS_TO_TICKS(800)); // BT module needs time (derived w/ testing) to handle request and play
-                                                // CSB disconnected si, before power off si
-            }
+            if (not isPropertyOneOf(Tub::Status::CsbChainMaster, Tub::Status::ChainSlave))
+                return false;
+
+            Teufel::Task::Bluetooth::postMessage(
+                ot_id, Teufel::Ux::Bluetooth::StopPairingAndMultichain{Tub::MultichainExitReason::PowerOff});
+            // BT module needs time (derived w/ testing) to handle request and play CSB disconnected si, before power
+            // off si. It does not report when it is done.
+            s_timers.start(s_power_step_timer, 800);
+            return true;
+        }
 
-            auto set_power_msg =
-                p_power_state.setTransition(Tus::PowerState::PreOff, reason, getDesc(Tus::PowerState::PreOff));
+        case PowerStep::PrepareAudioOff:
+        {
+            seq.msg =
+                p_power_state.setTransition(Tus::PowerState::PreOff, seq.reason, getDesc(Tus::PowerState::PreOff));
 
             // Tell the audio task to prepare for power off (start LED animations, etc.)
-            Teufel::Task::Audio::postMessage(ot_id, set_power_msg);
-            SyncPrimitive::await(Tus::Task::Audio, 6000, "power off prep done");
-
-            vTaskDelay(pdMS_TO_TICKS(1000)); // Wait once the battery low sound icon is played
-            if (reason != Tus::PowerStateChangeReason::OffTimer)
-            {
-                Teufel::Task::Bluetooth::postMessage(
-                    ot_id, Tua::RequestSoundIcon{ACTIONSLINK_SOUND_ICON_POWER_OFF,
-                                                 ACTIONSLINK_SOUND_ICON_PLAYBACK_MODE_PLAY_IMMEDIATELY, false});
-            }
+            Teufel::Task::Audio::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Audio, Tus::PowerState::PreOff, 6000);
+            return true;
+        }
 
-            // Tell the BT task to prepare for power off (play power off sound icon, etc.)
-            // It should synchronize once the whole sound icon has played
-            Teufel::Task::Bluetooth::postMessage(ot_id, set_power_msg);
-            SyncPrimitive::await(Tus::Task::Bluetooth, 4000, "played off sound icon");
+        case PowerStep::PlayOffSoundIcon:
+        {
+            // Tell the BT task to prepare for power off: it lets the battery low sound icon finish and plays the
+            // power off sound icon. It reports PreOff once the sound icons have played.
+            Teufel::Task::Bluetooth::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Bluetooth, Tus::PowerState::PreOff, 4000);
+            return true;
+        }
 
-            set_power_msg = p_power_state.setTransition(Tus::PowerState::Off, reason, getDesc(Tus::PowerState::Off));
+        case PowerStep::DisableAmps:
+        {
+            seq.msg = p_power_state.setTransition(Tus::PowerState::Off, seq.reason, getDesc(Tus::PowerState::Off));
 
             // Once the power off sound icon has played, we can turn off the amps
-            Teufel::Task::Audio::postMessage(ot_id, set_power_msg);
-            SyncPrimitive::await(Tus::Task::Audio, 3000, "completed power off");
+            Teufel::Task::Audio::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Audio, Tus::PowerState::Off, 3000);
+            return true;
+        }
 
+        case PowerStep::DisableBluetooth:
+        {
             // Once the amps are off, we can turn off the BT module
-            Teufel::Task::Bluetooth::postMessage(ot_id, set_power_msg);
-            SyncPrimitive::await(Tus::Task::Bluetooth, 5000, "completed power off");
+            Teufel::Task::Bluetooth::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Bluetooth, Tus::PowerState::Off, 5000);
+            return true;
+        }
 
+        case PowerStep::OffComplete:
+        {
             if (not isProperty(Tus::ChargerStatus::Active))
                 board_link_charger_enable_low_power_mode(true);
 
             board_link_power_supply_hold_on(false);
             p_power_state.set(Tus::PowerState::Off, getDesc(Tus::PowerState::Off));
+            bsp_low_power_allow_stop(true);
 
-            return reinterpret_cast<power_state_fn_t>(power_state_off);
+            Timeline::record(Timeline::Milestone::PoweredOff);
+            log_info("Powered off in %lu ms", board_get_ms_since(seq.start_ts));
+            return false;
         }
+
+        case PowerStep::EnableAmps:
+        {
+            seq.msg = p_power_state.setTransition(Tus::PowerState::PreOn, seq.reason, getDesc(Tus::PowerState::PreOn));
+            board_link_power_supply_hold_on(true);
+
+            // The audio task reports PreOn once the amps are enabled, and goes on with their configuration
+            Teufel::Task::Audio::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Audio, Tus::PowerState::PreOn, 200);
+            return true;
+        }
+
+        case PowerStep::EnableBluetooth:
+        {
+            // Bluetooth task does not need a PreOn state as of now, so we skip it
+            seq.msg = p_power_state.setTransition(Tus::PowerState::On, seq.reason, getDesc(Tus::PowerState::On));
+
+            // The BT module boots while the audio task configures the amps.
+            // The BT task reports On once the BT module is powered on and its audio source is known.
+            Teufel::Task::Bluetooth::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Bluetooth, Tus::PowerState::On, 4000);
+            return true;
+        }
+
+        case PowerStep::StartAmps:
+        {
+            // The amps must not leave Hi-Z before the I2S BCLK, provided by the BT module, is stable.
+            // The audio task handles On once it has configured the amps.
+            log_dbg("Assuming I2S active, starting amps");
+            Teufel::Task::Audio::postMessage(ot_id, seq.msg);
+            await_power_state(Tus::Task::Audio, Tus::PowerState::On, 3000);
+            return true;
+        }
+
+        case PowerStep::OnComplete:
+        {
+            Teufel::Task::Bluetooth::postMessage(
+                ot_id, Tua::RequestSoundIcon{ACTIONSLINK_SOUND_ICON_POWER_ON,
+                                             ACTIONSLINK_SOUND_ICON_PLAYBACK_MODE_PLAY_IMMEDIATELY, false});
+
+            Timeline::record(Timeline::Milestone::PowerOnSoundIconRequested);
+            p_power_state.set(Tus::PowerState::On, getDesc(Tus::PowerState::On));
+
+            // From the power on request to the power on sound icon
+            log_info("Powered on in %lu ms", board_get_ms_since(seq.start_ts));
+            return false;
+        }
+
         default:
-            break;
+            return false;
     }
+}
 
-    return reinterpret_cast<power_state_fn_t>(power_state_on);
+static PowerStep next_power_step(PowerStep step)
+{
+    if (step == PowerStep::OffComplete || step == PowerStep::OnComplete)
+        return PowerStep::Idle;
+
+    return static_cast<PowerStep>(static_cast<uint8_t>(step) + 1);
 }
 
-static power_state_fn_t power_state_off(const Tus::PowerState &p, const Ux::System::PowerStateChangeReason &reason)
+// Runs the steps from the given one on, until a step has to wait
+static void run_power_sequence(PowerStep step)
 {
-    switch (p)
+    auto &seq = s_power_sequence;
+
+    s_timers.stop(s_power_step_timer);
+    seq.awaited.reset();
+
+    seq.step = step;
+    while (seq.step != PowerStep::Idle && not start_power_step())
+        seq.step = next_power_step(seq.step);
+
+    // Requested while the sequence was running, handled like a new request
+    if (seq.step == PowerStep::Idle && seq.deferred_request.has_value())
     {
-        case Tus::PowerState::On:
-        {
-            log_highlight("Powering on");
+        Task::System::postMessage(ot_id, *seq.deferred_request);
+        seq.deferred_request.reset();
+    }
+}
 
-            auto set_power_msg =
-                p_power_state.setTransition(Tus::PowerState::PreOn, reason, getDesc(Tus::PowerState::PreOn));
-            board_link_power_supply_hold_on(true);
+static void power_step_timeout()
+{
+    if (s_power_sequence.awaited.has_value())
+    {
+        log_err("Power: task %s did not report %s in time", getDesc(s_power_sequence.awaited->task),
+                getDesc(s_power_sequence.awaited->state));
+    }
 
-            Teufel::Task::Audio::postMessage(ot_id, set_power_msg);
-            SyncPrimitive::await(Tus::Task::Audio, 200, "enabled amps");
+    run_power_sequence(next_power_step(s_power_sequence.step));
+}
 
-            // Bluetooth task does not need a PreOn state as of now, so we skip it
+static void on_power_state_reached(const Tus::PowerStateReached &p)
+{
+    const auto &awaited = s_power_sequence.awaited;
 
-            set_power_msg = p_power_state.setTransition(Tus::PowerState::On, reason, getDesc(Tus::PowerState::On));
+    // A report after the timeout of its step is ignored, the sequence went on without it
+    if (not awaited.has_value() || awaited->task != p.task || awaited->state != p.state)
+        return;
 
-            Teufel::Task::Bluetooth::postMessage(ot_id, set_power_msg);
-            SyncPrimitive::await(Tus::Task::Bluetooth, 4000, "enabled BT");
+    log_info("Task %s reached %s", getDesc(p.task), getDesc(p.state));
+    run_power_sequence(next_power_step(s_power_sequence.step));
+}
 
-            // Delay enough for the BT module to power on and start I2S
-            // The amps need the I2S BCLK to be stable before they can be configured
-            // TODO: make it synchronous with BT ActionsReady
-            // TODO: keep it until we clarify power on sequence with BT team
-            // vTaskDelay(pdMS_TO_TICKS(1000));
+static void request_power_state(Tus::PowerState to, Tus::PowerStateChangeReason reason)
+{
+    if (s_power_sequence.step != PowerStep::Idle)
+    {
+        s_power_sequence.deferred_request = Tus::SetPowerState{.to = to, .reason = reason};
+        return;
+    }
 
-            log_dbg("Assuming I2S active, configuring amps");
-            Teufel::Task::Audio::postMessage(ot_id, set_power_msg);
+    s_system.power_state_fn = (power_state_fn_t) (*s_system.power_state_fn)(to, reason);
+}
 
-            SyncPrimitive::await(Tus::Task::Audio, 3000, "completed power on");
+static power_state_fn_t power_state_on(const Tus::PowerState &p, const Ux::System::PowerStateChangeReason &reason)
+{
+    switch (p)
+    {
+        case Tus::PowerState::Off:
+        {
+            log_highlight("Powering off (%s)", getDesc(reason));
+            Timeline::record(Timeline::Milestone::PowerOffRequested);
 
-            Teufel::Task::Bluetooth::postMessage(
-                ot_id, Tua::RequestSoundIcon{ACTIONSLINK_SOUND_ICON_POWER_ON,
-                                             ACTIONSLINK_SOUND_ICON_PLAYBACK_MODE_PLAY_IMMEDIATELY, false});
+            s_power_sequence.reason   = reason;
+            s_power_sequence.start_ts = get_systick();
+            run_power_sequence(PowerStep::ExitMultichain);
 
-            p_power_state.set(Tus::PowerState::On, getDesc(Tus::PowerState::On));
+            return reinterpret_cast<power_state_fn_t>(power_state_off);
+        }
+        default:
+            break;
+    }
+
+    return reinterpret_cast<power_state_fn_t>(power_state_on);
+}
+
+static power_state_fn_t power_state_off(const Tus::PowerState &p, const Ux::System::PowerStateChangeReason &reason)
+{
+    switch (p)
+    {
+        case Tus::PowerState::On:
+        {
+            log_highlight("Powering on");
+            Timeline::record(Timeline::Milestone::PowerOnRequested);
+            bsp_low_power_allow_stop(false);
+
+            s_power_sequence.reason   = reason;
+            s_power_sequence.start_ts = get_systick();
+            run_power_sequence(PowerStep::EnableAmps);
 
             return reinterpret_cast<power_state_fn_t>(power_state_on);
         }
@@ -249,12 +449,16 @@ void check_idle_timeout()
             board_get_ms_since(s_system.stream_inactive_timestamp) >
                 (getProperty<Tus::OffTimer>().value * CONFIG_IDLE_POWER_OFF_TIMEOUT_MS_FACTOR))
         {
-            s_system.power_state_fn = (power_state_fn_t) (*s_system.power_state_fn)(
-                Tus::PowerState::Off, Tus::PowerStateChangeReason::OffTimer);
+            request_power_state(Tus::PowerState::Off, Tus::PowerStateChangeReason::OffTimer);
         }
     }
 }
 
+static TaskTimers::Timer s_idle_timeout_timer{"idle timeout", check_idle_timeout};
+#if defined(TASK_RUN_TIME_STATS)
+static TaskTimers::Timer s_task_load_timer{"task load", Load::sample};
+#endif
+
 static const GenericThread::Config<SystemMessage> threadConfig = {
     .Name      = "System",
     .StackSize = TASK_SYSTEM_STACK_SIZE,
@@ -267,9 +471,17 @@ static const GenericThread::Config<SystemMessage> threadConfig = {
         if (bsp_debug_uart_rx(&uart_rx_data, 1) == 0)
         {
             tshell_process_char(uart_rx_data);
+            s_system.shell_input_timestamp = get_systick();
         }
 
-        check_idle_timeout();
+        s_timers.process();
+
+        // Nothing to poll quickly while the speaker is off, messages still wake the task up immediately
+        if (isProperty(Tus::PowerState::Off) && board_get_ms_since(s_system.shell_input_timestamp) > c_shell_active_ms)
+        {
+            GenericThread::scheduleIdle(
+                task_handler, std::min(c_idle_period_off_ms, s_timers.msUntilNextExpiry().value_or(UINT32_MAX)));
+        }
     },
     .Callback_Init =
         []()
@@ -296,10 +508,11 @@ static const GenericThread::Config<SystemMessage> threadConfig = {
         board_link_moisture_detection_init();
 
         Teufel::Task::Audio::start();
-        SyncPrimitive::await(Tus::Task::Audio, 2000, "started");
+        await_task_ready(Tus::Task::Audio, 2000);
 
         Teufel::Task::Bluetooth::start();
-        SyncPrimitive::await(Tus::Task::Bluetooth, 2000, "started");
+        await_task_ready(Tus::Task::Bluetooth, 2000);
+        Timeline::record(Timeline::Milestone::TasksStarted);
 
         // If the bootloader wrote the magic # to the RTC->BKP0R reg, then an update was performed and device must power
         // on or If the power supply is already held on that means that the speaker should be powered on because the
@@ -319,6 +532,13 @@ static const GenericThread::Config<SystemMessage> threadConfig = {
         // This prevents other tasks from assuming that the system is in a normal stable state
         // when in reality the system is still initializing
         p_power_state.set(Tus::PowerState::Off, getDesc(Tus::PowerState::Off));
+        bsp_low_power_allow_stop(true);
+
+        // The off timer is set in minutes, checking it every second is more than enough
+        s_timers.start(s_idle_timeout_timer, 1000, 1000);
+#if defined(TASK_RUN_TIME_STATS)
+        s_timers.start(s_task_load_timer, 1000, 1000);
+#endif
     },
     .QueueSize = QUEUE_SIZE,
     .Callback =
@@ -328,9 +548,9 @@ static const GenericThread::Config<SystemMessage> threadConfig = {
             Teufel::Core::overload{
                 [](const Tus::SetPowerState &p)
                 {
-                    s_system.power_state_fn = (power_state_fn_t) (*s_system.power_state_fn)(
-                        p.to, p.reason.value_or(Tus::PowerStateChangeReason::UserRequest));
+                    request_power_state(p.to, p.reason.value_or(Tus::PowerStateChangeReason::UserRequest));
                 },
+                [](const Tus::PowerStateReached &p) { on_power_state_reached(p); },
                 [](const Tus::UserActivity &) { s_system.last_activity_timestamp = get_systick(); },
                 [](const Tus::OffTimer &p) { setProperty(p); },
                 [](const Tus::OffTimerEnabled &p) { setProperty(p); },
@@ -339,8 +559,11 @@ static const GenericThread::Config<SystemMessage> threadConfig = {
                     log_info("Initiating factory reset");
 
                     // Perform factory reset
-                    setProperty(Tus::OffTimerEnabled{CONFIG_STANDBY_TIMER_MINS_DEFAULT > 0});
-                    setProperty(Tus::OffTimer{CONFIG_STANDBY_TIMER_MINS_DEFAULT});
+                    {
+                        PropertyLock lock;
+                        setProperty(Tus::OffTimerEnabled{CONFIG_STANDBY_TIMER_MINS_DEFAULT > 0});
+                        setProperty(Tus::OffTimer{CONFIG_STANDBY_TIMER_MINS_DEFAULT});
+                    }
                     log_info("Power-off Timer: %d min", getProperty<Tus::OffTimer>().value);
 
                     Teufel::Task::Bluetooth::postMessage(ot_id, Tus::FactoryReset{});
@@ -357,6 +580,9 @@ static const GenericThread::Config<SystemMessage> threadConfig = {
     .StaticTask  = &system_task_buffer,
     .StaticQueue = &queue_static,
     .QueueBuffer = queue_static_buffer,
+#if defined(GENERIC_THREAD_ENABLE_STATS)
+    .Stats       = &thread_stats,
+#endif
 };
 
 static IMutex p_mutex{
@@ -396,6 +622,16 @@ int start()
     return 0;
 }
 
+TaskHandle_t getTaskHandle()
+{
+    return task_handler ? GenericThread::getTaskHandle(task_handler) : nullptr;
+}
+
+void setTaskReady(Tus::Task task)
+{
+    s_tasks_ready.set(task);
+}
+
 int postMessage(Tus::Task source_task, SystemMessage msg)
 {
     return GenericThread::PostMsg(task_handler, static_cast<uint8_t>(source_task), msg);
@@ -418,6 +654,69 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
 SHELL_CMD_ARG_REGISTER(p, &sub_power, "power", NULL, 2, 0);
 #endif
 
+// Both enabled by TASK_STATS_COMPILER_FLAGS
+#if !defined(BOOTLOADER) && defined(GENERIC_THREAD_ENABLE_STATS) && defined(TASK_RUN_TIME_STATS)
+static void print_callback_stats(const char *name, unsigned index, const GenericThread::CallbackStats &stats)
+{
+    if (stats.count == 0)
+        return;
+
+    printf("  %s%u: %lu runs, avg %lu us, max %lu us\r\n", name, index, stats.count, stats.total_us / stats.count,
+           stats.max_us);
+}
+
+static void print_task_stats()
+{
+    for (const GenericThread::ThreadStats *p = GenericThread::stats_list; p != nullptr; p = p->next)
+    {
+        printf("%s: stack %lu/%lu B, queue %u/%u", p->name,
+               (p->stack_size - uxTaskGetStackHighWaterMark(p->task)) * sizeof(StackType_t),
+               p->stack_size * sizeof(StackType_t), p->max_queued, p->queue_size);
+        if (p->priority_queue_size > 0)
+            printf(", priority queue %u/%u", p->max_priority_queued, p->priority_queue_size);
+        printf(", posted %lu, coalesced %lu, failed %lu\r\n", p->posted, p->coalesced, p->failed);
+
+        // Messages are numbered by their index in the message variant of the task
+        print_callback_stats("idle", 0, p->idle);
+        for (size_t i = 0; i < p->message_types; i++)
+            print_callback_stats("msg ", i, p->messages[i]);
+    }
+
+    // Tasks not based on GenericThread (Deferred, Logger, IDLE, Tmr Svc), from the task list rather than by name
+    constexpr size_t MAX_TASKS = 8;
+    static_assert(MAX_TASKS * sizeof(TaskStatus_t) <= Scratch::ARENA_SIZE, "The task statuses must fit the arena");
+
+    auto *p_status =
+        static_cast<TaskStatus_t *>(Scratch::acquire(Scratch::Owner::TaskStats, MAX_TASKS * sizeof(TaskStatus_t)));
+    if (p_status == nullptr)
+        return;
+
+    const UBaseType_t count = uxTaskGetSystemState(p_status, MAX_TASKS, nullptr);
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        bool is_generic_thread = false;
+        for (const GenericThread::ThreadStats *p = GenericThread::stats_list; p != nullptr; p = p->next)
+            is_generic_thread = is_generic_thread || p->task == p_status[i].xHandle;
+
+        if (!is_generic_thread)
+            printf("%s: stack free %lu B\r\n", p_status[i].pcTaskName,
+                   static_cast<uint32_t>(p_status[i].usStackHighWaterMark * sizeof(StackType_t)));
+    }
+
+    Scratch::release(Scratch::Owner::TaskStats);
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    sub_tasks,
+    SHELL_CMD_NO_ARGS(show, "stack and queue high-water marks, message handling times", print_task_stats),
+    SHELL_CMD_NO_ARGS(reset, "reset the counters", []() { GenericThread::resetStats(); }),
+    SHELL_CMD_NO_ARGS(load, "run time and CPU load over 1 s and 10 s", Load::print),
+    SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(tasks, &sub_tasks, "task statistics", NULL, 2, 0);
+#endif
+
 }
 
 namespace Teufel::Ux::System
@@ -3,6 +3,9 @@
 #include <variant>
 #include <initializer_list>
 
+#include "FreeRTOS.h"
+#include "task.h"
+
 #include "ux/system/system.h"
 #include "ux/audio/audio.h"
 #include "ux/bluetooth/bluetooth.h"
@@ -16,6 +19,7 @@ namespace Teufel::Task::System
 // clang-format off
 using SystemMessage = std::variant<
     Teufel::Ux::System::SetPowerState,
+    Teufel::Ux::System::PowerStateReached,
     Teufel::Ux::System::UserActivity,
     Teufel::Ux::System::OffTimer,
     Teufel::Ux::System::OffTimerEnabled,
@@ -26,5 +30,14 @@ using SystemMessage = std::variant<
 Teufel::Ux::System::PowerState getState();
 
 int start();
+
+// Handle of the task, cached when it is created by start()
+TaskHandle_t getTaskHandle();
+
+/**
+ * @brief Reports the end of the initialization of a task, which the system task waits for when starting it.
+ */
+void setTaskReady(Teufel::Ux::System::Task task);
+
 int postMessage(Teufel::Ux::System::Task source_task, SystemMessage msg);
 }
@@ -6,3 +6,5 @@
 #define TASK_AUDIO_PRIORITY     (tskIDLE_PRIORITY + 1)
 #define TASK_BLUETOOTH_PRIORITY (tskIDLE_PRIORITY + 2)
 #define TASK_SYSTEM_PRIORITY    (tskIDLE_PRIORITY + 1)
+// Runs the work deferred by the interrupt handlers, before any other task
+#define TASK_DEFERRED_WORK_PRIORITY (configMAX_PRIORITIES - 1)
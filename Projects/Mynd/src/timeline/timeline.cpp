@@ -0,0 +1,76 @@
+#include "timeline.h"
+
+#if !defined(BOOTLOADER)
+
+#include <cstdio>
+#include <cstddef>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "board.h"
+
+#include "external/teufel/libs/tshell/tshell.h"
+
+namespace Teufel::Timeline
+{
+
+// A power on and a power off sequence with room to spare
+constexpr size_t TIMELINE_SIZE = 32;
+
+struct Entry
+{
+    uint32_t  ts_us;
+    Milestone milestone;
+};
+
+static Entry  s_entries[TIMELINE_SIZE];
+static size_t s_next  = 0;
+static size_t s_count = 0;
+
+void record(Milestone milestone)
+{
+    const uint32_t ts_us = board_get_us();
+
+    taskENTER_CRITICAL();
+    s_entries[s_next] = {ts_us, milestone};
+    s_next            = (s_next + 1) % TIMELINE_SIZE;
+    if (s_count < TIMELINE_SIZE)
+        s_count++;
+    taskEXIT_CRITICAL();
+}
+
+static void print()
+{
+    uint32_t prev_us = 0;
+
+    printf("%10s %10s  %s\r\n", "ms", "+us", "milestone");
+    for (size_t i = 0; i < s_count; i++)
+    {
+        const Entry &e = s_entries[(s_next + TIMELINE_SIZE - s_count + i) % TIMELINE_SIZE];
+
+        // Timestamp in ms and time since the previous milestone in us
+        const uint32_t delta_us = (i == 0) ? 0 : e.ts_us - prev_us;
+        printf("%6lu.%03lu %10lu  %s\r\n", e.ts_us / 1000, e.ts_us % 1000, delta_us, getDesc(e.milestone));
+        prev_us = e.ts_us;
+    }
+}
+
+static void clear()
+{
+    taskENTER_CRITICAL();
+    s_next  = 0;
+    s_count = 0;
+    taskEXIT_CRITICAL();
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_timeline,
+                               SHELL_CMD_NO_ARGS(show, "boot and power transition milestones", print),
+                               SHELL_CMD_NO_ARGS(clear, "clear the milestones", clear),
+                               SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(timeline, &sub_timeline, "milestone timeline", NULL, 2, 0);
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Teufel::Timeline
+{
+
+// Milestones of the boot and of the power transitions, printed by the 'timeline' shell command
+enum class Milestone : uint8_t
+{
+    TasksStarted,
+    // Powering on
+    PowerButtonPressed,
+    PowerOnRequested,
+    AmpsEnabled,
+    BluetoothReady,
+    WooferConfigured,
+    TweeterConfigured,
+    AmpsUnmuted,
+    PowerOnSoundIconRequested,
+    // Powering off
+    PowerOffRequested,
+    PowerOffSoundIconPlayed,
+    AmpsDisabled,
+    BluetoothOff,
+    PoweredOff,
+};
+
+inline auto getDesc(const Milestone &value)
+{
+    switch (value)
+    {
+        case Milestone::TasksStarted:
+            return "TasksStarted";
+        case Milestone::PowerButtonPressed:
+            return "PowerButtonPressed";
+        case Milestone::PowerOnRequested:
+            return "PowerOnRequested";
+        case Milestone::AmpsEnabled:
+            return "AmpsEnabled";
+        case Milestone::BluetoothReady:
+            return "BluetoothReady";
+        case Milestone::WooferConfigured:
+            return "WooferConfigured";
+        case Milestone::TweeterConfigured:
+            return "TweeterConfigured";
+        case Milestone::AmpsUnmuted:
+            return "AmpsUnmuted";
+        case Milestone::PowerOnSoundIconRequested:
+            return "PowerOnSoundIconRequested";
+        case Milestone::PowerOffRequested:
+            return "PowerOffRequested";
+        case Milestone::PowerOffSoundIconPlayed:
+            return "PowerOffSoundIconPlayed";
+        case Milestone::AmpsDisabled:
+            return "AmpsDisabled";
+        case Milestone::BluetoothOff:
+            return "BluetoothOff";
+        case Milestone::PoweredOff:
+            return "PoweredOff";
+        default:
+            return "Unknown";
+    }
+}
+
+#if defined(BOOTLOADER)
+// No shell to print the timeline
+inline void record(Milestone) {}
+#else
+/**
+ * @brief Records a milestone with a microsecond timestamp into a ring, the oldest milestones are overwritten.
+ * @note  Task context only.
+ */
+void record(Milestone milestone);
+#endif
+
+}
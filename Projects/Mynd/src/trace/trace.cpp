@@ -0,0 +1,110 @@
+#include "trace.h"
+
+#if defined(TRACE_RECORDER)
+
+#include <cstdio>
+#include <cstddef>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stm32f0xx.h"
+
+#include "bsp_run_time_stats.h"
+#include "scratch.h"
+#include "external/teufel/libs/tshell/tshell.h"
+
+#if !defined(TRACE_RECORDER_SIZE)
+#define TRACE_RECORDER_SIZE 128
+#endif
+
+static_assert((TRACE_RECORDER_SIZE & (TRACE_RECORDER_SIZE - 1)) == 0, "The trace size must be a power of two");
+
+struct TraceRecord
+{
+    uint32_t ts_us;
+    uint8_t  event;
+    uint8_t  id;
+    uint16_t arg;
+};
+
+static_assert(sizeof(TraceRecord) == 8, "Trace records are 8 bytes");
+
+static TraceRecord s_records[TRACE_RECORDER_SIZE];
+// Number of events recorded since the last clear, the ring index wraps around with it
+static uint32_t s_count  = 0;
+static bool     s_paused = false;
+
+// uxTaskGetSystemState() needs room for every task, the statuses are borrowed from the scratch arena for the dump
+constexpr size_t MAX_TASKS = 8;
+static_assert(MAX_TASKS * sizeof(TaskStatus_t) <= Teufel::Scratch::ARENA_SIZE, "The task statuses must fit the arena");
+
+void trace_record(uint8_t event, uint8_t id, uint16_t arg)
+{
+    // Called within the critical sections of the kernel as well, the interrupt mask is restored as it was
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (!s_paused)
+    {
+        TraceRecord &record = s_records[s_count % TRACE_RECORDER_SIZE];
+        record.ts_us        = bsp_run_time_stats_timer_get();
+        record.event        = event;
+        record.id           = id;
+        record.arg          = arg;
+        s_count++;
+    }
+
+    __set_PRIMASK(primask);
+}
+
+// Prints the records from the oldest on, for support/scripts/trace_to_perfetto.py
+static void dump()
+{
+    taskENTER_CRITICAL();
+    s_paused = true;
+    taskEXIT_CRITICAL();
+
+    const uint32_t count = (s_count < TRACE_RECORDER_SIZE) ? s_count : TRACE_RECORDER_SIZE;
+    printf("trace begin %lu %lu\r\n", count, s_count - count);
+
+    auto *p_status = static_cast<TaskStatus_t *>(
+        Teufel::Scratch::acquire(Teufel::Scratch::Owner::TraceDump, MAX_TASKS * sizeof(TaskStatus_t)));
+    if (p_status != nullptr)
+    {
+        const UBaseType_t tasks = uxTaskGetSystemState(p_status, MAX_TASKS, nullptr);
+        for (UBaseType_t i = 0; i < tasks; i++)
+        {
+            printf("trace task %lu %s\r\n", p_status[i].xTaskNumber, p_status[i].pcTaskName);
+        }
+        Teufel::Scratch::release(Teufel::Scratch::Owner::TraceDump);
+    }
+
+    for (uint32_t i = s_count - count; i != s_count; i++)
+    {
+        const TraceRecord &record = s_records[i % TRACE_RECORDER_SIZE];
+        printf("trace rec %08lx %02x %02x %04x\r\n", record.ts_us, record.event, record.id, record.arg);
+    }
+    printf("trace end\r\n");
+
+    taskENTER_CRITICAL();
+    s_paused = false;
+    taskEXIT_CRITICAL();
+}
+
+static void clear()
+{
+    taskENTER_CRITICAL();
+    s_count = 0;
+    taskEXIT_CRITICAL();
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_trace,
+                               SHELL_CMD_NO_ARGS(dump, "print the context switches, queue operations and interrupts",
+                                                 dump),
+                               SHELL_CMD_NO_ARGS(clear, "clear the trace", clear),
+                               SHELL_SUBCMD_SET_END /* Array terminated. */
+);
+
+SHELL_CMD_ARG_REGISTER(trace, &sub_trace, "scheduling trace", NULL, 2, 0);
+
+#endif // TRACE_RECORDER
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C"
+{
+#endif
+
+#if defined(TRACE_RECORDER)
+
+    // Events of the scheduling trace, hooked into the FreeRTOS trace macros (see FreeRTOSConfig.h) and the
+    // interrupt handlers (see irq_stats.h)
+    typedef enum
+    {
+        TRACE_TASK_SWITCHED_IN = 1, // id: task number
+        TRACE_ISR_ENTER,            // id: IRQ number
+        TRACE_ISR_EXIT,             // id: IRQ number
+        TRACE_QUEUE_SEND,           // id: queue type, arg: lower half of the queue address
+        TRACE_QUEUE_SEND_FAILED,    // id: queue type, arg: lower half of the queue address
+        TRACE_QUEUE_RECEIVE,        // id: queue type, arg: lower half of the queue address
+        TRACE_TASK_NOTIFY,          // id: task number of the notified task
+    } trace_event_t;
+
+    /**
+     * @brief Records an event into the RAM ring of the trace, the oldest records are overwritten.
+     * @note  Can be called from any context, including the scheduler and the interrupt handlers. The timestamp is
+     *        the run time stats clock (1 MHz).
+     */
+    void trace_record(uint8_t event, uint8_t id, uint16_t arg);
+
+#endif // TRACE_RECORDER
+
+#if defined(__cplusplus)
+}
+#endif
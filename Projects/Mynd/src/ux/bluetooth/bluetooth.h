@@ -23,9 +23,10 @@ struct StopPairingAndMultichain
     MultichainExitReason reason = MultichainExitReason::Unknown;
 };
 struct ClearDeviceList {};
-struct PlayPause {};
-struct NextTrack {};
-struct PreviousTrack {};
+// pressed_ts: get_systick() at the button event, 0 if the command does not come from a button
+struct PlayPause { uint32_t pressed_ts = 0; };
+struct NextTrack { uint32_t pressed_ts = 0; };
+struct PreviousTrack { uint32_t pressed_ts = 0; };
 
 enum class VolumeChange: uint8_t {
     Up,
@@ -5,20 +5,10 @@
 #endif // INCLUDE_PRODUCTION_TEST
 #include <cstdint>
 #include <optional>
+#include <tuple>
 
 #include "external/teufel/libs/power/power.h"
-
-#define PROPERTY_SET(_TYPE, _VARIABLE)                                                                                 \
-    static void setProperty(_TYPE v)                                                                                   \
-    {                                                                                                                  \
-        _VARIABLE.set(v.value);                                                                                        \
-    }
-
-#define PROPERTY_ENUM_SET(_TYPE, _VARIABLE)                                                                            \
-    static void setProperty(_TYPE v)                                                                                   \
-    {                                                                                                                  \
-        _VARIABLE.set(v, getDesc(v));                                                                                  \
-    }
+#include "external/teufel/libs/property/property.h"
 
 template <typename T>
 auto getProperty()
@@ -40,6 +30,17 @@ bool isProperty(T v)
     }
 }
 
+/**
+ * @brief Reads several properties consistently with each other, e.g. the battery level with the charger status.
+ * @note  Properties of the property library only (not the power state), see snapshot() in property.h
+ */
+template <typename... T>
+auto getProperties()
+{
+    PropertyLock lock;
+    return std::tuple<decltype(getProperty<T>())...>{getProperty<T>()...};
+}
+
 template <typename... T>
 bool isPropertyOneOf(T... v)
 {
@@ -305,6 +306,12 @@ inline auto getDesc(const PowerStateChangeReason &value)
 
 using SetPowerState = Power::SetPowerState<Ux::System::PowerState, PowerStateChangeReason>;
 
+// Reported to the System task by a task once it has reached the power state the System task sent to it
+struct PowerStateReached { Task task; PowerState state; };
+
+// Posted to a task when a property it subscribed to has changed, see tasks/property_bus.h
+struct PropertiesChanged {};
+
 // Public API
 PowerState      getProperty(PowerState *);
 LedBrightness   getProperty(LedBrightness *);
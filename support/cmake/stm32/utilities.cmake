@@ -21,9 +21,11 @@ function(stm32_util_create_family_targets FAMILY)
             $<$<COMPILE_LANGUAGE:CXX>:-fno-rtti -fno-exceptions>
         )
         # Additional flag that might be considered: -fno-strict-aliasing
+        # One map file per executable (<target>.map next to it), the targets of a directory would overwrite each other's
         target_link_options(STM32::${FAMILY}${CORE_C} INTERFACE
             --sysroot="${TOOLCHAIN_SYSROOT}"
-            -mthumb -mabi=aapcs -Wl,--gc-sections -Wl,--print-memory-usage -Xlinker -Map=output.map
+            -mthumb -mabi=aapcs -Wl,--gc-sections -Wl,--print-memory-usage
+            -Xlinker -Map=$<TARGET_PROPERTY:BINARY_DIR>/$<TARGET_PROPERTY:NAME>.map
             $<$<CONFIG:Debug>:-Og>
             $<$<CONFIG:Release>:-Os -g>
         )
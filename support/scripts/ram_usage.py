@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+
+"""Static RAM usage of a firmware per module, from the map file written by the GNU linker (-Map).
+
+Every input section placed in a RAM region is accounted to the module of the object file it comes from: the
+directory of the source file for the objects of the project, the archive for the libraries. .data* sections count
+as data, .bss* and COMMON as bss, the other RAM sections (heap and main stack reservation) are listed on their own.
+
+Maps of LTO builds only know the partitions of the link time optimizer, run this on a map of a build without LTO
+(e.g. the stack analysis target) to see the modules.
+"""
+
+import os
+import re
+import sys
+import argparse
+
+from collections import defaultdict
+from typing import Dict, List, Optional, Tuple
+
+MEMORY_RE = re.compile(r'^(?P<name>\S+)\s+0x(?P<origin>[0-9a-fA-F]+)\s+0x(?P<length>[0-9a-fA-F]+)(\s+\S+)?$')
+# Output section at column 0, its address and size on the same line or on the next one if the name is long
+OUTPUT_RE = re.compile(r'^(?P<name>\.?[A-Za-z_][\w.]*)(\s+0x(?P<addr>[0-9a-fA-F]+)\s+0x(?P<size>[0-9a-fA-F]+))?')
+# Input section, indented by one space, its address, size and object on the same line or on the next one
+INPUT_RE = re.compile(r'^ (?P<name>[^\s*][^\s]*|\*fill\*)(\s+0x(?P<addr>[0-9a-fA-F]+)\s+0x(?P<size>[0-9a-fA-F]+)(\s+(?P<obj>.+))?)?$')
+CONTINUATION_RE = re.compile(r'^\s+0x(?P<addr>[0-9a-fA-F]+)\s+0x(?P<size>[0-9a-fA-F]+)(\s+(?P<obj>.+))?$')
+ARCHIVE_RE = re.compile(r'(?P<archive>[^/\\]+\.a)\((?P<member>[^)]+)\)$')
+
+
+class Section:
+
+    def __init__(self, output: str, name: str, addr: int, size: int, obj: str):
+        self.output = output
+        self.name = name
+        self.addr = addr
+        self.size = size
+        self.obj = obj
+
+    @property
+    def kind(self) -> str:
+        if self.output.startswith(".data"):
+            return "data"
+        if self.output.startswith(".bss"):
+            return "bss"
+        return "other"
+
+    @property
+    def symbol(self) -> str:
+        # Sections of -fdata-sections are named after their symbol
+        for prefix in (".bss.", ".data.", ".sbss.", ".sdata."):
+            if self.name.startswith(prefix):
+                return self.name[len(prefix):]
+        return self.name
+
+
+def parse_map(path: str) -> Tuple[Dict[str, Tuple[int, int]], List[Tuple[str, int, int]], List[Section]]:
+    """Returns the memory regions, the output sections and the input sections (with an object file)"""
+    regions: Dict[str, Tuple[int, int]] = {}
+    outputs: List[Tuple[str, int, int]] = []
+    sections: List[Section] = []
+
+    with open(path, encoding="utf-8", errors="replace") as f:
+        lines = [line.rstrip("\n") for line in f]
+
+    i = 0
+    # Memory Configuration
+    while i < len(lines) and not lines[i].startswith("Memory Configuration"):
+        i += 1
+    while i < len(lines) and not lines[i].startswith("Linker script and memory map"):
+        m = MEMORY_RE.match(lines[i])
+        if m and m.group("name") != "Name":
+            regions[m.group("name")] = (int(m.group("origin"), 16), int(m.group("length"), 16))
+        i += 1
+
+    output: Optional[str] = None
+    while i < len(lines):
+        line = lines[i]
+        i += 1
+
+        if not line or line.startswith(("LOAD ", "OUTPUT(", "START GROUP", "END GROUP")):
+            continue
+
+        if not line[0].isspace():
+            m = OUTPUT_RE.match(line)
+            if not m:
+                continue
+            output = m.group("name")
+            addr, size = m.group("addr"), m.group("size")
+            if addr is None and i < len(lines):
+                c = CONTINUATION_RE.match(lines[i])
+                if c:
+                    addr, size = c.group("addr"), c.group("size")
+                    i += 1
+            if addr is not None:
+                outputs.append((output, int(addr, 16), int(size, 16)))
+            continue
+
+        m = INPUT_RE.match(line)
+        if not m or output is None or m.group("name") == "*fill*":
+            continue
+
+        addr, size, obj = m.group("addr"), m.group("size"), m.group("obj")
+        if addr is None and i < len(lines):
+            c = CONTINUATION_RE.match(lines[i])
+            if c:
+                addr, size, obj = c.group("addr"), c.group("size"), c.group("obj")
+                i += 1
+        if addr is None or obj is None:
+            continue
+
+        sections.append(Section(output, m.group("name"), int(addr, 16), int(size, 16), obj.strip()))
+
+    return regions, outputs, sections
+
+
+def module_of(obj: str) -> str:
+    m = ARCHIVE_RE.search(obj)
+    if m:
+        return m.group("archive")
+
+    if ".ltrans" in obj:
+        return "(lto partitions)"
+
+    # CMake objects: CMakeFiles/<target>.dir/<source path>.obj, sources outside of the project start with __/
+    path = obj.replace("\\", "/")
+    if ".dir/" in path:
+        path = path.split(".dir/", 1)[1]
+    parts = [p for p in path.split("/") if p not in ("__", "..", ".", "")]
+    return "/".join(parts[:-1]) if len(parts) > 1 else (parts[0] if parts else obj)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Prints the static RAM usage per module from a GNU ld map file")
+    parser.add_argument("map", help="Map file of the firmware")
+    parser.add_argument("-r", "--region", default="RAM", help="Memory region to report (default: RAM)")
+    parser.add_argument("-d", "--depth", type=int, default=0,
+                        help="Group the modules by their first DEPTH directories (default: 0, the whole directory)")
+    parser.add_argument("-s", "--symbols", type=int, default=15, help="Number of the largest symbols to list")
+    args = parser.parse_args(argv)
+
+    regions, outputs, sections = parse_map(args.map)
+    if args.region not in regions:
+        print("No {} region in {} ({})".format(args.region, args.map, ", ".join(regions) or "no regions"))
+        return 1
+
+    origin, length = regions[args.region]
+
+    def in_region(addr: int) -> bool:
+        return origin <= addr < origin + length
+
+    ram = [s for s in sections if s.size and in_region(s.addr)]
+    used = sum(size for _, addr, size in outputs if size and in_region(addr))
+
+    modules: Dict[str, Dict[str, int]] = defaultdict(lambda: defaultdict(int))
+    for s in ram:
+        module = module_of(s.obj)
+        if args.depth:
+            module = "/".join(module.split("/")[:args.depth])
+        modules[module][s.kind] += s.size
+
+    print("RAM usage of {} ({} region, {} bytes)".format(os.path.basename(args.map), args.region, length))
+    print()
+    print("{:<56} {:>7} {:>7} {:>7} {:>7}".format("module", "data", "bss", "other", "total"))
+    totals: Dict[str, int] = defaultdict(int)
+    for module, kinds in sorted(modules.items(), key=lambda item: -sum(item[1].values())):
+        for kind, size in kinds.items():
+            totals[kind] += size
+        print("{:<56} {:>7} {:>7} {:>7} {:>7}".format(module, kinds["data"], kinds["bss"], kinds["other"],
+                                                      sum(kinds.values())))
+    print("{:<56} {:>7} {:>7} {:>7} {:>7}".format("total", totals["data"], totals["bss"], totals["other"],
+                                                  sum(totals.values())))
+    print()
+    # Output sections include the alignment padding between the input sections and the reservations of the linker
+    # script (heap, main stack)
+    for name, addr, size in outputs:
+        if size and in_region(addr):
+            print("{:<56} {:>7}".format(name, size))
+    print("{} bytes used, {} bytes ({:.1f}%) free".format(used, length - used, 100.0 * (length - used) / length))
+
+    if args.symbols:
+        print()
+        print("Largest symbols")
+        for s in sorted(ram, key=lambda s: -s.size)[:args.symbols]:
+            print("{:>7} {:<5} {:<48} {}".format(s.size, s.kind, s.symbol, module_of(s.obj)))
+
+    if any(module_of(s.obj) == "(lto partitions)" for s in ram):
+        print()
+        print("This map is of an LTO build, use a map of a build without LTO to see the modules")
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
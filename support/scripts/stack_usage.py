@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+
+"""Worst-case stack depth of the tasks and interrupts of a firmware.
+
+Reads the call graph files (.ci) written by GCC with -fcallgraph-info=su,da, walks the call graph from the entry
+points of every stack listed in the budget file and fails if the deepest call chain does not fit in its stack.
+
+Budget file (JSON):
+    stacks:   [{name, stack_bytes, frame_bytes, roots}]
+              roots is a list of levels. A level is a pattern (or a list of patterns) matching the entry points
+              which use the stack. The depths of the levels add up (nested interrupts of different priorities),
+              within a level the deepest entry point counts. frame_bytes is added once per level (saved context,
+              exception frame).
+    indirect: [{from, to}]
+              Indirect calls made by the functions matching 'from' may call any function matching 'to'.
+    assume:   {pattern: bytes}
+              Stack usage of the functions which are not compiled from source (C library, compiler runtime).
+
+Patterns are regular expressions searched in "<file>:<name> <symbol>", e.g. "task_system.cpp:void
+Teufel::Task::System::print_task_stats() _ZN6Teufel4Task6System16print_task_statsEv".
+
+Recursion, dynamic stack allocation and missing entry points make the check fail. Indirect calls without a
+matching rule and functions of unknown stack usage are counted as 0 bytes and reported, they only make the check
+fail with --strict.
+"""
+
+import os
+import re
+import sys
+import json
+import argparse
+
+from typing import Dict, List, Optional, Tuple
+
+INDIRECT_CALL = "__indirect_call"
+
+NODE_RE = re.compile(r'^node: \{ title: "(?P<title>[^"]*)" label: "(?P<label>[^"]*)"(?P<ext> shape : ellipse)? \}')
+EDGE_RE = re.compile(r'^edge: \{ sourcename: "(?P<src>[^"]*)" targetname: "(?P<dst>[^"]*)" label: "(?P<loc>[^"]*)" \}')
+STACK_RE = re.compile(r'^(?P<bytes>\d+) bytes \((?P<qualifier>[a-z,]+)\)$')
+
+
+class Function:
+
+    def __init__(self, title: str):
+        self.title = title
+        self.name = title
+        self.location = ""
+        self.frame: Optional[int] = None
+        self.qualifier = ""
+        # (target title, call site)
+        self.calls: List[Tuple[str, str]] = []
+
+    @property
+    def defined(self) -> bool:
+        return self.frame is not None
+
+    @property
+    def ident(self) -> str:
+        return "{}:{} {}".format(os.path.basename(self.location.split(":")[0]), self.name, self.title)
+
+
+class CallGraph:
+
+    def __init__(self):
+        self.functions: Dict[str, Function] = {}
+
+    def get(self, title: str) -> Function:
+        if title not in self.functions:
+            self.functions[title] = Function(title)
+        return self.functions[title]
+
+    def parse(self, path: str):
+        with open(path, encoding="utf-8", errors="replace") as f:
+            for line in f:
+                m = NODE_RE.match(line)
+                if m:
+                    self.__add_node(m.group("title"), m.group("label").split("\\n"), m.group("ext") is not None)
+                    continue
+
+                m = EDGE_RE.match(line)
+                if m:
+                    calls = self.get(m.group("src")).calls
+                    call = (m.group("dst"), m.group("loc"))
+                    if call not in calls:
+                        calls.append(call)
+
+    def __add_node(self, title: str, label: List[str], external: bool):
+        fn = self.get(title)
+        if external or title == INDIRECT_CALL:
+            return
+
+        fn.name = label[0]
+        if len(label) > 1:
+            fn.location = label[1]
+        for field in label[2:]:
+            m = STACK_RE.match(field)
+            if m:
+                # Inline functions are emitted by several translation units, possibly with different frames
+                frame = int(m.group("bytes"))
+                if fn.frame is None or frame > fn.frame:
+                    fn.frame = frame
+                    fn.qualifier = m.group("qualifier")
+
+
+class Analysis:
+
+    def __init__(self, graph: CallGraph, budgets: dict):
+        self.graph = graph
+        self.indirect = [(re.compile(r["from"]), [re.compile(t) for t in r["to"]]) for r in budgets.get("indirect", [])]
+        self.assume = [(re.compile(p), b) for p, b in budgets.get("assume", {}).items()]
+
+        # title -> (depth, deepest chain, unbounded)
+        self.__depths: Dict[str, Tuple[int, List[str], bool]] = {}
+        self.__active: List[str] = []
+        self.__resolved: Dict[str, List[str]] = {}
+
+        self.recursions: List[List[str]] = []
+        self.dynamic: List[Function] = []
+        # (caller, call site)
+        self.unresolved: List[Tuple[Function, str]] = []
+        self.unknown: Dict[str, Function] = {}
+
+    def find(self, pattern: str) -> List[Function]:
+        regex = re.compile(pattern)
+        return [fn for fn in self.graph.functions.values() if fn.defined and regex.search(fn.ident)]
+
+    def __resolve_indirect(self, fn: Function, site: str) -> List[str]:
+        if fn.title not in self.__resolved:
+            targets = []
+            for caller, callees in self.indirect:
+                if not caller.search(fn.ident):
+                    continue
+                for callee in callees:
+                    targets += [f.title for f in self.graph.functions.values()
+                                if f.defined and f is not fn and callee.search(f.ident) and f.title not in targets]
+            self.__resolved[fn.title] = targets
+
+        if not self.__resolved[fn.title] and (fn, site) not in self.unresolved:
+            self.unresolved.append((fn, site))
+        return self.__resolved[fn.title]
+
+    def __frame(self, fn: Function) -> Tuple[int, bool]:
+        if fn.defined:
+            if "dynamic" in fn.qualifier and "bounded" not in fn.qualifier:
+                if fn not in self.dynamic:
+                    self.dynamic.append(fn)
+                return fn.frame, True
+            return fn.frame, False
+
+        for regex, frame in self.assume:
+            if regex.search(fn.title):
+                return frame, False
+        self.unknown[fn.title] = fn
+        return 0, False
+
+    def depth(self, title: str) -> Tuple[int, List[str], bool]:
+        if title in self.__depths:
+            return self.__depths[title]
+
+        if title in self.__active:
+            cycle = self.__active[self.__active.index(title):] + [title]
+            if cycle not in self.recursions:
+                self.recursions.append(cycle)
+            return 0, [title], True
+
+        fn = self.graph.get(title)
+        self.__active.append(title)
+
+        callees = []
+        for target, site in fn.calls:
+            if target == INDIRECT_CALL:
+                callees += self.__resolve_indirect(fn, site)
+            else:
+                callees.append(target)
+
+        deepest, chain, unbounded = 0, [], False
+        for callee in callees:
+            d, c, u = self.depth(callee)
+            unbounded |= u
+            if d > deepest or not chain:
+                deepest, chain = d, c
+
+        self.__active.pop()
+        frame, dynamic = self.__frame(fn)
+        result = (frame + deepest, [title] + chain, unbounded or dynamic)
+
+        self.__depths[title] = result
+        return result
+
+
+def describe(graph: CallGraph, title: str) -> str:
+    fn = graph.get(title)
+    frame = "?" if fn.frame is None else fn.frame
+    return "{:>6}  {}".format(frame, fn.name if fn.defined else title)
+
+
+def check(graph: CallGraph, budgets: dict, strict: bool) -> bool:
+    analysis = Analysis(graph, budgets)
+    ok = True
+    reports = []
+
+    for stack in budgets["stacks"]:
+        total, unbounded, missing, chains = 0, False, False, []
+        for level in stack["roots"]:
+            patterns = level if isinstance(level, list) else [level]
+            roots = [fn for p in patterns for fn in analysis.find(p)]
+            if not roots:
+                print("error: no entry point of '{}' matches {}".format(stack["name"], patterns))
+                missing = True
+                continue
+
+            depth, chain, u = max((analysis.depth(fn.title) for fn in roots), key=lambda r: r[0])
+            total += depth + stack.get("frame_bytes", 0)
+            unbounded |= u
+            chains.append(chain)
+
+        over = total > stack["stack_bytes"]
+        ok &= not over and not unbounded and not missing
+        status = "UNBOUNDED" if unbounded else ("OVER" if over else ("INCOMPLETE" if missing else "ok"))
+        print("{:<12} {:>6} / {:>6} B  {}".format(stack["name"], total, stack["stack_bytes"], status))
+        reports.append((stack["name"], chains))
+
+    print("\nDeepest call chains (frame size in bytes):")
+    for name, chains in reports:
+        for chain in chains:
+            print("  {}:".format(name))
+            for title in chain:
+                print("    " + describe(graph, title))
+
+    if analysis.recursions:
+        print("\nRecursion, the stack usage is unbounded:")
+        for cycle in analysis.recursions:
+            print("  " + " -> ".join(graph.get(t).name for t in cycle))
+
+    if analysis.dynamic:
+        print("\nDynamic stack allocation, the stack usage is unbounded:")
+        for fn in analysis.dynamic:
+            print("  {} ({})".format(fn.name, fn.location))
+
+    if analysis.unresolved:
+        print("\nIndirect calls without a rule in the budget file, counted as 0 bytes:")
+        for fn, site in analysis.unresolved:
+            print("  {} ({})".format(fn.name, site))
+        ok &= not strict
+
+    if analysis.unknown:
+        print("\nFunctions of unknown stack usage, counted as 0 bytes:")
+        for title in sorted(analysis.unknown):
+            print("  " + title)
+        ok &= not strict
+
+    return ok
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Checks the worst-case stack depth against the budget of each stack")
+    parser.add_argument("-b", "--budgets", required=True, help="Budget file (JSON)")
+    parser.add_argument("--strict", action="store_true",
+                        help="Also fail on unresolved indirect calls and functions of unknown stack usage")
+    parser.add_argument("dirs", nargs="+", help="Directories searched for .ci files")
+    args = parser.parse_args(argv)
+
+    with open(args.budgets, encoding="utf-8") as f:
+        budgets = json.load(f)
+
+    graph = CallGraph()
+    count = 0
+    for d in args.dirs:
+        for root, _, files in os.walk(d):
+            for name in files:
+                if name.endswith(".ci"):
+                    graph.parse(os.path.join(root, name))
+                    count += 1
+
+    if count == 0:
+        print("error: no .ci files found, compile with -fcallgraph-info=su,da")
+        return 1
+
+    return 0 if check(graph, budgets, args.strict) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
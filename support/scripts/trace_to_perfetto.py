@@ -0,0 +1,189 @@
+#!/usr/bin/env python3
+
+"""Converts the output of the 'trace dump' shell command into a timeline for Perfetto (https://ui.perfetto.dev).
+
+The input is the captured debug UART output, other lines (logs, prompt) are skipped. The output is a JSON file in
+the Chrome trace event format: a track per task with its run slices, a track per interrupt with its handler slices
+and instant events for the queue operations and task notifications, on the track of the task or interrupt which
+did them.
+
+Dump format (see src/trace/trace.cpp):
+    trace begin <records> <overwritten records>
+    trace task <number> <name>
+    trace rec <timestamp us> <event> <id> <arg>        (hexadecimal)
+    trace end
+"""
+
+import re
+import sys
+import json
+import argparse
+import logging
+
+from typing import Dict, List, Optional
+
+TRACE_TASK_SWITCHED_IN = 1
+TRACE_ISR_ENTER = 2
+TRACE_ISR_EXIT = 3
+TRACE_QUEUE_SEND = 4
+TRACE_QUEUE_SEND_FAILED = 5
+TRACE_QUEUE_RECEIVE = 6
+TRACE_TASK_NOTIFY = 7
+
+# ucQueueType of FreeRTOS
+QUEUE_TYPES = ["queue", "set", "mutex", "counting semaphore", "binary semaphore", "recursive mutex"]
+
+# Device interrupts of the STM32F072
+IRQ_NAMES = [
+    "WWDG", "PVD_VDDIO2", "RTC", "FLASH", "RCC_CRS", "EXTI0_1", "EXTI2_3", "EXTI4_15", "TSC", "DMA1_CH1",
+    "DMA1_CH2_3", "DMA1_CH4_7", "ADC1_COMP", "TIM1_BRK_UP", "TIM1_CC", "TIM2", "TIM3", "TIM6_DAC", "TIM7", "TIM14",
+    "TIM15", "TIM16", "TIM17", "I2C1", "I2C2", "SPI1", "SPI2", "USART1", "USART2", "USART3_4", "CEC_CAN", "USB",
+]
+
+SRAM_BASE = 0x20000000
+
+PID = 1
+IRQ_TID_BASE = 1000
+UNKNOWN_TID = 0
+
+LINE_RE = re.compile(r'trace (?P<kind>begin|task|rec|end)\b ?(?P<fields>.*)$')
+
+
+class Decoder:
+
+    def __init__(self):
+        self.tasks: Dict[int, str] = {}
+        self.records: List[tuple] = []
+        self.overwritten = 0
+
+    def parse(self, lines):
+        """Keeps the last complete dump of the input"""
+        tasks, records, overwritten, within = {}, [], 0, False
+        for line in lines:
+            m = LINE_RE.search(line.strip())
+            if not m:
+                continue
+
+            kind, fields = m.group("kind"), m.group("fields").split()
+            if kind == "begin":
+                tasks, records, within = {}, [], True
+                overwritten = int(fields[1]) if len(fields) > 1 else 0
+            elif not within:
+                continue
+            elif kind == "task":
+                tasks[int(fields[0])] = " ".join(fields[1:])
+            elif kind == "rec":
+                records.append(tuple(int(f, 16) for f in fields[:4]))
+            elif kind == "end":
+                self.tasks, self.records, self.overwritten = tasks, records, overwritten
+                within = False
+
+        if within:
+            logging.warning("The last dump is incomplete, using the previous one")
+
+    def task_name(self, number: int) -> str:
+        return self.tasks.get(number, "task {}".format(number))
+
+    def events(self) -> List[dict]:
+        events = []
+
+        def thread_name(tid: int, name: str, sort_index: int):
+            events.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_name", "args": {"name": name}})
+            events.append({"ph": "M", "pid": PID, "tid": tid, "name": "thread_sort_index",
+                           "args": {"sort_index": sort_index}})
+
+        events.append({"ph": "M", "pid": PID, "name": "process_name", "args": {"name": "MCU"}})
+        for number, name in sorted(self.tasks.items()):
+            thread_name(number, name, number)
+
+        running: Optional[int] = None
+        running_since = 0
+        isr_stack: List[int] = []
+        irqs = set()
+
+        # The 32-bit microsecond clock wraps around after ~71 minutes, the timeline starts at the oldest record
+        epoch, last_raw = 0, None
+        origin = self.records[0][0] if self.records else 0
+        ts = 0
+        for raw_ts, event, ident, arg in self.records:
+            if last_raw is not None and raw_ts < last_raw:
+                epoch += 1 << 32
+            last_raw = raw_ts
+            ts = epoch + raw_ts - origin
+
+            tid = (IRQ_TID_BASE + isr_stack[-1]) if isr_stack else (running if running is not None else UNKNOWN_TID)
+
+            if event == TRACE_TASK_SWITCHED_IN:
+                if running is not None and running != ident:
+                    events.append({"ph": "X", "pid": PID, "tid": running, "name": self.task_name(running),
+                                   "ts": running_since, "dur": ts - running_since})
+                if running != ident:
+                    running, running_since = ident, ts
+            elif event == TRACE_ISR_ENTER:
+                irqs.add(ident)
+                isr_stack.append(ident)
+                events.append({"ph": "B", "pid": PID, "tid": IRQ_TID_BASE + ident, "name": irq_name(ident), "ts": ts})
+            elif event == TRACE_ISR_EXIT:
+                if isr_stack and isr_stack[-1] == ident:
+                    isr_stack.pop()
+                    events.append({"ph": "E", "pid": PID, "tid": IRQ_TID_BASE + ident, "ts": ts})
+            elif event in (TRACE_QUEUE_SEND, TRACE_QUEUE_SEND_FAILED, TRACE_QUEUE_RECEIVE):
+                name = {TRACE_QUEUE_SEND: "send", TRACE_QUEUE_SEND_FAILED: "send failed",
+                        TRACE_QUEUE_RECEIVE: "receive"}[event]
+                queue_type = QUEUE_TYPES[ident] if ident < len(QUEUE_TYPES) else str(ident)
+                events.append({"ph": "i", "s": "t", "pid": PID, "tid": tid, "name": "{} {}".format(queue_type, name),
+                               "ts": ts, "args": {"queue": "0x{:08x}".format(SRAM_BASE + arg)}})
+            elif event == TRACE_TASK_NOTIFY:
+                events.append({"ph": "i", "s": "t", "pid": PID, "tid": tid,
+                               "name": "notify {}".format(self.task_name(ident)), "ts": ts})
+            else:
+                logging.warning("Unknown event %d at %d us", event, raw_ts)
+
+        # Close what is still running at the end of the trace
+        if running is not None:
+            events.append({"ph": "X", "pid": PID, "tid": running, "name": self.task_name(running),
+                           "ts": running_since, "dur": ts - running_since})
+        for ident in reversed(isr_stack):
+            events.append({"ph": "E", "pid": PID, "tid": IRQ_TID_BASE + ident, "ts": ts})
+
+        for ident in sorted(irqs):
+            thread_name(IRQ_TID_BASE + ident, "IRQ " + irq_name(ident), IRQ_TID_BASE + ident)
+        if any(e.get("tid") == UNKNOWN_TID for e in events if e["ph"] != "M"):
+            thread_name(UNKNOWN_TID, "before the first context switch", UNKNOWN_TID)
+
+        return events
+
+
+def irq_name(irqn: int) -> str:
+    return IRQ_NAMES[irqn] if irqn < len(IRQ_NAMES) else "IRQ{}".format(irqn)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description="Converts a 'trace dump' into a Perfetto (Chrome JSON) timeline")
+    parser.add_argument("input", help="Captured debug UART output, '-' for stdin")
+    parser.add_argument("-o", "--output", default="trace.json", help="Output file (default: trace.json)")
+    args = parser.parse_args(argv)
+
+    logging.basicConfig(format='%(message)s', level=logging.INFO)
+
+    decoder = Decoder()
+    if args.input == "-":
+        decoder.parse(sys.stdin)
+    else:
+        with open(args.input, encoding="utf-8", errors="replace") as f:
+            decoder.parse(f)
+
+    if not decoder.records:
+        logging.error("No complete 'trace dump' found in %s", args.input)
+        return 1
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        json.dump({"traceEvents": decoder.events(), "displayTimeUnit": "ms"}, f)
+
+    logging.info("%d records (%d overwritten before the dump), %d tasks: %s", len(decoder.records),
+                 decoder.overwritten, len(decoder.tasks), args.output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))